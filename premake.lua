@@ -94,24 +94,24 @@ workspace ( project_name )
 		-- Library search paths for the linker
 		libdirs { deps_dir }
 
-		-- List of libraries & projects to link against
-		links {
-			"glfw\\"  .. bin_dir .. "\\GLFW.lib",
-			"imgui\\" .. bin_dir .. "\\ImGui.lib",
-			"Glu32.lib",
-			"opengl32.lib"
-		}
-
-
 		postbuildcommands {
 			"python \"" .. root_dir .. config.dir.script.. "\\" .. "setup.py\" solution copy " .. build_dir
 		}
 
 
+		-- List of libraries & projects to link against
 		filter "system:windows"
 			systemversion "latest"
+			links {
+				"glfw\\"  .. bin_dir .. "\\GLFW.lib",
+				"imgui\\" .. bin_dir .. "\\ImGui.lib",
+				"Glu32.lib",
+				"opengl32.lib"
+			}
 		filter "system:linux"
-			-- links { }
+			-- The GLFW & ImGui projects by name, then what their static libs need (X11, freetype)
+			-- Headless runs (Core/Headless.h) make their context through EGL
+			links { "GLFW", "ImGui", "freetype", "X11", "EGL", "GL", "GLU", "pthread", "dl" }
 		filter "system:macosx"
 			-- links { }
 
@@ -0,0 +1,154 @@
+#include "Core/BVH.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+
+template<typename Scalar, int Dim>
+void BasicBVH<Scalar, Dim>::build(const std::vector<aabb_t>& items)
+{
+	nodes.clear();
+	boxes = items;
+
+	order.resize(items.size());
+	itemLeaf.assign(items.size(), NONE);
+	if (items.empty()) return;
+
+	std::vector<point_t> centers(items.size());
+	for (uint32_t i = 0; i < items.size(); i++)
+	{
+		order[i]   = i;
+		centers[i] = items[i].center();
+	}
+
+	nodes.reserve(2 * (items.size() / LEAF_SIZE + 1));
+	nodes.emplace_back();
+	buildNode(0, centers, 0, uint32_t(items.size()));
+}
+
+template<typename Scalar, int Dim>
+void BasicBVH<Scalar, Dim>::buildNode(uint32_t index, const std::vector<point_t>& centers,
+	uint32_t first, uint32_t count)
+{
+	// 'nodes' grows during the recursion, so nodes are never kept by reference here
+	aabb_t box, centerBox;
+	for (uint32_t i = first; i < first + count; i++)
+	{
+		box.expand(boxes[order[i]]);
+		centerBox.expand(centers[order[i]]);
+	}
+	nodes[index].box = box;
+
+	if (count <= LEAF_SIZE)
+	{
+		nodes[index].first = first;
+		nodes[index].count = count;
+		for (uint32_t i = first; i < first + count; i++) itemLeaf[order[i]] = index;
+		return;
+	}
+
+	// Median split along the longest axis of the item centers
+	point_t extent = centerBox.extent();
+	int axis = 0;
+	for (int i = 1; i < Dim; i++)
+		if (extent[i] > extent[axis]) axis = i;
+
+	uint32_t half = count / 2;
+	std::nth_element(order.begin() + first, order.begin() + first + half, order.begin() + first + count,
+		[&centers, axis](uint32_t a, uint32_t b) { return centers[a][axis] < centers[b][axis]; });
+
+	uint32_t left = uint32_t(nodes.size());
+	nodes.emplace_back(); nodes.emplace_back();
+
+	nodes[index].first = left;
+	nodes[index].count = 0;
+	nodes[left].parent = nodes[left+1].parent = index;
+
+	buildNode(left,   centers, first,        half);
+	buildNode(left+1, centers, first + half, count - half);
+}
+
+
+template<typename Scalar, int Dim>
+void BasicBVH<Scalar, Dim>::refit(const std::vector<aabb_t>& items)
+{
+	if (items.size() != itemLeaf.size())
+		throw std::invalid_argument
+		("BVH::refit: item count differs from the built one, rebuild the hierarchy.");
+
+	boxes = items;
+
+	// Children are always stored after their parents, so a reverse sweep is bottom-up
+	for (size_t i = nodes.size(); i-- > 0;)
+		refitNode(uint32_t(i));
+}
+
+template<typename Scalar, int Dim>
+void BasicBVH<Scalar, Dim>::refitItem(size_t item, const aabb_t& box)
+{
+	boxes[item] = box;
+	for (uint32_t node = itemLeaf[item]; node != NONE; node = nodes[node].parent)
+		refitNode(node);
+}
+
+template<typename Scalar, int Dim>
+void BasicBVH<Scalar, Dim>::refitNode(uint32_t index)
+{
+	Node& node = nodes[index];
+
+	aabb_t box;
+	if (node.isLeaf())
+		for (uint32_t i = node.first; i < node.first + node.count; i++)
+			box.expand(boxes[order[i]]);
+	else
+	{
+		box = nodes[node.first].box;
+		box.expand(nodes[node.first+1].box);
+	}
+	node.box = box;
+}
+
+
+template<typename Scalar, int Dim>
+void BasicBVH<Scalar, Dim>::raycast(const point_t& origin, const point_t& direction,
+	std::vector<RayHit>& hits, Scalar tMax) const
+{
+	hits.clear();
+	traverseRay(origin, direction, [&hits, tMax](size_t item, Scalar tNear, Scalar tFar)
+	{
+		hits.push_back({ item, tNear, tFar });
+		return tMax;
+	}, tMax);
+
+	std::sort(hits.begin(), hits.end(),
+		[](const RayHit& a, const RayHit& b) { return a.tNear < b.tNear; });
+}
+
+template<typename Scalar, int Dim>
+void BasicBVH<Scalar, Dim>::overlaps(const aabb_t& box, std::vector<size_t>& items) const
+{
+	items.clear();
+	if (nodes.empty()) return;
+
+	std::vector<uint32_t> stack = { 0 };
+	while (!stack.empty())
+	{
+		const Node& node = nodes[stack.back()];
+		stack.pop_back();
+		if (!node.box.overlaps(box)) continue;
+
+		if (!node.isLeaf())
+		{
+			stack.push_back(node.first);
+			stack.push_back(node.first + 1);
+			continue;
+		}
+		for (uint32_t i = node.first; i < node.first + node.count; i++)
+			if (boxes[order[i]].overlaps(box))
+				items.push_back(order[i]);
+	}
+}
+
+
+template class BasicBVH<float>;
+template class BasicBVH<double>;
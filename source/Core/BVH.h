@@ -0,0 +1,210 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <utility>
+#include <vector>
+
+#include "Core/Bounds.h"
+
+
+// Bounding volume hierarchy over a set of boxes (usually Bezier patches of a NURBS).
+// Topology is built once, moving items only refits the boxes in place
+template<typename Scalar, int Dim = 3>
+class BasicBVH
+{
+public:
+	using aabb_t  = BasicAABB<Scalar, Dim>;
+	using point_t = typename aabb_t::point_t;
+
+	static constexpr uint32_t LEAF_SIZE = 4;
+	static constexpr uint32_t NONE = std::numeric_limits<uint32_t>::max();
+
+	struct Node
+	{
+		aabb_t   box;
+		uint32_t parent = NONE;
+		uint32_t first  = 0;  // leaf - first entry in 'order', inner - left child (right is first+1)
+		uint32_t count  = 0;  // leaf - number of items, inner - 0
+
+		inline bool isLeaf() const { return count > 0; }
+	};
+
+	struct RayHit
+	{
+		size_t item;
+		Scalar tNear, tFar;
+	};
+
+private:
+	std::vector<Node>     nodes;
+	std::vector<uint32_t> order;     // item indices grouped by leaves
+	std::vector<uint32_t> itemLeaf;  // leaf holding each item
+	std::vector<aabb_t>   boxes;     // item boxes as of the last build/refit
+
+public:
+	BasicBVH() = default;
+	inline BasicBVH(const std::vector<aabb_t>& items) { build(items); }
+
+	// Patches of a spline (anything with patchCount()/patchBounds())
+	template<typename Spline>
+	static std::vector<aabb_t> patchBoxes(const Spline& spline)
+	{
+		std::vector<aabb_t> boxes(spline.patchCount());
+		for (size_t i = 0; i < boxes.size(); i++) boxes[i] = spline.patchBounds(i);
+		return boxes;
+	}
+
+	void build(const std::vector<aabb_t>& items);
+	// Same number of items, new boxes: all nodes are refitted bottom-up
+	void refit(const std::vector<aabb_t>& items);
+	// Only the path from the item's leaf to the root is refitted
+	void refitItem(size_t item, const aabb_t& box);
+	inline void refit(const std::vector<aabb_t>& items, const std::vector<size_t>& changed)
+	{ for (size_t item : changed) refitItem(item, items[item]); }
+
+	template<typename Spline> inline void build(const Spline& spline) { build(patchBoxes(spline)); }
+	template<typename Spline> inline void refit(const Spline& spline) { refit(patchBoxes(spline)); }
+	// E.g. with spline.controlPointPatches(i) after a single point edit
+	template<typename Spline> inline void refit(const Spline& spline, const std::vector<size_t>& changed)
+	{ for (size_t item : changed) refitItem(item, spline.patchBounds(item)); }
+
+	inline bool   isEmpty()   const { return nodes.empty(); }
+	inline size_t itemCount() const { return itemLeaf.size(); }
+	inline const std::vector<Node>& getNodes() const { return nodes; }
+	inline const aabb_t& bounds() const { return nodes[0].box; }
+	inline const aabb_t& itemBox(size_t item) const { return boxes[item]; }
+
+	// All items whose boxes are hit by the ray within [0, tMax], sorted by entry distance
+	void raycast(const point_t& origin, const point_t& direction, std::vector<RayHit>& hits,
+		Scalar tMax = std::numeric_limits<Scalar>::max()) const;
+	// All items whose boxes overlap the given one
+	void overlaps(const aabb_t& box, std::vector<size_t>& items) const;
+
+	// Closest hit traversal, near children first.
+	// visit(item, tNear, tFar) returns the new tMax (e.g. the exact hit found in the item)
+	template<typename Visitor>
+	void traverseRay(const point_t& origin, const point_t& direction, Visitor&& visit,
+		Scalar tMax = std::numeric_limits<Scalar>::max()) const;
+
+	// Best-first search of the item closest to the point.
+	// distance2(item, best) returns the exact squared distance to the item,
+	// 'best' is the current best one which it may use to stop early.
+	// A known candidate (e.g. the answer for a nearby point) can be given to prune harder.
+	// Returns { item, squared distance } or { NONE, max } when nothing is closer
+	template<typename Distance>
+	std::pair<size_t, Scalar> nearest(const point_t& point, Distance&& distance2,
+		std::pair<size_t, Scalar> best = { size_t(NONE), std::numeric_limits<Scalar>::max() }) const;
+
+private:
+	void buildNode(uint32_t index, const std::vector<point_t>& centers, uint32_t first, uint32_t count);
+	void refitNode(uint32_t index);
+
+	static inline point_t inverse(const point_t& direction)
+	{
+		point_t inv;
+		for (int i = 0; i < Dim; i++)
+			inv[i] = (direction[i] != Scalar(0)) ? Scalar(1) / direction[i] : std::numeric_limits<Scalar>::max();
+		return inv;
+	}
+};
+
+
+template<typename Scalar, int Dim>
+template<typename Visitor>
+void BasicBVH<Scalar, Dim>::traverseRay(const point_t& origin, const point_t& direction, Visitor&& visit,
+	Scalar tMax) const
+{
+	if (nodes.empty()) return;
+
+	point_t invDir = inverse(direction);
+
+	// Entries are pushed with their entry distance so farther ones can be culled on pop
+	std::vector<std::pair<uint32_t, Scalar>> stack;
+	stack.reserve(64);
+
+	Scalar tNear = Scalar(0), tFar = tMax;
+	if (nodes[0].box.intersect(origin, invDir, tNear, tFar))
+		stack.emplace_back(0, tNear);
+
+	while (!stack.empty())
+	{
+		auto [index, entry] = stack.back();
+		stack.pop_back();
+		if (entry > tMax) continue;
+
+		const Node& node = nodes[index];
+		if (node.isLeaf())
+		{
+			for (uint32_t i = node.first; i < node.first + node.count; i++)
+			{
+				Scalar itemNear = Scalar(0), itemFar = tMax;
+				uint32_t item = order[i];
+				if (itemBox(item).intersect(origin, invDir, itemNear, itemFar))
+					tMax = std::min(tMax, Scalar(visit(size_t(item), itemNear, itemFar)));
+			}
+			continue;
+		}
+
+		Scalar near[2] = { Scalar(0), Scalar(0) }, far[2] = { tMax, tMax };
+		bool hit[2] =
+		{
+			nodes[node.first  ].box.intersect(origin, invDir, near[0], far[0]),
+			nodes[node.first+1].box.intersect(origin, invDir, near[1], far[1])
+		};
+
+		// Farther child goes first so the nearer one is popped next
+		int closer = (hit[1] && (!hit[0] || near[1] < near[0])) ? 1 : 0;
+		if (hit[1-closer]) stack.emplace_back(node.first + 1-closer, near[1-closer]);
+		if (hit[closer])   stack.emplace_back(node.first + closer,   near[closer]);
+	}
+}
+
+template<typename Scalar, int Dim>
+template<typename Distance>
+std::pair<size_t, Scalar> BasicBVH<Scalar, Dim>::nearest(const point_t& point, Distance&& distance2,
+	std::pair<size_t, Scalar> best) const
+{
+	if (nodes.empty()) return best;
+
+	using entry_t = std::pair<Scalar, uint32_t>;
+	std::priority_queue<entry_t, std::vector<entry_t>, std::greater<entry_t>> queue;
+	queue.emplace(nodes[0].box.distance2(point), 0);
+
+	while (!queue.empty())
+	{
+		auto [bound, index] = queue.top();
+		queue.pop();
+		if (bound >= best.second) break;  // everything left is farther
+
+		const Node& node = nodes[index];
+		if (node.isLeaf())
+		{
+			for (uint32_t i = node.first; i < node.first + node.count; i++)
+			{
+				if (order[i] == best.first || itemBox(order[i]).distance2(point) >= best.second) continue;
+
+				Scalar d = distance2(size_t(order[i]), best.second);
+				if (d < best.second) best = { size_t(order[i]), d };
+			}
+			continue;
+		}
+
+		for (uint32_t child = node.first; child < node.first + 2; child++)
+		{
+			Scalar d = nodes[child].box.distance2(point);
+			if (d < best.second) queue.emplace(d, child);
+		}
+	}
+	return best;
+}
+
+
+using BVH  = BasicBVH<float>;
+using BVHd = BasicBVH<double>;
+
+// Non-template members are explicitly instantiated in Core/BVH.cpp
+extern template class BasicBVH<float>;
+extern template class BasicBVH<double>;
@@ -0,0 +1,383 @@
+#include "Core/Benchmark.h"
+
+#include <charconv>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <random>
+
+#include "glm/gtc/matrix_transform.hpp"
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+
+#include "Core/BVH.h"
+#include "Core/Camera.h"
+#include "Core/Picker.h"
+#include "Core/Scene.h"
+
+
+namespace
+{
+	std::string_view value(int argc, char** argv, int& i)
+	{
+		if (i + 1 >= argc)
+			throw std::invalid_argument
+			(std::string("Benchmark::parse: ") + argv[i] + " needs a value");
+		return argv[++i];
+	}
+
+	size_t toCount(std::string_view text, std::string_view option, size_t min, size_t max)
+	{
+		size_t count = 0;
+		auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), count);
+		if (error != std::errc() || end != text.data() + text.size() || count < min || count > max)
+			throw std::invalid_argument
+			("Benchmark::parse: bad value of " + std::string(option) + ": " + std::string(text));
+		return count;
+	}
+
+	const size_t REPEATS = 5;
+	// Random queries of the search benchmarks
+	const size_t QUERIES = 1000;
+}
+
+
+bool Benchmark::parse(int argc, char** argv, Settings& settings)
+{
+	bool benchmark = false;
+	for (int i = 1; i < argc; i++)
+		if (std::string_view(argv[i]) == "--benchmark") benchmark = true;
+	if (!benchmark) return false;
+
+	for (int i = 1; i < argc; i++)
+	{
+		std::string_view option = argv[i];
+		if (option == "--benchmark")
+		{
+			std::string_view name = value(argc, argv, i);
+			if      (name == "precision") settings.kind = PRECISION;
+			else if (name == "bvh")       settings.kind = BVH;
+			else if (name == "pick")      settings.kind = PICK;
+			else throw std::invalid_argument
+				("Benchmark::parse: unknown benchmark " + std::string(name));
+		}
+		else if (option == "--samples") settings.samples = toCount(value(argc, argv, i), option, 2, 4096);
+		else if (option == "--net")     settings.net = toCount(value(argc, argv, i), option, NURBS::MIN_DIM, 4096);
+		else if (option.substr(0, 2) == "--")
+			throw std::invalid_argument
+			("Benchmark::parse: unknown option " + std::string(option));
+		else settings.scene = option;
+	}
+	return true;
+}
+
+const char* Benchmark::usage()
+{
+	return
+		"       [scene.json] --benchmark NAME [--samples N] [--net N]\n"
+		"  --benchmark NAME    time the CPU core without a window, NAME is one of\n"
+		"                      precision - float against double evaluation & conversion\n"
+		"                      bvh - patch BVH against brute force\n"
+		"                      pick - control point picking against brute force\n"
+		"  --net N             generated NxN net instead of the scene\n";
+}
+
+
+void Benchmark::run(const Settings& settings)
+{
+	Scene scene;
+	if (!settings.scene.empty()) Scene::read(settings.scene, scene);
+	NURBS surface = (settings.net > 0) ? generateNet(settings.net) :
+		scene.surfaces.empty() ? NURBS(5, 3) : std::move(scene.surfaces.front());
+
+	switch (settings.kind)
+	{
+	case PRECISION: precision(surface, settings.samples); break;
+	case BVH:       bvh(std::move(surface)); break;
+	case PICK:      pick(surface); break;
+	case NONE: break;
+	}
+}
+
+NURBS Benchmark::generateNet(size_t n)
+{
+	NURBS net(n, n);
+	std::mt19937 random(1);
+	std::uniform_real_distribution<float> noise(-0.5f, 0.5f);
+	const float waves = 6.2831853f * 3.f / float(n), height = 0.1f * float(n);
+	for (auto& point : net.controlPoints)
+		point.z = height * std::sin(point.x * waves) * std::cos(point.y * waves) + noise(random);
+	net.invalidate();
+	return net;
+}
+
+
+void Benchmark::precision(const NURBS& surface, size_t samples)
+{
+	// The same parameters for both, spread over the whole domain
+	size_t n = samples;
+	glm::dvec2 start(surface.domainStart(NURBS::U), surface.domainStart(NURBS::V));
+	glm::dvec2 end(surface.domainEnd(NURBS::U), surface.domainEnd(NURBS::V));
+	std::vector<glm::dvec2> parameters(n * n);
+	for (size_t j = 0; j < n; j++)
+		for (size_t i = 0; i < n; i++)
+			parameters[j * n + i] = start + (end - start) * glm::dvec2(double(i), double(j)) / double(n - 1);
+
+	NURBSd converted(surface);
+	double toDouble = bestTime(REPEATS, [&] { converted = NURBSd(surface); });
+	double toFloat  = bestTime(REPEATS, [&] { NURBS back(converted); });
+
+	std::vector<NURBS::point_t>  floatPoints(parameters.size());
+	std::vector<NURBSd::point_t> doublePoints(parameters.size());
+	double floatTime = bestTime(REPEATS, [&]
+	{
+		NURBS::point_t partials[2];
+		for (size_t i = 0; i < parameters.size(); i++)
+			floatPoints[i] = surface.evaluate(NURBS::param_t(parameters[i]), partials);
+	});
+	double doubleTime = bestTime(REPEATS, [&]
+	{
+		NURBSd::point_t partials[2];
+		for (size_t i = 0; i < parameters.size(); i++)
+			doublePoints[i] = converted.evaluate(parameters[i], partials);
+	});
+
+	double difference = 0.0;
+	for (size_t i = 0; i < parameters.size(); i++)
+		difference = std::max(difference, glm::length(glm::dvec3(floatPoints[i]) - doublePoints[i]));
+	double size = glm::length(converted.bounds().extent());
+
+	double perSample = 1e6 / double(parameters.size());
+	std::printf("%zux%zu surface of degree %zux%zu%s, %zux%zu samples, single thread, best of %zu\n"
+		"Evaluate (with partials): float %.1f ns, double %.1f ns per sample\n"
+		"Convert: float to double %.1f us, double to float %.1f us\n"
+		"Largest float/double difference: %.3g (%.3g of the net's size)\n",
+		surface.dim[NURBS::U], surface.dim[NURBS::V], surface.degree[NURBS::U], surface.degree[NURBS::V],
+		surface.isRational() ? ", rational" : "", n, n, REPEATS,
+		floatTime * perSample, doubleTime * perSample, toDouble * 1e3, toFloat * 1e3,
+		difference, (size > 0.0) ? difference / size : 0.0);
+}
+
+void Benchmark::bvh(NURBS surface)
+{
+	std::vector<AABB> boxes = ::BVH::patchBoxes(surface);
+	size_t n = boxes.size();
+
+	::BVH tree;
+	double build = bestTime(REPEATS, [&] { tree.build(boxes); });
+	double refit = bestTime(REPEATS, [&] { tree.refit(boxes); });
+
+	// Queries inside the net's box, grown a bit so some of them miss
+	std::mt19937 random(2);
+	AABB bounds = tree.bounds();
+	glm::vec3 margin = 0.1f * bounds.extent() + glm::vec3(0.1f);
+	std::uniform_real_distribution<float> x(bounds.min.x - margin.x, bounds.max.x + margin.x);
+	std::uniform_real_distribution<float> y(bounds.min.y - margin.y, bounds.max.y + margin.y);
+	std::uniform_real_distribution<float> z(bounds.min.z - margin.z, bounds.max.z + margin.z);
+	std::uniform_real_distribution<float> tilt(-0.3f, 0.3f);
+
+	std::vector<glm::vec3> points(QUERIES), directions(QUERIES);
+	std::vector<AABB> regions(QUERIES);
+	glm::vec3 regionSize = 0.02f * bounds.extent() + glm::vec3(0.01f);
+	for (size_t q = 0; q < QUERIES; q++)
+	{
+		points[q] = glm::vec3(x(random), y(random), z(random));
+		directions[q] = glm::normalize(glm::vec3(tilt(random), tilt(random), -1.f));
+		regions[q] = AABB(points[q] - regionSize, points[q] + regionSize);
+	}
+
+	// Rays start above the net & look down, as from a camera over it
+	auto rayOrigin = [&](size_t q) { return glm::vec3(points[q].x, points[q].y, bounds.max.z + margin.z); };
+	auto inverse = [](glm::vec3 direction)
+	{
+		for (int i = 0; i < 3; i++)
+			direction[i] = (direction[i] != 0.f) ? 1.f / direction[i] : std::numeric_limits<float>::max();
+		return direction;
+	};
+
+	size_t treeHits = 0, bruteHits = 0;
+	std::vector<::BVH::RayHit> hits;
+	double treeRay = bestTime(REPEATS, [&]
+	{
+		treeHits = 0;
+		for (size_t q = 0; q < QUERIES; q++)
+		{
+			tree.raycast(rayOrigin(q), directions[q], hits);
+			treeHits += hits.size();
+		}
+	});
+	double bruteRay = bestTime(1, [&]
+	{
+		bruteHits = 0;
+		for (size_t q = 0; q < QUERIES; q++)
+		{
+			glm::vec3 origin = rayOrigin(q), invDir = inverse(directions[q]);
+			for (const AABB& box : boxes)
+			{
+				float tNear = 0.f, tFar = std::numeric_limits<float>::max();
+				if (box.intersect(origin, invDir, tNear, tFar)) bruteHits++;
+			}
+		}
+	});
+
+	std::vector<float> treeNearest(QUERIES), bruteNearest(QUERIES);
+	double treeNear = bestTime(REPEATS, [&]
+	{
+		for (size_t q = 0; q < QUERIES; q++)
+			treeNearest[q] = tree.nearest(points[q],
+				[&](size_t item, float) { return boxes[item].distance2(points[q]); }).second;
+	});
+	double bruteNear = bestTime(1, [&]
+	{
+		for (size_t q = 0; q < QUERIES; q++)
+		{
+			float best = std::numeric_limits<float>::max();
+			for (const AABB& box : boxes) best = std::min(best, box.distance2(points[q]));
+			bruteNearest[q] = best;
+		}
+	});
+	bool nearestMatch = (treeNearest == bruteNearest);
+
+	size_t treeOverlaps = 0, bruteOverlaps = 0;
+	std::vector<size_t> items;
+	double treeOverlap = bestTime(REPEATS, [&]
+	{
+		treeOverlaps = 0;
+		for (size_t q = 0; q < QUERIES; q++)
+		{
+			items.clear();
+			tree.overlaps(regions[q], items);
+			treeOverlaps += items.size();
+		}
+	});
+	double bruteOverlap = bestTime(1, [&]
+	{
+		bruteOverlaps = 0;
+		for (size_t q = 0; q < QUERIES; q++)
+			for (const AABB& box : boxes)
+				if (box.overlaps(regions[q])) bruteOverlaps++;
+	});
+
+	// Single point edits: the patches of the point are refitted against rebuilding all the boxes
+	// (fewer of those, they take long on large nets)
+	std::uniform_int_distribution<size_t> pick(0, surface.controlPoints.size() - 1);
+	std::vector<size_t> edited(QUERIES);
+	for (size_t& i : edited) i = pick(random);
+	double partialRefit = bestTime(REPEATS, [&]
+	{
+		for (size_t i : edited)
+		{
+			surface.setControlPoint(i, surface.controlPoints[i] + glm::vec3(0.f, 0.f, 0.01f));
+			tree.refit(surface, surface.controlPointPatches(i));
+		}
+	});
+	bool refitMatch = true;
+	for (size_t i = 0; i < n; i++)
+	{
+		const AABB& box = surface.patchBounds(i);
+		refitMatch = refitMatch && tree.itemBox(i).min == box.min && tree.itemBox(i).max == box.max;
+	}
+	size_t fullEdits = std::max<size_t>(1, QUERIES / 100);
+	double fullRefit = bestTime(REPEATS, [&]
+	{
+		for (size_t k = 0; k < fullEdits; k++)
+		{
+			size_t i = edited[k];
+			surface.setControlPoint(i, surface.controlPoints[i] - glm::vec3(0.f, 0.f, 0.01f));
+			tree.refit(surface);
+		}
+	});
+
+	// Milliseconds of all the queries to microseconds of one
+	double perQuery = 1e3 / double(QUERIES);
+	std::printf("%zux%zu surface of degree %zux%zu, %zu patches, %zu queries, best of %zu (brute force once)\n"
+		"Build %.3f ms, refit all %.3f ms\n"
+		"Point edit: refit its patches %.3f us, refit all %.3f us\n"
+		"               BVH (us)    brute (us)  results\n"
+		"Raycast     %10.3f  %12.3f  %zu/%zu box hits\n"
+		"Nearest     %10.3f  %12.3f  %s\n"
+		"Overlaps    %10.3f  %12.3f  %zu/%zu boxes\n"
+		"Refitted boxes %s the patches\n",
+		surface.dim[NURBS::U], surface.dim[NURBS::V], surface.degree[NURBS::U], surface.degree[NURBS::V],
+		n, QUERIES, REPEATS, build, refit,
+		partialRefit * perQuery, fullRefit * 1e3 / double(fullEdits),
+		treeRay * perQuery, bruteRay * perQuery, treeHits, bruteHits,
+		treeNear * perQuery, bruteNear * perQuery, nearestMatch ? "same" : "DIFFERENT",
+		treeOverlap * perQuery, bruteOverlap * perQuery, treeOverlaps, bruteOverlaps,
+		refitMatch ? "match" : "DON'T match");
+}
+
+void Benchmark::pick(const NURBS& surface)
+{
+	const std::vector<glm::vec3>& points = surface.controlPoints;
+	const AABB& bounds = surface.bounds();
+
+	PointGrid grid;
+	double build = bestTime(REPEATS, [&] { grid.build(points, bounds); });
+	std::printf("%zux%zu net, %zu points, %zu grid cells, build %.3f ms\n"
+		"%zu picks from random pixels, best of %zu (brute force once)\n"
+		"             grid (us)   brute (us)  picked  different\n",
+		surface.dim[NURBS::U], surface.dim[NURBS::V], points.size(), grid.cellCount(), build, QUERIES, REPEATS);
+
+	// The editor's 60 degrees tilted view of a 1280x720 viewport, from far enough to see the whole
+	// net and from a tenth of that, where the pick cone is a few times narrower than the cells
+	const int WIDTH = 1280, HEIGHT = 720;
+	float size = std::max(glm::length(bounds.extent()), 1e-3f);
+	for (float distance : { 1.5f * size, 0.15f * size })
+	{
+		Camera camera;
+		camera.setPerspective(45.f, WIDTH, HEIGHT, 0.01f * distance, 3.f * distance);
+		camera.view = glm::translate(glm::mat4(1.f), glm::vec3(0.f, 0.f, -distance));
+		camera.view = glm::rotate(camera.view, glm::radians(-60.f), glm::vec3(1.f, 0.f, 0.f));
+		camera.view = glm::translate(camera.view, -bounds.center());
+
+		std::mt19937 random(3);
+		std::uniform_real_distribution<float> x(0.f, float(WIDTH)), y(0.f, float(HEIGHT));
+		std::vector<glm::vec2> cursors(QUERIES);
+		for (auto& cursor : cursors) cursor = glm::vec2(x(random), y(random));
+
+		Picker picker;
+		std::vector<Picker::PointHit> hits(QUERIES, Picker::PointHit{ size_t(-1), 0.f });
+		double pickTime = bestTime(REPEATS, [&]
+		{
+			for (size_t q = 0; q < QUERIES; q++)
+				if (!picker.pickPoint(surface, camera, cursors[q], hits[q])) hits[q].index = size_t(-1);
+		});
+
+		// The same test as the grid's on every point
+		std::vector<Picker::PointHit> bruteHits(QUERIES);
+		float slope = camera.pixelSize(1.f) * Picker::POINT_RADIUS;
+		double bruteTime = bestTime(1, [&]
+		{
+			for (size_t q = 0; q < QUERIES; q++)
+			{
+				Camera::Ray ray = camera.unproject(cursors[q].x, cursors[q].y);
+				Picker::PointHit best{ size_t(-1), std::numeric_limits<float>::max() };
+				for (size_t i = 0; i < points.size(); i++)
+				{
+					float along = glm::dot(points[i] - ray.origin, ray.direction);
+					if (along < 0.f || along >= best.t) continue;
+					glm::vec3 offset = points[i] - ray.origin - ray.direction * along;
+					float allowed = slope * along;
+					if (glm::dot(offset, offset) <= allowed * allowed) best = { i, along };
+				}
+				bruteHits[q] = best;
+			}
+		});
+
+		size_t picked = 0, different = 0;
+		for (size_t q = 0; q < QUERIES; q++)
+		{
+			if (bruteHits[q].index != size_t(-1)) picked++;
+			// Points at the same distance along the ray may be picked either way
+			if (hits[q].index != bruteHits[q].index &&
+				(hits[q].index == size_t(-1) || bruteHits[q].index == size_t(-1) || hits[q].t != bruteHits[q].t))
+				different++;
+		}
+
+		double perQuery = 1e3 / double(QUERIES);
+		std::printf("%-11s %10.3f  %11.3f  %6zu  %9zu\n", (distance > size) ? "Whole net" : "Close up",
+			pickTime * perQuery, bruteTime * perQuery, picked, different);
+	}
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+
+#include "Core/Nurbs.h"
+
+
+// CPU benchmarks of the spline core, run from the command line ("--benchmark NAME") without a window
+// or a GL context, on the first surface of a scene, the built-in one or a generated net (curved
+// and noisy, "--net N"). Results go to stdout.
+//
+// "precision" times float against double evaluation (with partials, single threaded) on a grid of
+// samples x samples parameters and the conversion between the two, and prints the largest difference.
+// "bvh" times the patch BVH (build, full & single point refit, raycast, nearest and overlap queries)
+// against brute force over all the patch boxes, and checks that both give the same answers.
+// "pick" times the control point grid (build and Picker::pickPoint from random pixels, with the whole
+// net in view and close up) against testing every point, and checks that both pick the same points
+class Benchmark
+{
+public:
+	enum Kind { NONE, PRECISION, BVH, PICK };
+
+	struct Settings
+	{
+		Kind kind = NONE;
+		// Grid of samples x samples parameters
+		size_t samples = 256;
+		std::string scene;
+		// Generated net of net x net control points instead of the scene, 0 - none
+		size_t net = 0;
+	};
+
+	// True if the command line asks for a benchmark ("--benchmark NAME"), other options are left
+	// to the other modes otherwise. Throws std::invalid_argument on an unknown option or a bad value
+	static bool parse(int argc, char** argv, Settings& settings);
+	static const char* usage();
+
+	// Throws std::runtime_error if the scene can't be read
+	static void run(const Settings& settings);
+
+	static void precision(const NURBS& surface, size_t samples);
+	static void bvh(NURBS surface);
+	static void pick(const NURBS& surface);
+
+	// Regular n x n grid with waves & noise in z, the same for the same n
+	static NURBS generateNet(size_t n);
+
+	// Best of 'repeats' runs in milliseconds
+	template<typename Function>
+	static double bestTime(size_t repeats, Function&& function)
+	{
+		using namespace std::chrono;
+		double best = 0.0;
+		for (size_t i = 0; i < repeats; i++)
+		{
+			auto start = steady_clock::now();
+			function();
+			double time = duration<double, std::milli>(steady_clock::now() - start).count();
+			if (i == 0 || time < best) best = time;
+		}
+		return best;
+	}
+};
@@ -0,0 +1,95 @@
+#include "Core/BezierPatches.h"
+
+#include "Core/Parallel.h"
+
+
+namespace
+{
+	// Bezier points of the knot span [a, b] = [knots[s], knots[s+1]] of a degree p curve with
+	// control points at(0), at(1), ..: the k-th one is the blossom at (a, .. a, b, .. b) with k b's,
+	// which de Boor's algorithm evaluates when every step inserts its own argument
+	template<typename Point, typename Scalar, typename At>
+	void spanBezier(const std::vector<Scalar>& knots, size_t p, size_t s, At&& at, Point* out)
+	{
+		Point d[BasicNURBS<Scalar>::MAX_DEGREE + 1];
+		for (size_t k = 0; k <= p; k++)
+		{
+			for (size_t j = 0; j <= p; j++) d[j] = at(s - p + j);
+
+			// d[j] stands for the point j + s - p, the ones below r are no longer needed
+			for (size_t r = 1; r <= p; r++)
+			{
+				Scalar t = (r <= p - k) ? knots[s] : knots[s + 1];
+				for (size_t j = p; j >= r; j--)
+				{
+					size_t i = j + s - p;
+					Scalar alpha = (t - knots[i]) / (knots[i + p + 1 - r] - knots[i]);
+					d[j] = (Scalar(1) - alpha) * d[j - 1] + alpha * d[j];
+				}
+			}
+			out[k] = d[p];
+		}
+	}
+}
+
+
+template<typename Scalar>
+void BezierPatches::extract(const BasicNURBS<Scalar>& surface, BezierPatches& out)
+{
+	using surface_t = BasicNURBS<Scalar>;
+	using hpoint_t  = typename surface_t::hpoint_t;
+	const auto U = surface_t::U, V = surface_t::V;
+
+	const std::vector<size_t>& spansU = surface.spans(U);
+	const std::vector<size_t>& spansV = surface.spans(V);
+	size_t p = surface.degree[U], q = surface.degree[V];
+
+	out.degree[U] = p; out.degree[V] = q;
+	out.count[U]  = spansU.size(); out.count[V] = spansV.size();
+	out.points.resize(out.patchCount() * out.pointsPerPatch());
+	if (out.points.empty()) return;
+
+	auto weighted = [&surface](size_t i)
+	{
+		Scalar w = surface.isRational() ? surface.weights[i] : Scalar(1);
+		return hpoint_t(surface.controlPoints[i] * w, w);
+	};
+
+	// Along U first: every row of the net becomes (p+1) points per span
+	size_t width = spansU.size() * (p + 1);
+	std::vector<hpoint_t> rows(width * surface.dim[V]);
+	Parallel::forEach(0, surface.dim[V], [&](size_t row)
+	{
+		hpoint_t* line = &rows[row * width];
+		for (size_t su = 0; su < spansU.size(); su++)
+		{
+			spanBezier(surface.knots[U], p, spansU[su],
+				[&](size_t i) { return weighted(surface.uv2index(i, row)); }, line + su * (p + 1));
+			// Both are the point at the knot, this way they are the same bit for bit. The knots between
+			// two nonzero spans are all equal, above the degree the curve is discontinuous there
+			if (su > 0 && spansU[su] - spansU[su - 1] <= p) line[su * (p + 1)] = line[su * (p + 1) - 1];
+		}
+	}, 16);
+
+	// Then along V, every column of those into (q+1) points per span
+	size_t stride = out.pointsPerPatch();
+	Parallel::forEach(0, width, [&](size_t column)
+	{
+		size_t su = column / (p + 1), k = column % (p + 1);
+		hpoint_t bezier[surface_t::MAX_DEGREE + 1], previous{};
+		for (size_t sv = 0; sv < spansV.size(); sv++)
+		{
+			spanBezier(surface.knots[V], q, spansV[sv],
+				[&](size_t j) { return rows[j * width + column]; }, bezier);
+			if (sv > 0 && spansV[sv] - spansV[sv - 1] <= q) bezier[0] = previous;
+			previous = bezier[q];
+
+			glm::vec4* patch = &out.points[(su + out.count[U] * sv) * stride];
+			for (size_t l = 0; l <= q; l++) patch[l * (p + 1) + k] = glm::vec4(bezier[l]);
+		}
+	}, 16);
+}
+
+
+template void BezierPatches::extract(const BasicNURBS<float>&,  BezierPatches&);
+template void BezierPatches::extract(const BasicNURBS<double>&, BezierPatches&);
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <vector>
+#include "glm/glm.hpp"
+
+#include "Core/Nurbs.h"
+
+
+// A surface split into its Bezier patches (one per pair of nonzero knot spans), e.g. to be
+// evaluated by GPU tessellation shaders that only need the patch and (u, v) inside it.
+// The edge points two neighbouring patches share are bitwise the same in both of them, unless
+// the knot between them repeats more than the degree and the surface is discontinuous there
+struct BezierPatches
+{
+	size_t degree[2] = { 0, 0 };
+	// Patches along U & V, patch (i, j) is i + count[U] * j as in NURBS::patchSpans
+	size_t count[2]  = { 0, 0 };
+	// Weighted points (w*P, w) of rational and polynomial (w = 1) surfaces alike,
+	// pointsPerPatch() per patch with U changing the fastest
+	std::vector<glm::vec4> points;
+
+	inline size_t patchCount() const     { return count[0] * count[1]; }
+	inline size_t pointsPerPatch() const { return (degree[0] + 1) * (degree[1] + 1); }
+
+	template<typename Scalar>
+	static void extract(const BasicNURBS<Scalar>& surface, BezierPatches& out);
+
+	template<typename Scalar>
+	static inline BezierPatches extract(const BasicNURBS<Scalar>& surface)
+	{
+		BezierPatches patches;
+		extract(surface, patches);
+		return patches;
+	}
+};
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <algorithm>
+#include <limits>
+#include "glm/glm.hpp"
+
+
+// Axis aligned bounding box, empty one has min > max
+template<typename Scalar, int Dim = 3>
+struct BasicAABB
+{
+	using point_t = glm::vec<Dim, Scalar>;
+
+	point_t min = point_t( std::numeric_limits<Scalar>::max());
+	point_t max = point_t(-std::numeric_limits<Scalar>::max());
+
+	BasicAABB() = default;
+	inline BasicAABB(const point_t& min, const point_t& max) : min(min), max(max) {}
+
+	inline bool isEmpty() const { return min[0] > max[0]; }
+
+	inline point_t center() const { return (min + max) / Scalar(2); }
+	inline point_t extent() const { return max - min; }
+
+	inline void expand(const point_t& point)
+	{
+		min = glm::min(min, point);
+		max = glm::max(max, point);
+	}
+	inline void expand(const BasicAABB& other)
+	{
+		min = glm::min(min, other.min);
+		max = glm::max(max, other.max);
+	}
+
+	inline bool contains(const point_t& point) const
+	{
+		for (int i = 0; i < Dim; i++)
+			if (point[i] < min[i] || point[i] > max[i]) return false;
+		return true;
+	}
+	// Whether the point is strictly inside, so removing it can't shrink the box
+	inline bool containsInterior(const point_t& point) const
+	{
+		for (int i = 0; i < Dim; i++)
+			if (point[i] <= min[i] || point[i] >= max[i]) return false;
+		return true;
+	}
+	inline bool overlaps(const BasicAABB& other) const
+	{
+		for (int i = 0; i < Dim; i++)
+			if (other.max[i] < min[i] || other.min[i] > max[i]) return false;
+		return true;
+	}
+
+	// Squared distance from the point to the box (0 inside)
+	inline Scalar distance2(const point_t& point) const
+	{
+		point_t d = glm::max(glm::max(min - point, point - max), point_t(Scalar(0)));
+		return glm::dot(d, d);
+	}
+
+	// Slab test, 'invDir' is 1/direction of the ray.
+	// On hit [tNear, tFar] is narrowed down to the part of the ray inside the box
+	inline bool intersect(const point_t& origin, const point_t& invDir, Scalar& tNear, Scalar& tFar) const
+	{
+		for (int i = 0; i < Dim; i++)
+		{
+			Scalar t0 = (min[i] - origin[i]) * invDir[i];
+			Scalar t1 = (max[i] - origin[i]) * invDir[i];
+			if (t0 > t1) std::swap(t0, t1);
+
+			tNear = std::max(tNear, t0);
+			tFar  = std::min(tFar,  t1);
+			if (tNear > tFar) return false;
+		}
+		return true;
+	}
+};
+
+using AABB  = BasicAABB<float>;
+using AABBd = BasicAABB<double>;
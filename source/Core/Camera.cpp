@@ -0,0 +1,32 @@
+#include "Core/Camera.h"
+
+#include "glm/gtc/matrix_transform.hpp"
+
+
+void Camera::setPerspective(float fovyDegrees, int width, int height, float zNear, float zFar)
+{
+	fovy       = fovyDegrees;
+	viewport   = glm::vec4(0.f, 0.f, float(width), float(height));
+	projection = glm::perspective(glm::radians(fovy), 1.f * width/height, zNear, zFar);
+}
+
+Camera::Ray Camera::unproject(float x, float y) const
+{
+	float windowY = viewport[3] - y;
+
+	glm::vec3 near = glm::unProject(glm::vec3(x, windowY, 0.f), view, projection, viewport);
+	glm::vec3 far  = glm::unProject(glm::vec3(x, windowY, 1.f), view, projection, viewport);
+
+	return { near, glm::normalize(far - near) };
+}
+
+glm::vec2 Camera::project(const glm::vec3& point) const
+{
+	glm::vec3 window = glm::project(point, view, projection, viewport);
+	return { window.x, viewport[3] - window.y };
+}
+
+float Camera::pixelSize(float distance) const
+{
+	return 2.f * distance * std::tan(glm::radians(fovy) / 2.f) / viewport[3];
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "glm/glm.hpp"
+
+
+// Projection & view of the 3D viewport, the view includes the model transform of the surface
+// so rays produced by unproject are in the surface's own coordinates
+struct Camera
+{
+	struct Ray
+	{
+		glm::vec3 origin;
+		glm::vec3 direction;  // normalized
+	};
+
+	glm::mat4 projection = glm::mat4(1.f);
+	glm::mat4 view       = glm::mat4(1.f);
+	glm::vec4 viewport   = glm::vec4(0.f, 0.f, 1.f, 1.f);  // x, y, width, height (GL convention)
+
+	float fovy = 45.f;  // degrees
+
+	void setPerspective(float fovyDegrees, int width, int height, float zNear, float zFar);
+
+	// (x, y) are window coordinates with the origin at the top-left corner
+	Ray unproject(float x, float y) const;
+	glm::vec2 project(const glm::vec3& point) const;
+
+	// World size of a single pixel at the given distance from the eye
+	float pixelSize(float distance) const;
+};
@@ -0,0 +1,131 @@
+#include "Core/DynamicResolution.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+
+DynamicResolution::~DynamicResolution()
+{
+	destroy();
+}
+
+void DynamicResolution::destroy()
+{
+	if (!isReady()) return;
+
+	GLuint renderbuffers[] = { color, depth };
+	glDeleteRenderbuffers(2, renderbuffers);
+	glDeleteFramebuffers(1, &framebuffer);
+	if (hasTimer()) glDeleteQueries(GLsizei(QUERIES), queries);
+	framebuffer = color = depth = 0;
+	for (size_t i = 0; i < QUERIES; i++) queries[i] = 0, pending[i] = false;
+}
+
+bool DynamicResolution::isSupported()
+{
+	return GL::version() >= 30 && glGenFramebuffers && glBlitFramebuffer && glGenRenderbuffers &&
+		glRenderbufferStorage && glFramebufferRenderbuffer && glCheckFramebufferStatus;
+}
+
+void DynamicResolution::init()
+{
+	if (!isSupported())
+		throw std::runtime_error
+		("DynamicResolution::init: framebuffer objects need GL 3.0.");
+
+	glGenFramebuffers(1, &framebuffer);
+	glGenRenderbuffers(1, &color);
+	glGenRenderbuffers(1, &depth);
+
+	// Without timer queries the scale is only set by hand
+	bool timer = (GL::version() >= 33 || GL::hasExtension("GL_ARB_timer_query")) &&
+		glGenQueries && glBeginQuery && glEndQuery && glGetQueryObjectiv && glGetQueryObjectui64v;
+	if (timer) glGenQueries(GLsizei(QUERIES), queries);
+	else automatic = false;
+}
+
+void DynamicResolution::allocate(int width, int height)
+{
+	glBindRenderbuffer(GL_RENDERBUFFER, color);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+	glBindRenderbuffer(GL_RENDERBUFFER, depth);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth);
+	GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	if (status != GL_FRAMEBUFFER_COMPLETE)
+		throw std::runtime_error
+		("DynamicResolution::allocate: incomplete framebuffer.");
+	allocated = glm::ivec2(width, height);
+}
+
+void DynamicResolution::readTimers()
+{
+	// Oldest first, a query that isn't done means the later ones aren't either
+	for (size_t k = 0; k < QUERIES; k++)
+	{
+		size_t i = (frame + k) % QUERIES;
+		if (!pending[i]) continue;
+
+		GLint available = 0;
+		glGetQueryObjectiv(queries[i], GL_QUERY_RESULT_AVAILABLE, &available);
+		if (!available) return;
+
+		GLuint64 nanoseconds = 0;
+		glGetQueryObjectui64v(queries[i], GL_QUERY_RESULT, &nanoseconds);
+		pending[i] = false;
+		gpuTime = float(nanoseconds) * 1e-6f;
+		timedScale = scales[i];
+
+		if (!automatic) continue;
+		// Within 10% of the budget the resolution is kept, so it doesn't flicker
+		float ratio = budget / std::max(gpuTime, 0.01f);
+		if (std::abs(ratio - 1.f) < 0.1f) continue;
+		// Relative to the scale the time is of, queries still in flight from before a change
+		// would shrink (or grow) the already changed scale again otherwise
+		float desired = timedScale * std::sqrt(ratio);
+		scale = std::clamp(scale + (desired - scale) * 0.5f, MIN_SCALE, 1.f);
+	}
+}
+
+glm::ivec2 DynamicResolution::begin(int width, int height)
+{
+	if (hasTimer()) readTimers();
+	if (allocated != glm::ivec2(width, height)) allocate(width, height);
+
+	scale  = std::clamp(scale, MIN_SCALE, 1.f);
+	output = glm::ivec2(width, height);
+	target = glm::max(glm::ivec2(glm::round(glm::vec2(output) * scale)), glm::ivec2(1));
+
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	// A query still in flight from QUERIES frames ago leaves this frame unmeasured
+	if (hasTimer() && !pending[frame % QUERIES])
+	{
+		glBeginQuery(GL_TIME_ELAPSED, queries[frame % QUERIES]);
+		scales[frame % QUERIES] = scale;
+	}
+	return target;
+}
+
+void DynamicResolution::end()
+{
+	size_t i = frame % QUERIES;
+	if (hasTimer() && !pending[i])
+	{
+		glEndQuery(GL_TIME_ELAPSED);
+		pending[i] = true;
+	}
+	frame++;
+
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+	glBlitFramebuffer(0, 0, target.x, target.y, 0, 0, output.x, output.y,
+		GL_COLOR_BUFFER_BIT, (target == output) ? GL_NEAREST : GL_LINEAR);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
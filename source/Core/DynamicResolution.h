@@ -0,0 +1,65 @@
+#pragma once
+
+#include "glm/glm.hpp"
+
+#include "Core/OpenGL.h"
+
+
+// Offscreen target of the 3D viewport (GL 3.0) rendered at a fraction of the framebuffer resolution
+// and upscaled by a linear blit, so the UI drawn after it stays at full resolution.
+// The target is as large as the framebuffer and a frame uses its lower-left part, so changing
+// the scale doesn't reallocate anything.
+//
+// With timer queries (GL 3.3) the scale follows the GPU time of the viewport: the cost grows with
+// the pixel count, so the scale is multiplied by sqrt(budget / time), damped to avoid oscillation.
+// The time is read a few frames late, when the query is done, so measuring never stalls
+class DynamicResolution
+{
+public:
+	static constexpr float MIN_SCALE = 0.25f;
+	static const size_t QUERIES = 3;
+
+	bool automatic = true;
+	float budget = 8.f;  // Milliseconds of GPU time for the viewport
+	float scale  = 1.f;  // Set by the controller when automatic
+
+	DynamicResolution() = default;
+	~DynamicResolution();
+
+	DynamicResolution(const DynamicResolution&) = delete;
+	DynamicResolution& operator=(const DynamicResolution&) = delete;
+
+	static bool isSupported();
+	// Needs a current context with the functions loaded by GL::load.
+	// Throws std::runtime_error if framebuffer objects aren't supported
+	void init();
+	// Deletes the GL objects while their context is current, the destructor only calls it
+	void destroy();
+	inline bool isReady() const { return framebuffer != 0; }
+	inline bool hasTimer() const { return queries[0] != 0; }
+
+	// Binds the target and returns the size to render at (set the viewport to it)
+	glm::ivec2 begin(int width, int height);
+	// Upscales into the default framebuffer and leaves it bound
+	void end();
+
+	// Milliseconds, of the latest frame whose query finished
+	inline float getGPUTime() const { return gpuTime; }
+	// True until a frame at the current scale is timed and leaves it as it is: the controller
+	// reads a few frames late, so drawing has to go on that long after the scale changed
+	inline bool isSettling() const { return automatic && hasTimer() && timedScale != scale; }
+
+private:
+	GLuint framebuffer = 0, color = 0, depth = 0;
+	glm::ivec2 allocated = glm::ivec2(0), target = glm::ivec2(0), output = glm::ivec2(0);
+
+	GLuint queries[QUERIES] = {};
+	bool pending[QUERIES] = {};
+	float scales[QUERIES] = {};
+	float timedScale = 1.f;  // Scale of the frame gpuTime is of
+	size_t frame = 0;
+	float gpuTime = 0.f;
+
+	void allocate(int width, int height);
+	void readTimers();
+};
@@ -0,0 +1,49 @@
+#include "Core/Evaluator.h"
+
+#include <stdexcept>
+#include "Core/Parallel.h"
+
+
+void CPUEvaluator::evaluateSample(size_t i, const glm::vec2& t)
+{
+	NURBS::point_t partials[2];
+	positions[i] = surface->evaluate(t, partials);
+
+	glm::vec3 normal = glm::cross(partials[0], partials[1]);
+	float length = glm::length(normal);
+	normals[i] = (length > 0.f) ? normal / length : glm::vec3(0.f);
+}
+
+void CPUEvaluator::evaluateGrid(const std::vector<float>& u, const std::vector<float>& v)
+{
+	if (!surface)
+		throw std::runtime_error
+		("CPUEvaluator::evaluateGrid: no surface set.");
+
+	size_t columns = u.size();
+	positions.resize(columns * v.size());
+	normals.resize(columns * v.size());
+
+	Parallel::forEach(0, v.size(), [&](size_t j)
+	{
+		for (size_t i = 0; i < columns; i++) evaluateSample(j * columns + i, { u[i], v[j] });
+	}, 16);
+}
+
+void CPUEvaluator::evaluate(const std::vector<glm::vec2>& parameters)
+{
+	if (!surface)
+		throw std::runtime_error
+		("CPUEvaluator::evaluate: no surface set.");
+
+	positions.resize(parameters.size());
+	normals.resize(parameters.size());
+
+	Parallel::forEach(0, parameters.size(), [&](size_t i) { evaluateSample(i, parameters[i]); });
+}
+
+void CPUEvaluator::read(std::vector<glm::vec3>& positions, std::vector<glm::vec3>& normals)
+{
+	positions = this->positions;
+	normals   = this->normals;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <vector>
+#include "glm/glm.hpp"
+
+#include "Core/Nurbs.h"
+
+
+// Batch evaluation of a surface: positions & unit normals at many parameters, either at every
+// pair of a grid (U changing the fastest) or at scattered (u, v) pairs. Backends give the same
+// results through the same calls, so a workload can be run (and timed) on each of them.
+// Evaluation may run asynchronously: isReady tells if the results are there, read waits for them.
+// Normals are left zero where the surface has no tangent plane (poles)
+class Evaluator
+{
+public:
+	virtual ~Evaluator() = default;
+
+	virtual const char* name() const = 0;
+
+	// The surface is read by the later evaluations: edits need another setSurface
+	virtual void setSurface(const NURBS& surface) = 0;
+
+	virtual void evaluateGrid(const std::vector<float>& u, const std::vector<float>& v) = 0;
+	virtual void evaluate(const std::vector<glm::vec2>& parameters) = 0;
+
+	virtual bool isReady() = 0;
+	// Samples of the last evaluation, in the order of its parameters
+	virtual void read(std::vector<glm::vec3>& positions, std::vector<glm::vec3>& normals) = 0;
+};
+
+
+// NURBS::evaluate on all cores, synchronous. Keeps a pointer to the surface,
+// so it has to outlive the evaluations
+class CPUEvaluator : public Evaluator
+{
+	const NURBS* surface = nullptr;
+	std::vector<glm::vec3> positions, normals;
+
+public:
+	inline const char* name() const override { return "CPU"; }
+
+	inline void setSurface(const NURBS& surface) override { this->surface = &surface; }
+
+	void evaluateGrid(const std::vector<float>& u, const std::vector<float>& v) override;
+	void evaluate(const std::vector<glm::vec2>& parameters) override;
+
+	inline bool isReady() override { return true; }
+	void read(std::vector<glm::vec3>& positions, std::vector<glm::vec3>& normals) override;
+
+private:
+	void evaluateSample(size_t i, const glm::vec2& t);
+};
@@ -0,0 +1,182 @@
+#include "Core/FFD.h"
+
+#include <stdexcept>
+#include "Core/Parallel.h"
+
+const float FFD::TOLERANCE = 1e-6f;
+
+
+FFD::lattice_t FFD::createLattice(const Mesh& mesh, size_t dimU, size_t dimV, size_t dimW, float margin)
+{
+	if (mesh.vertices.empty())
+		throw std::invalid_argument
+		("FFD::createLattice: mesh has no vertices.");
+
+	glm::vec3 min, max;
+	min = max = mesh.vertices[0];
+	for (auto& vertex : mesh.vertices)
+	{
+		min = glm::min(min, vertex);
+		max = glm::max(max, vertex);
+	}
+
+	// Flat meshes still need a lattice of nonzero thickness
+	glm::vec3 extent = glm::max(max - min, glm::vec3(1e-3f));
+	min -= extent * margin;
+	max += extent * margin;
+
+	lattice_t lattice(dimU, dimV, dimW);
+	for (size_t i = 0; i < lattice.controlPoints.size(); i++)
+		for (int d = 0; d < 3; d++)
+			lattice.controlPoints[i][d] = min[d] + (max[d] - min[d]) *
+				lattice.index2uv(i, lattice_t::Dim(d)) / float(lattice.dim[d] - 1);
+	lattice.invalidate();
+
+	return lattice;
+}
+
+
+bool FFD::matches(const lattice_t& lattice) const
+{
+	for (int d = 0; d < 3; d++)
+		if (lattice.dim[d] != dim[d] || lattice.degree[d] != degree[d] || lattice.knots[d] != knots[d])
+			return false;
+	return true;
+}
+
+void FFD::bind(const lattice_t& lattice, const Mesh& rest)
+{
+	glm::vec3 boxMin = lattice.bounds().min;
+	glm::vec3 boxMax = lattice.bounds().max;
+
+	for (int d = 0; d < 3; d++)
+	{
+		dim[d]    = lattice.dim[d];
+		degree[d] = lattice.degree[d];
+		knots[d]  = lattice.knots[d];
+		basis[d].resize(rest.vertices.size() * BASIS);
+	}
+	first.resize(rest.vertices.size());
+	offset.resize(rest.vertices.size());
+
+	Parallel::forEach(0, rest.vertices.size(), [&](size_t i)
+	{
+		lattice_t::param_t t = invert(lattice, rest.vertices[i], boxMin, boxMax);
+
+		size_t index[3];
+		for (int d = 0; d < 3; d++)
+		{
+			size_t span = lattice.findSpan(lattice_t::Dim(d), t[d]);
+			lattice.basisFunctions(lattice_t::Dim(d), span, t[d], &basis[d][i * BASIS]);
+			index[d] = span - degree[d];
+		}
+		first[i] = uint32_t(lattice.uvw2index({ index[0], index[1], index[2] }));
+
+		// Zero for the inner vertices, keeps the outer ones rigidly attached to the boundary
+		offset[i] = rest.vertices[i] - lattice.evaluate(t);
+	}, 256);
+}
+
+FFD::lattice_t::param_t FFD::invert(const lattice_t& lattice, const glm::vec3& point,
+	glm::vec3 boxMin, glm::vec3 boxMax) const
+{
+	lattice_t::param_t start, end, t;
+	for (int d = 0; d < 3; d++)
+	{
+		start[d] = lattice.domainStart(lattice_t::Dim(d));
+		end[d]   = lattice.domainEnd(lattice_t::Dim(d));
+
+		// Linear guess, exact for an undistorted uniform lattice
+		float extent = boxMax[d] - boxMin[d];
+		float s = (extent > 0.f) ? (point[d] - boxMin[d]) / extent : 0.5f;
+		t[d] = start[d] + (end[d] - start[d]) * std::clamp(s, 0.f, 1.f);
+	}
+
+	// Newton iteration on L(t) = point, clamped to the domain
+	for (size_t iteration = 0; iteration < MAX_ITERATIONS; iteration++)
+	{
+		lattice_t::point_t partials[3];
+		glm::vec3 residual = point - lattice.evaluate(t, partials);
+		if (glm::dot(residual, residual) < TOLERANCE * TOLERANCE)
+			break;
+
+		glm::mat3 jacobian(partials[0], partials[1], partials[2]);
+		if (std::abs(glm::determinant(jacobian)) < 1e-12f)
+			break;
+
+		lattice_t::param_t next = glm::clamp(t + glm::inverse(jacobian) * residual, start, end);
+		if (next == t) break;  // stuck at the boundary
+		t = next;
+	}
+	return t;
+}
+
+
+void FFD::deform(const lattice_t& lattice, std::vector<glm::vec3>& out) const
+{
+	if (!matches(lattice))
+		throw std::invalid_argument
+		("FFD::deform: lattice layout differs from the one the mesh was bound to, rebind it.");
+
+	out.resize(first.size());
+
+	const size_t p = degree[0] + 1, q = degree[1] + 1, r = degree[2] + 1;
+	const size_t strideV = dim[0], strideW = dim[0] * dim[1];
+	const glm::vec3* cp = lattice.controlPoints.data();
+	const float* weights = lattice.isRational() ? lattice.weights.data() : nullptr;
+
+	Parallel::forChunks(0, first.size(), [&](size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; i++)
+		{
+			const float* Nu = &basis[0][i * BASIS];
+			const float* Nv = &basis[1][i * BASIS];
+			const float* Nw = &basis[2][i * BASIS];
+
+			if (!weights)
+			{
+				glm::vec3 sum(0.f);
+				for (size_t w = 0; w < r; w++)
+				{
+					glm::vec3 layer(0.f);
+					for (size_t v = 0; v < q; v++)
+					{
+						const glm::vec3* row = cp + first[i] + w * strideW + v * strideV;
+
+						glm::vec3 line(0.f);
+						for (size_t u = 0; u < p; u++)
+							line += Nu[u] * row[u];
+						layer += Nv[v] * line;
+					}
+					sum += Nw[w] * layer;
+				}
+				out[i] = sum + offset[i];
+				continue;
+			}
+
+			// Rational lattice: the weighted points (w*P, w) are summed and projected back
+			glm::vec4 sum(0.f);
+			for (size_t w = 0; w < r; w++)
+			{
+				glm::vec4 layer(0.f);
+				for (size_t v = 0; v < q; v++)
+				{
+					size_t row = first[i] + w * strideW + v * strideV;
+
+					glm::vec4 line(0.f);
+					for (size_t u = 0; u < p; u++)
+						line += Nu[u] * weights[row + u] * glm::vec4(cp[row + u], 1.f);
+					layer += Nv[v] * line;
+				}
+				sum += Nw[w] * layer;
+			}
+			out[i] = glm::vec3(sum) / sum.w + offset[i];
+		}
+	});
+}
+
+void FFD::deform(const lattice_t& lattice, Mesh& out, bool recalculateNormals) const
+{
+	deform(lattice, out.vertices);
+	if (recalculateNormals) out.calculateNormals();
+}
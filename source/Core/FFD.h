@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "Core/Mesh.h"
+#include "Core/Nurbs.h"
+
+
+// Free-form deformation of a triangle mesh by a NURBS volume lattice.
+//
+// bind() embeds every vertex of the rest mesh into the lattice once
+// (parametric inversion + per-direction basis functions are cached),
+// so deform() after a lattice edit is only a weighted sum of control points
+// (of the weighted ones, divided by the weight sum, for a rational lattice)
+class FFD
+{
+public:
+	using lattice_t = NURBSVolume;
+
+	static const size_t MAX_ITERATIONS = 20;
+	static const float  TOLERANCE;
+
+private:
+	static const size_t BASIS = lattice_t::MAX_DEGREE + 1;
+
+	// Lattice layout the binding was made for, the cached spans & basis functions depend on the knots too
+	size_t dim[3]    = { 0, 0, 0 };
+	size_t degree[3] = { 0, 0, 0 };
+	std::vector<float> knots[3];
+
+	// Per vertex: index of the first control point of its (p+1)(q+1)(r+1) block,
+	// basis functions stored direction after direction (SoA, stride BASIS)
+	// and the offset of vertices lying outside of the lattice
+	std::vector<uint32_t>  first;
+	std::vector<float>     basis[3];
+	std::vector<glm::vec3> offset;
+
+public:
+	FFD() = default;
+	inline FFD(const lattice_t& lattice, const Mesh& rest) { bind(lattice, rest); }
+
+	// Lattice of the given size enclosing the mesh, 'margin' is relative to its extent
+	static lattice_t createLattice(const Mesh& mesh, size_t dimU, size_t dimV, size_t dimW, float margin = 0.05f);
+
+	void bind(const lattice_t& lattice, const Mesh& rest);
+	inline bool isBound() const { return !first.empty(); }
+	// Whether the lattice still has the layout (dims, degrees & knots) the mesh was bound to
+	bool matches(const lattice_t& lattice) const;
+
+	// Writes deformed positions to 'out.vertices' (topology is left to the caller)
+	void deform(const lattice_t& lattice, Mesh& out, bool recalculateNormals = true) const;
+	void deform(const lattice_t& lattice, std::vector<glm::vec3>& out) const;
+
+private:
+	lattice_t::param_t invert(const lattice_t& lattice, const glm::vec3& point,
+		glm::vec3 boxMin, glm::vec3 boxMax) const;
+};
@@ -0,0 +1,386 @@
+#include "Core/Fitting.h"
+
+#include <cmath>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+#include "Core/LinearAlgebra.h"
+#include "Core/Parallel.h"
+
+
+namespace
+{
+	constexpr size_t ORDER = NURBS::MAX_DEGREE + 1;
+
+	// Dominant eigenvector of a symmetric 3x3 matrix by power iteration
+	glm::dvec3 dominantAxis(const glm::dmat3& m)
+	{
+		// Start from the column of the largest diagonal entry, it can't be orthogonal to the result
+		int start = 0;
+		for (int i = 1; i < 3; i++)
+			if (m[i][i] > m[start][start]) start = i;
+
+		glm::dvec3 axis = m[start];
+		if (glm::length(axis) == 0.0) return glm::dvec3(0.0);
+
+		for (int i = 0; i < 64; i++)
+			axis = glm::normalize(m * axis);
+		return axis;
+	}
+
+	// Averaged (normalized cumulative) parameters along 'count' points of each of 'lines' lines,
+	// point k of line l being points[l * lineStep + k * step]
+	template<typename Scalar>
+	std::vector<Scalar> averagedParameters(const std::vector<glm::vec<3, Scalar>>& points,
+		size_t count, size_t lines, size_t step, size_t lineStep, Fitting::Parameterization type)
+	{
+		std::vector<double> sum(count, 0.0);
+		size_t used = 0;
+		std::mutex mutex;
+
+		Parallel::forChunks(0, lines, [&](size_t first, size_t last)
+		{
+			std::vector<double> localSum(count, 0.0), length(count);
+			size_t localUsed = 0;
+
+			for (size_t l = first; l < last; l++)
+			{
+				const auto* line = &points[l * lineStep];
+				length[0] = 0.0;
+				for (size_t k = 1; k < count; k++)
+				{
+					double d = glm::distance(glm::dvec3(line[k * step]), glm::dvec3(line[(k-1) * step]));
+					if (type == Fitting::Parameterization::CENTRIPETAL) d = std::sqrt(d);
+					length[k] = length[k-1] + d;
+				}
+				// Degenerate lines (e.g. a collapsed pole) carry no information
+				if (length[count-1] <= 0.0) continue;
+
+				for (size_t k = 0; k < count; k++)
+					localSum[k] += length[k] / length[count-1];
+				localUsed++;
+			}
+
+			std::lock_guard lock(mutex);
+			for (size_t k = 0; k < count; k++) sum[k] += localSum[k];
+			used += localUsed;
+		}, 64);
+
+		std::vector<Scalar> result(count);
+		for (size_t k = 0; k < count; k++)
+			result[k] = (used > 0 && type != Fitting::Parameterization::UNIFORM)
+				? Scalar(sum[k] / used) : Scalar(k) / Scalar(count - 1);
+		result.front() = Scalar(0);
+		result.back()  = Scalar(1);
+		return result;
+	}
+
+	// Clamped knots, inner ones being averages of 'degree' consecutive parameters (NURBS Book eq. 9.8)
+	template<typename Scalar>
+	std::vector<Scalar> averagedKnots(const std::vector<Scalar>& params, size_t degree)
+	{
+		size_t n = params.size();
+		std::vector<Scalar> knots(n + degree + 1);
+		for (size_t i = 0; i <= degree; i++)
+		{
+			knots[i]     = Scalar(0);
+			knots[n + i] = Scalar(1);
+		}
+		for (size_t j = 1; j + degree < n; j++)
+		{
+			double sum = 0.0;
+			for (size_t i = j; i < j + degree; i++) sum += params[i];
+			knots[j + degree] = Scalar(sum / degree);
+		}
+		return knots;
+	}
+
+	// Factorized matrix of basis functions of direction d at the parameters
+	template<typename Scalar>
+	BandMatrix<double> collocation(const Fitting::surface_t<Scalar>& surface,
+		typename Fitting::surface_t<Scalar>::Dim d, const std::vector<Scalar>& params)
+	{
+		size_t p = surface.degree[d];
+		BandMatrix<double> matrix(params.size(), p, p);
+
+		Scalar N[ORDER];
+		for (size_t k = 0; k < params.size(); k++)
+		{
+			size_t span = surface.findSpan(d, params[k]);
+			surface.basisFunctions(d, span, params[k], N);
+			for (size_t i = 0; i <= p; i++)
+			{
+				if (N[i] == Scalar(0)) continue;
+				if (!matrix.inBand(k, span - p + i))
+					throw std::runtime_error
+					("Fitting::interpolate: parameters don't fit the knots.");
+				matrix.at(k, span - p + i) = N[i];
+			}
+		}
+
+		matrix.factorize();
+		return matrix;
+	}
+}
+
+
+template<typename Scalar>
+std::vector<Fitting::param_t<Scalar>> Fitting::planarParameters(const std::vector<point_t<Scalar>>& points)
+{
+	std::vector<param_t<Scalar>> params(points.size());
+	if (points.empty()) return params;
+
+	glm::dvec3 center(0.0);
+	for (auto& p : points) center += glm::dvec3(p);
+	center /= double(points.size());
+
+	glm::dmat3 covariance(0.0);
+	for (auto& p : points)
+	{
+		glm::dvec3 d = glm::dvec3(p) - center;
+		covariance += glm::outerProduct(d, d);
+	}
+
+	// The two largest principal axes span the plane
+	glm::dvec3 axisU = dominantAxis(covariance);
+	double lambda = glm::dot(axisU, covariance * axisU);
+	glm::dvec3 axisV = dominantAxis(covariance - lambda * glm::outerProduct(axisU, axisU));
+
+	// Collinear or coincident points still get some valid plane
+	if (glm::length(axisU) == 0.0) axisU = { 1.0, 0.0, 0.0 };
+	if (glm::length(axisV) == 0.0 || std::abs(glm::dot(axisU, axisV)) > 0.5)
+	{
+		glm::dvec3 helper = (std::abs(axisU.x) < 0.9) ? glm::dvec3(1.0, 0.0, 0.0) : glm::dvec3(0.0, 1.0, 0.0);
+		axisV = glm::normalize(glm::cross(axisU, helper));
+	}
+
+	glm::dvec2 min( std::numeric_limits<double>::max());
+	glm::dvec2 max(-std::numeric_limits<double>::max());
+	std::vector<glm::dvec2> projected(points.size());
+	for (size_t i = 0; i < points.size(); i++)
+	{
+		glm::dvec3 d = glm::dvec3(points[i]) - center;
+		projected[i] = { glm::dot(d, axisU), glm::dot(d, axisV) };
+		min = glm::min(min, projected[i]);
+		max = glm::max(max, projected[i]);
+	}
+
+	glm::dvec2 extent = glm::max(max - min, glm::dvec2(1e-12));
+	for (size_t i = 0; i < points.size(); i++)
+		params[i] = param_t<Scalar>((projected[i] - min) / extent);
+	return params;
+}
+
+template<typename Scalar>
+void Fitting::gridParameters(const std::vector<point_t<Scalar>>& points, size_t sizeU, size_t sizeV,
+	std::vector<Scalar>& u, std::vector<Scalar>& v, Parameterization type)
+{
+	if (sizeU < 2 || sizeV < 2 || points.size() != sizeU * sizeV)
+		throw std::invalid_argument
+		("Fitting::gridParameters: points don't form a sizeU x sizeV grid.");
+
+	u = averagedParameters(points, sizeU, sizeV, 1, sizeU, type);
+	v = averagedParameters(points, sizeV, sizeU, sizeU, 1, type);
+}
+
+template<typename Scalar>
+std::vector<Fitting::param_t<Scalar>> Fitting::gridParameters(const std::vector<point_t<Scalar>>& points,
+	size_t sizeU, size_t sizeV, Parameterization type)
+{
+	std::vector<Scalar> u, v;
+	gridParameters(points, sizeU, sizeV, u, v, type);
+
+	std::vector<param_t<Scalar>> params(points.size());
+	for (size_t j = 0; j < sizeV; j++)
+		for (size_t i = 0; i < sizeU; i++)
+			params[j * sizeU + i] = { u[i], v[j] };
+	return params;
+}
+
+
+template<typename Scalar>
+void Fitting::approximate(surface_t<Scalar>& surface, const std::vector<point_t<Scalar>>& points,
+	const std::vector<param_t<Scalar>>& params, double smoothing)
+{
+	using nurbs_t = surface_t<Scalar>;
+
+	if (points.empty() || points.size() != params.size())
+		throw std::invalid_argument
+		("Fitting::approximate: every point needs exactly one parameter pair.");
+
+	const size_t dimU = surface.dim[nurbs_t::U], dimV = surface.dim[nurbs_t::V];
+	const size_t p = surface.degree[nurbs_t::U], q = surface.degree[nurbs_t::V];
+
+	// Unknowns are numbered along the shorter direction first, which keeps the band narrow
+	const bool uMajor = dimU > dimV;
+	const size_t band = uMajor ? p * dimV + q : q * dimU + p;
+	auto unknown = [&](size_t u, size_t v) { return uMajor ? u * dimV + v : v * dimU + u; };
+
+	const size_t count = dimU * dimV;
+	SymmetricBandMatrix<double> normal(count, band);
+	std::vector<glm::dvec3> rhs(count, glm::dvec3(0.0));
+
+	Scalar start[2], length[2];
+	for (int d = 0; d < 2; d++)
+	{
+		start[d]  = surface.domainStart(typename nurbs_t::Dim(d));
+		length[d] = surface.domainEnd(typename nurbs_t::Dim(d)) - start[d];
+	}
+
+	// A point only touches the rows of the degree + 1 control point rows of its span in the major
+	// direction of the numbering. Points are bucketed by that span and summed in blocks of at least
+	// degree + 1 spans: even blocks, then odd ones, so blocks summed at the same time write disjoint
+	// rows of the one matrix
+	const auto outer = uMajor ? nurbs_t::U : nurbs_t::V;
+	const size_t outerDim = surface.dim[outer], outerDegree = surface.degree[outer];
+
+	std::vector<size_t> spans(points.size());
+	Parallel::forEach(0, points.size(), [&](size_t k)
+	{ spans[k] = surface.findSpan(outer, start[outer] + length[outer] * params[k][outer]); }, 16384);
+
+	// Counting sort of the points by span
+	std::vector<size_t> spanStart(outerDim + 1, 0);
+	for (size_t span : spans) spanStart[span + 1]++;
+	for (size_t s = 0; s < outerDim; s++) spanStart[s + 1] += spanStart[s];
+
+	std::vector<size_t> order(points.size());
+	{
+		std::vector<size_t> fill(spanStart.begin(), spanStart.end() - 1);
+		for (size_t k = 0; k < points.size(); k++) order[fill[spans[k]]++] = k;
+	}
+
+	const size_t spanCount = outerDim - outerDegree, wanted = 2 * Parallel::threadCount();
+	const size_t blockSpans = std::max(outerDegree + 1, (spanCount + wanted - 1) / wanted);
+	const size_t blocks = (spanCount + blockSpans - 1) / blockSpans;
+
+	auto sumBlock = [&](size_t block)
+	{
+		Scalar N[2][ORDER];
+		size_t index[ORDER * ORDER];
+		double weight[ORDER * ORDER];
+
+		size_t firstSpan = outerDegree + block * blockSpans;
+		size_t lastSpan  = std::min(outerDim, firstSpan + blockSpans);
+		for (size_t o = spanStart[firstSpan]; o < spanStart[lastSpan]; o++)
+		{
+			size_t k = order[o];
+			size_t span[2];
+			for (int d = 0; d < 2; d++)
+			{
+				Scalar t = start[d] + length[d] * params[k][d];
+				span[d] = (d == outer) ? spans[k] : surface.findSpan(typename nurbs_t::Dim(d), t);
+				surface.basisFunctions(typename nurbs_t::Dim(d), span[d], t, N[d]);
+			}
+
+			size_t n = 0;
+			for (size_t j = 0; j <= q; j++)
+				for (size_t i = 0; i <= p; i++, n++)
+				{
+					index[n]  = unknown(span[0] - p + i, span[1] - q + j);
+					weight[n] = double(N[0][i]) * double(N[1][j]);
+				}
+
+			glm::dvec3 point(points[k]);
+			for (size_t a = 0; a < n; a++)
+			{
+				rhs[index[a]] += weight[a] * point;
+				for (size_t b = 0; b < n; b++)
+					if (index[b] <= index[a])
+						normal.at(index[a], index[b]) += weight[a] * weight[b];
+			}
+		}
+	};
+	for (size_t parity = 0; parity < 2; parity++)
+		Parallel::forEach(0, (blocks + 1 - parity) / 2, [&](size_t i) { sumBlock(2 * i + parity); }, 1);
+
+	// Membrane energy sum |P_a - P_b|^2 over neighbouring control points, scaled to the data term
+	double trace = 0.0;
+	for (size_t i = 0; i < count; i++) trace += normal.at(i, i);
+	double lambda = std::max(smoothing * trace / double(count), 1e-12);
+
+	auto link = [&](size_t a, size_t b)
+	{
+		if (a < b) std::swap(a, b);
+		normal.at(a, a) += lambda;
+		normal.at(b, b) += lambda;
+		normal.at(a, b) -= lambda;
+	};
+	for (size_t v = 0; v < dimV; v++)
+		for (size_t u = 0; u < dimU; u++)
+		{
+			if (u + 1 < dimU) link(unknown(u, v), unknown(u+1, v));
+			if (v + 1 < dimV) link(unknown(u, v), unknown(u, v+1));
+		}
+
+	normal.factorize();
+	normal.solve(rhs);
+
+	for (size_t v = 0; v < dimV; v++)
+		for (size_t u = 0; u < dimU; u++)
+			surface.controlPoints[surface.uv2index(u, v)] = point_t<Scalar>(rhs[unknown(u, v)]);
+	surface.invalidate();
+}
+
+template<typename Scalar>
+Fitting::surface_t<Scalar> Fitting::interpolate(const std::vector<point_t<Scalar>>& points, size_t sizeU, size_t sizeV,
+	size_t degreeU, size_t degreeV, Parameterization type)
+{
+	using nurbs_t = surface_t<Scalar>;
+
+	std::vector<Scalar> u, v;
+	gridParameters(points, sizeU, sizeV, u, v, type);
+
+	nurbs_t result(sizeU, sizeV);
+	result.setDegree(nurbs_t::U, degreeU);
+	result.setDegree(nurbs_t::V, degreeV);
+	result.setKnots(nurbs_t::U, averagedKnots(u, result.degree[nurbs_t::U]));
+	result.setKnots(nurbs_t::V, averagedKnots(v, result.degree[nurbs_t::V]));
+
+	BandMatrix<double> rows    = collocation(result, nurbs_t::U, u);
+	BandMatrix<double> columns = collocation(result, nurbs_t::V, v);
+
+	// Rows give the intermediate points of the columns, these give the control points
+	std::vector<glm::dvec3> net(points.size());
+	for (size_t i = 0; i < points.size(); i++) net[i] = glm::dvec3(points[i]);
+
+	Parallel::forEach(0, sizeV, [&](size_t j) { rows.solve(&net[j * sizeU]); }, 64);
+	Parallel::forEach(0, sizeU, [&](size_t i) { columns.solve(&net[i], sizeU); }, 64);
+
+	for (size_t i = 0; i < net.size(); i++)
+		result.controlPoints[i] = point_t<Scalar>(net[i]);
+	result.invalidate();
+	return result;
+}
+
+template<typename Scalar>
+Fitting::surface_t<Scalar> Fitting::fit(const std::vector<point_t<Scalar>>& points, size_t dimU, size_t dimV,
+	size_t degreeU, size_t degreeV, double smoothing)
+{
+	using nurbs_t = surface_t<Scalar>;
+
+	nurbs_t result(dimU, dimV);
+	result.setDegree(nurbs_t::U, degreeU);
+	result.setDegree(nurbs_t::V, degreeV);
+
+	approximate(result, points, planarParameters(points), smoothing);
+	return result;
+}
+
+
+#define FITTING_INSTANTIATE(Scalar) \
+	template std::vector<Fitting::param_t<Scalar>> Fitting::planarParameters(const std::vector<point_t<Scalar>>&); \
+	template void Fitting::gridParameters(const std::vector<point_t<Scalar>>&, size_t, size_t, \
+		std::vector<Scalar>&, std::vector<Scalar>&, Parameterization); \
+	template std::vector<Fitting::param_t<Scalar>> Fitting::gridParameters(const std::vector<point_t<Scalar>>&, \
+		size_t, size_t, Parameterization); \
+	template void Fitting::approximate(surface_t<Scalar>&, const std::vector<point_t<Scalar>>&, \
+		const std::vector<param_t<Scalar>>&, double); \
+	template Fitting::surface_t<Scalar> Fitting::interpolate(const std::vector<point_t<Scalar>>&, size_t, size_t, \
+		size_t, size_t, Parameterization); \
+	template Fitting::surface_t<Scalar> Fitting::fit(const std::vector<point_t<Scalar>>&, size_t, size_t, \
+		size_t, size_t, double);
+
+FITTING_INSTANTIATE(float)
+FITTING_INSTANTIATE(double)
+
+#undef FITTING_INSTANTIATE
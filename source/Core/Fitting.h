@@ -0,0 +1,62 @@
+#pragma once
+
+#include <vector>
+#include "glm/glm.hpp"
+
+#include "Core/Nurbs.h"
+
+
+// Construction of NURBS surfaces from measured data.
+//
+// Parameters of the data points are normalized to [0, 1] in both directions
+// and mapped onto the domain of the surface they are fitted with
+namespace Fitting
+{
+	template<typename Scalar> using surface_t = BasicNURBS<Scalar, 3, 2>;
+	template<typename Scalar> using point_t   = glm::vec<3, Scalar>;
+	template<typename Scalar> using param_t   = glm::vec<2, Scalar>;
+
+	enum class Parameterization { UNIFORM, CHORD_LENGTH, CENTRIPETAL };
+
+	// Weight of the membrane energy of the control net relative to the data term.
+	// Keeps the system solvable when some patches contain no data points
+	static constexpr double DEFAULT_SMOOTHING = 1e-4;
+
+	// Scattered points: projection onto their best fitting plane
+	template<typename Scalar>
+	std::vector<param_t<Scalar>> planarParameters(const std::vector<point_t<Scalar>>& points);
+
+	// Grid of sizeU x sizeV points (U changing the fastest): parameters of a row/column
+	// averaged over all of them, 'u' gets sizeU and 'v' sizeV values
+	template<typename Scalar>
+	void gridParameters(const std::vector<point_t<Scalar>>& points, size_t sizeU, size_t sizeV,
+		std::vector<Scalar>& u, std::vector<Scalar>& v, Parameterization type = Parameterization::CHORD_LENGTH);
+	// Same, expanded to a parameter pair per point
+	template<typename Scalar>
+	std::vector<param_t<Scalar>> gridParameters(const std::vector<point_t<Scalar>>& points, size_t sizeU, size_t sizeV,
+		Parameterization type = Parameterization::CHORD_LENGTH);
+
+	// Least squares fit of the control points of 'surface' (its dims, degrees and knots are kept).
+	// Normal equations are assembled in parallel into a symmetric band matrix, ordered along
+	// the shorter direction of the net (threads sum points of knot spans that touch disjoint rows,
+	// no copies of the matrix), and solved by banded Cholesky:
+	// O(points * order^4) assembly, O(dimU * dimV * min(dimU, dimV)^2 * degree^2) solve
+	template<typename Scalar>
+	void approximate(surface_t<Scalar>& surface, const std::vector<point_t<Scalar>>& points,
+		const std::vector<param_t<Scalar>>& params, double smoothing = DEFAULT_SMOOTHING);
+
+	// Surface through every point of a sizeU x sizeV grid, one control point per data point,
+	// with knots averaged from the parameters. The banded collocation system of a direction is
+	// factorized once and solved for all rows, then for all columns, each pass in parallel:
+	// O(sizeU * sizeV * degree) after O((sizeU + sizeV) * degree^2) factorization
+	template<typename Scalar>
+	surface_t<Scalar> interpolate(const std::vector<point_t<Scalar>>& points, size_t sizeU, size_t sizeV,
+		size_t degreeU = surface_t<Scalar>::DEFAULT_DEGREE, size_t degreeV = surface_t<Scalar>::DEFAULT_DEGREE,
+		Parameterization type = Parameterization::CHORD_LENGTH);
+
+	// New dimU x dimV surface approximating scattered points
+	template<typename Scalar>
+	surface_t<Scalar> fit(const std::vector<point_t<Scalar>>& points, size_t dimU, size_t dimV,
+		size_t degreeU = surface_t<Scalar>::DEFAULT_DEGREE, size_t degreeV = surface_t<Scalar>::DEFAULT_DEGREE,
+		double smoothing = DEFAULT_SMOOTHING);
+}
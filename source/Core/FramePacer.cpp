@@ -0,0 +1,152 @@
+#include "Core/FramePacer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <string_view>
+#include <thread>
+
+#include "Core/OpenGL.h"
+
+
+namespace
+{
+	double seconds()
+	{
+		using namespace std::chrono;
+		return duration<double>(steady_clock::now().time_since_epoch()).count();
+	}
+}
+
+
+FramePacer::FramePacer() : origin(seconds())
+{
+	frames.reserve(HISTORY);
+}
+
+void FramePacer::setVSync(bool enabled)
+{
+	vsync = enabled;
+	glfwSwapInterval(vsync ? 1 : 0);
+}
+
+double FramePacer::now() const
+{
+	return seconds() - origin;
+}
+
+void FramePacer::inputEvent()
+{
+	if (pendingInput < 0.0) pendingInput = now();
+}
+
+void FramePacer::waitForFrame()
+{
+	if (limit <= 0) return;
+
+	double period = 1.0 / limit;
+	double time = now();
+	// A missed deadline restarts the schedule instead of rushing frames to catch up
+	deadline = (time > deadline + period) ? time : deadline + period;
+
+	if (deadline - time > SPIN_MARGIN)
+		std::this_thread::sleep_for(std::chrono::duration<double>(deadline - time - SPIN_MARGIN));
+	while (now() < deadline) std::this_thread::yield();
+}
+
+void FramePacer::beginFrame()
+{
+	frameStart = now();
+}
+
+void FramePacer::endFrame()
+{
+	if (finishAfterSwap) glFinish();
+
+	double end = now();
+	Frame frame;
+	frame.start    = frameStart;
+	frame.interval = (previousStart < 0.0) ? -1.0 : frameStart - previousStart;
+	frame.work     = end - frameStart;
+	frame.latency  = (pendingInput < 0.0) ? -1.0 : end - pendingInput;
+
+	previousStart = frameStart;
+	pendingInput  = -1.0;
+
+	if (frames.size() < HISTORY) frames.push_back(frame);
+	else frames[next] = frame;
+	next = (next + 1) % HISTORY;
+	total++;
+}
+
+FramePacer::Summary FramePacer::summarize(std::vector<double> values)
+{
+	Summary summary;
+	summary.count = values.size();
+	if (values.empty()) return summary;
+
+	double sum = 0.0;
+	for (double v : values) sum += v;
+	summary.average = sum / values.size() * 1e3;
+	summary.max = *std::max_element(values.begin(), values.end()) * 1e3;
+
+	auto p99 = values.begin() + (values.size() - 1) * 99 / 100;
+	std::nth_element(values.begin(), p99, values.end());
+	summary.p99 = *p99 * 1e3;
+	return summary;
+}
+
+FramePacer::Statistics FramePacer::statistics() const
+{
+	std::vector<double> intervals, work, latency;
+	for (const Frame& frame : frames)
+	{
+		if (frame.interval >= 0.0) intervals.push_back(frame.interval);
+		work.push_back(frame.work);
+		if (frame.latency >= 0.0) latency.push_back(frame.latency);
+	}
+
+	Statistics statistics;
+	statistics.interval = summarize(std::move(intervals));
+	statistics.work     = summarize(std::move(work));
+	statistics.latency  = summarize(std::move(latency));
+	return statistics;
+}
+
+std::vector<FramePacer::Frame> FramePacer::history() const
+{
+	if (frames.size() < HISTORY) return frames;
+
+	std::vector<Frame> ordered(frames.begin() + next, frames.end());
+	ordered.insert(ordered.end(), frames.begin(), frames.begin() + next);
+	return ordered;
+}
+
+void FramePacer::exportCSV(const std::string& path) const
+{
+	std::ofstream out(path, std::ios::trunc);
+	if (!out)
+		throw std::runtime_error
+		("FramePacer::exportCSV: can't create " + path);
+
+	std::vector<Frame> ordered = history();
+	size_t first = total - ordered.size();
+
+	out << "frame,start_s,interval_ms,work_ms,latency_ms\n";
+	char line[128];
+	for (size_t i = 0; i < ordered.size(); i++)
+	{
+		const Frame& f = ordered[i];
+		int length = std::snprintf(line, sizeof(line), "%zu,%.6f,", first + i, f.start);
+		if (f.interval >= 0.0) length += std::snprintf(line + length, sizeof(line) - length, "%.3f", f.interval * 1e3);
+		length += std::snprintf(line + length, sizeof(line) - length, ",%.3f,", f.work * 1e3);
+		if (f.latency >= 0.0) length += std::snprintf(line + length, sizeof(line) - length, "%.3f", f.latency * 1e3);
+		out << std::string_view(line, length) << '\n';
+	}
+
+	if (!out)
+		throw std::runtime_error
+		("FramePacer::exportCSV: failed to write " + path);
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+
+// Frame pacing of the main loop: vsync, an optional frame rate limit and frame time & latency numbers.
+//
+// The limiter waits at the start of a frame, before the events are polled, so input is read as
+// late as possible. It sleeps until SPIN_MARGIN before the deadline (OS sleeps overshoot by a
+// scheduler tick) and spins the rest.
+//
+// Latency is measured from the first input event a frame handles to the return of its swap (or of
+// a glFinish after it, with finishAfterSwap). Events are stamped when GLFW dispatches them, which
+// for polled events is up to a frame after they arrived, and the scanout after the swap isn't
+// visible to the app, so the numbers are a lower bound of input-to-photon latency
+class FramePacer
+{
+public:
+	static constexpr double SPIN_MARGIN = 0.002;  // Seconds
+	static const size_t HISTORY = 600;            // Frames kept for the statistics & export
+
+	struct Frame
+	{
+		double start;     // Seconds since the pacer was made
+		double interval;  // Since the previous frame's start, negative after an idle gap
+		double work;      // Start to the swap (& glFinish) return
+		double latency;   // Negative without input
+	};
+
+	struct Summary
+	{
+		double average = 0, p99 = 0, max = 0;  // Milliseconds
+		size_t count = 0;
+	};
+
+	struct Statistics
+	{
+		Summary interval, work, latency;
+	};
+
+	bool finishAfterSwap = false;
+	// Frames per second, 0 - no limit
+	int limit = 0;
+
+	FramePacer();
+
+	// Takes effect for the current context (glfwSwapInterval)
+	void setVSync(bool enabled);
+	inline bool isVSync() const { return vsync; }
+
+	double now() const;
+
+	// Call from the input callbacks
+	void inputEvent();
+	// Loop skipped frames (idle rendering), the next interval isn't a frame time
+	inline void idle() { previousStart = -1.0; }
+
+	// Limiter, call before polling the events of a frame that will be drawn
+	void waitForFrame();
+	void beginFrame();
+	// Right after the swap
+	void endFrame();
+
+	// Over the frames in the history
+	Statistics statistics() const;
+	// Oldest first
+	std::vector<Frame> history() const;
+
+	// frame, start, interval, work & latency (ms) per line, an empty latency for frames without input.
+	// Throws std::runtime_error if the file can't be written
+	void exportCSV(const std::string& path) const;
+
+private:
+	bool vsync = true;
+	double origin;
+
+	double deadline = 0.0;
+	double previousStart = -1.0, frameStart = 0.0;
+	double pendingInput = -1.0;
+
+	std::vector<Frame> frames;  // Ring of HISTORY
+	size_t next = 0, total = 0;
+
+	static Summary summarize(std::vector<double> values);
+};
@@ -0,0 +1,212 @@
+#include "Core/GLUTessellator.h"
+
+#include <array>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// GLU 1.2 headers (Windows) don't have the tessellator mode, the values are the same everywhere
+#ifndef GLU_NURBS_MODE
+	#define GLU_NURBS_MODE              100160
+	#define GLU_NURBS_TESSELLATOR       100161
+	#define GLU_NURBS_RENDERER          100162
+	#define GLU_NURBS_BEGIN             100164
+	#define GLU_NURBS_VERTEX            100165
+	#define GLU_NURBS_NORMAL            100166
+	#define GLU_NURBS_END               100169
+	#define GLU_PARAMETRIC_TOLERANCE    100202
+	#define GLU_OBJECT_PARAMETRIC_ERROR 100208
+#endif
+
+
+namespace
+{
+	// Position & normal bits, the vertices GLU repeats between primitives have the same ones
+	using Key = std::array<float, 6>;
+
+	struct KeyHash
+	{
+		size_t operator()(const Key& key) const
+		{
+			uint32_t bits[6];
+			std::memcpy(bits, key.data(), sizeof(bits));
+			size_t hash = 0;
+			for (uint32_t b : bits) hash = hash * 0x9E3779B97F4A7C15ull + b;
+			return hash ^ (hash >> 29);
+		}
+	};
+
+	struct KeyEqual
+	{
+		bool operator()(const Key& a, const Key& b) const
+		{ return std::memcmp(a.data(), b.data(), sizeof(Key)) == 0; }
+	};
+
+	struct Capture
+	{
+		Mesh* mesh = nullptr;
+		std::unordered_map<Key, uint32_t, KeyHash, KeyEqual> indices;
+
+		GLenum type = 0;
+		std::vector<uint32_t> primitive;
+		glm::vec3 normal = glm::vec3(0.f);
+		GLenum error = 0;
+
+		void triangle(uint32_t a, uint32_t b, uint32_t c)
+		{
+			// Fans GLU makes at collapsed patch edges have zero area ones
+			if (a == b || b == c || c == a) return;
+			mesh->indices.insert(mesh->indices.end(), { a, b, c });
+		}
+	};
+	// Callbacks without user data (gluNurbsCallbackData is GLU 1.3 as well), so the state is per thread
+	thread_local Capture* capture = nullptr;
+
+	void begin(GLenum type)
+	{
+		capture->type = type;
+		capture->primitive.clear();
+	}
+
+	void normal(GLfloat* n)
+	{
+		capture->normal = glm::vec3(n[0], n[1], n[2]);
+	}
+
+	void vertex(GLfloat* v)
+	{
+		Mesh& mesh = *capture->mesh;
+		glm::vec3 position(v[0], v[1], v[2]);
+		const glm::vec3& n = capture->normal;
+
+		auto [it, inserted] = capture->indices.try_emplace(Key{ position.x, position.y, position.z, n.x, n.y, n.z },
+			uint32_t(mesh.vertices.size()));
+		if (inserted)
+		{
+			mesh.vertices.push_back(position);
+			mesh.normals.push_back(n);
+		}
+		capture->primitive.push_back(it->second);
+	}
+
+	void end()
+	{
+		const std::vector<uint32_t>& p = capture->primitive;
+		size_t n = p.size();
+
+		switch (capture->type)
+		{
+		case GL_TRIANGLES:
+			for (size_t i = 2; i < n; i += 3) capture->triangle(p[i-2], p[i-1], p[i]);
+			break;
+		case GL_TRIANGLE_STRIP:
+			// Every other triangle is flipped to keep the winding
+			for (size_t i = 2; i < n; i++)
+				if (i % 2 == 0) capture->triangle(p[i-2], p[i-1], p[i]);
+				else            capture->triangle(p[i-1], p[i-2], p[i]);
+			break;
+		case GL_TRIANGLE_FAN:
+			for (size_t i = 2; i < n; i++) capture->triangle(p[0], p[i-1], p[i]);
+			break;
+		case GL_QUADS:
+			for (size_t i = 3; i < n; i += 4)
+			{
+				capture->triangle(p[i-3], p[i-2], p[i-1]);
+				capture->triangle(p[i-3], p[i-1], p[i]);
+			}
+			break;
+		case GL_QUAD_STRIP:
+			// Quad i is (2i, 2i+1, 2i+3, 2i+2)
+			for (size_t i = 3; i < n; i += 2)
+			{
+				capture->triangle(p[i-3], p[i-2], p[i]);
+				capture->triangle(p[i-3], p[i], p[i-1]);
+			}
+			break;
+		default:
+			// Lines & points only come in the outline display modes
+			break;
+		}
+	}
+
+	void error(GLenum code)
+	{
+		if (!capture->error) capture->error = code;
+	}
+
+	// GLU's callback type differs between the headers, but it's a plain function pointer in all of them
+	template<typename Function>
+	void setCallback(GLUnurbs* renderer, GLenum which, Function* function)
+	{
+		using Callback = void (*)();
+		gluNurbsCallback(renderer, which, reinterpret_cast<Callback>(function));
+	}
+}
+
+
+bool GLUTessellator::isSupported()
+{
+	const char* version = reinterpret_cast<const char*>(gluGetString(GLU_VERSION));
+	if (!version) return false;
+
+	char* minor = nullptr;
+	long major = std::strtol(version, &minor, 10);
+	return major > 1 || (major == 1 && *minor == '.' && std::strtol(minor + 1, nullptr, 10) >= 3);
+}
+
+void GLUTessellator::tessellate(GLUnurbs* renderer, const NURBS& surface, Mesh& out, float tolerance)
+{
+	if (!isSupported())
+		throw std::runtime_error
+		("GLUTessellator::tessellate: GLU 1.3 is required.");
+
+	Capture state;
+	state.mesh = &out;
+	out.clear();
+	capture = &state;
+
+	gluNurbsProperty(renderer, GLU_NURBS_MODE, GLU_NURBS_TESSELLATOR);
+	gluNurbsProperty(renderer, GLU_SAMPLING_METHOD, GLU_OBJECT_PARAMETRIC_ERROR);
+	gluNurbsProperty(renderer, GLU_PARAMETRIC_TOLERANCE, tolerance * glm::length(surface.bounds().extent()));
+	setCallback(renderer, GLU_NURBS_BEGIN,  begin);
+	setCallback(renderer, GLU_NURBS_VERTEX, vertex);
+	setCallback(renderer, GLU_NURBS_NORMAL, normal);
+	setCallback(renderer, GLU_NURBS_END,    end);
+	setCallback(renderer, GLU_ERROR,        error);
+
+	// Rational surfaces are passed to GLU as weighted (w*P, w) points
+	std::vector<NURBS::hpoint_t> homogeneous;
+	if (surface.isRational())
+	{
+		homogeneous.resize(surface.controlPoints.size());
+		for (size_t i = 0; i < homogeneous.size(); i++)
+			homogeneous[i] = NURBS::hpoint_t(surface.controlPoints[i] * surface.weights[i], surface.weights[i]);
+	}
+	GLint stride = surface.isRational() ? 4 : 3;
+
+	// GLU takes non-const pointers, but doesn't write through them
+	gluBeginSurface(renderer);
+	gluNurbsSurface(renderer,
+		GLint(surface.knots[NURBS::U].size()), const_cast<float*>(surface.knots[NURBS::U].data()),
+		GLint(surface.knots[NURBS::V].size()), const_cast<float*>(surface.knots[NURBS::V].data()),
+		stride, stride * GLint(surface.dim[NURBS::U]),
+		surface.isRational() ? &homogeneous[0][0] : const_cast<float*>(&surface.controlPoints[0][0]),
+		GLint(surface.getOrder(NURBS::U)), GLint(surface.getOrder(NURBS::V)),
+		surface.isRational() ? GL_MAP2_VERTEX_4 : GL_MAP2_VERTEX_3);
+	gluEndSurface(renderer);
+
+	setCallback(renderer, GLU_ERROR, static_cast<void (*)()>(nullptr));
+	gluNurbsProperty(renderer, GLU_NURBS_MODE, GLU_NURBS_RENDERER);
+	gluNurbsProperty(renderer, GLU_SAMPLING_METHOD, GLU_PATH_LENGTH);
+	capture = nullptr;
+
+	if (state.error)
+	{
+		out.clear();
+		throw std::runtime_error
+		(std::string("GLUTessellator::tessellate: ") + reinterpret_cast<const char*>(gluErrorString(state.error)));
+	}
+}
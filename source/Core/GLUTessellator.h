@@ -0,0 +1,25 @@
+#pragma once
+
+#include "Core/Mesh.h"
+#include "Core/Nurbs.h"
+#include "Core/OpenGL.h"
+
+
+// GLU's NURBS tessellation captured into a mesh: in GLU_NURBS_TESSELLATOR mode (GLU 1.3) the
+// primitives aren't drawn but passed back through callbacks, the triangles, strips, fans and
+// quad strips are split into an indexed triangle list (shared vertices merged) with GLU's normals.
+// Sampling is in object space, so the mesh doesn't depend on the view and stays valid until
+// the surface changes
+class GLUTessellator
+{
+public:
+	// Parametric error in fractions of the control net's bounding box diagonal
+	static constexpr float DEFAULT_TOLERANCE = 0.002f;
+
+	// Windows' GLU is 1.2, which draws only
+	static bool isSupported();
+
+	// Sets the mode, sampling & callbacks of the renderer for the call and restores drawing
+	// (with GLU's default sampling) after it. Throws std::runtime_error if GLU reports an error
+	static void tessellate(GLUnurbs* renderer, const NURBS& surface, Mesh& out, float tolerance = DEFAULT_TOLERANCE);
+};
@@ -0,0 +1,334 @@
+#include "Core/GPUEvaluator.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+
+namespace
+{
+	// Span search & basis functions are the ones of BasicNURBS (The NURBS Book, A2.2 & A2.3),
+	// clamped the same way. Polynomial surfaces have unit weights and skip the division
+	const char* EVALUATE = R"(#version 430
+		layout(local_size_x = 64) in;
+
+		layout(std430, binding = 0) readonly  buffer Knots      { float knots[]; };
+		layout(std430, binding = 1) readonly  buffer Points     { vec4 points[]; };
+		layout(std430, binding = 2) readonly  buffer Parameters { float parameters[]; };
+		layout(std430, binding = 3) writeonly buffer Samples    { vec4 samples[]; };
+
+		const int MAX_ORDER = 8;
+
+		uniform ivec2 dim;
+		uniform ivec2 degree;
+		uniform int vKnots;   // Index of the first V knot
+		uniform bool rational;
+		uniform int first;    // Sample of the first invocation
+		uniform int count;
+		uniform int columns;  // Grid: u values followed by v values, 0: (u, v) pairs
+
+		int findSpan(int k, int p, int n, float t)
+		{
+			if (t >= knots[k+n])
+			{
+				int span = n - 1;
+				while (span > p && knots[k+span] == knots[k+n]) span--;
+				return span;
+			}
+			if (t <= knots[k+p]) return p;
+
+			// knots[low] <= t < knots[high]
+			int low = p, high = n;
+			while (high - low > 1)
+			{
+				int middle = (low + high) / 2;
+				if (t < knots[k+middle]) high = middle;
+				else low = middle;
+			}
+			return low;
+		}
+
+		void basis(int k, int span, int p, float t, out float N[MAX_ORDER], out float dN[MAX_ORDER])
+		{
+			float left[MAX_ORDER], right[MAX_ORDER], lower[MAX_ORDER];
+
+			N[0] = 1.0;
+			lower[0] = 1.0;
+			for (int j = 1; j <= p; j++)
+			{
+				left[j]  = t - knots[k+span+1-j];
+				right[j] = knots[k+span+j] - t;
+
+				if (j == p)
+					for (int r = 0; r < p; r++) lower[r] = N[r];
+
+				float saved = 0.0;
+				for (int r = 0; r < j; r++)
+				{
+					float denom = right[r+1] + left[j-r];
+					float temp  = (denom != 0.0) ? N[r] / denom : 0.0;
+
+					N[r]  = saved + right[r+1] * temp;
+					saved = left[j-r] * temp;
+				}
+				N[j] = saved;
+			}
+
+			for (int r = 0; r <= p; r++)
+			{
+				float value = 0.0;
+				if (r > 0)
+				{
+					float a = knots[k+span+r] - knots[k+span-p+r];
+					if (a != 0.0) value += lower[r-1] / a;
+				}
+				if (r < p)
+				{
+					float b = knots[k+span+r+1] - knots[k+span-p+r+1];
+					if (b != 0.0) value -= lower[r] / b;
+				}
+				dN[r] = value * float(p);
+			}
+		}
+
+		void main()
+		{
+			int i = first + int(gl_GlobalInvocationID.x);
+			if (i >= count) return;
+
+			vec2 t = (columns > 0) ?
+				vec2(parameters[i % columns], parameters[columns + i / columns]) :
+				vec2(parameters[2*i], parameters[2*i+1]);
+
+			int p = degree.x, q = degree.y;
+			int spanU = findSpan(0, p, dim.x, t.x);
+			int spanV = findSpan(vKnots, q, dim.y, t.y);
+
+			float Nu[MAX_ORDER], dNu[MAX_ORDER], Nv[MAX_ORDER], dNv[MAX_ORDER];
+			basis(0, spanU, p, t.x, Nu, dNu);
+			basis(vKnots, spanV, q, t.y, Nv, dNv);
+
+			vec4 S = vec4(0.0), Su = vec4(0.0), Sv = vec4(0.0);
+			for (int l = 0; l <= q; l++)
+			{
+				int row = (spanV - q + l) * dim.x + spanU - p;
+				vec4 A = vec4(0.0), dA = vec4(0.0);
+				for (int k = 0; k <= p; k++)
+				{
+					vec4 P = points[row + k];
+					A  += Nu[k] * P;
+					dA += dNu[k] * P;
+				}
+				S  += Nv[l] * A;
+				Su += Nv[l] * dA;
+				Sv += dNv[l] * A;
+			}
+
+			vec3 position = S.xyz, dU = Su.xyz, dV = Sv.xyz;
+			if (rational)
+			{
+				// Quotient rule on S = A/w: dS = (dA - dw * S) / w
+				position = S.xyz / S.w;
+				dU = (Su.xyz - Su.w * position) / S.w;
+				dV = (Sv.xyz - Sv.w * position) / S.w;
+			}
+			vec3 normal = cross(dU, dV);
+			float size = length(normal);
+
+			samples[2*i]   = vec4(position, 1.0);
+			samples[2*i+1] = vec4((size > 0.0) ? normal / size : vec3(0.0), 0.0);
+		}
+	)";
+
+	// Guaranteed minimum of GL_MAX_COMPUTE_WORK_GROUP_COUNT
+	const size_t MAX_GROUPS = 65535;
+}
+
+
+GPUEvaluator::~GPUEvaluator()
+{
+	destroy();
+}
+
+bool GPUEvaluator::isSupported()
+{
+	return GL::version() >= 43 && glDispatchCompute && glMemoryBarrier && glBindBufferBase && glGetBufferSubData;
+}
+
+void GPUEvaluator::init()
+{
+	if (!isSupported())
+		throw std::runtime_error
+		("GPUEvaluator::init: compute shaders need GL 4.3.");
+
+	destroy();
+	shader = Shader({ { GL_COMPUTE_SHADER, EVALUATE } });
+
+	uniformDim      = shader.uniform("dim");
+	uniformDegree   = shader.uniform("degree");
+	uniformVKnots   = shader.uniform("vKnots");
+	uniformRational = shader.uniform("rational");
+	uniformFirst    = shader.uniform("first");
+	uniformCount    = shader.uniform("count");
+	uniformColumns  = shader.uniform("columns");
+
+	GLuint buffers[4];
+	glGenBuffers(4, buffers);
+	knotBuffer      = buffers[KNOTS];
+	pointBuffer     = buffers[POINTS];
+	parameterBuffer = buffers[PARAMETERS];
+	outputBuffer    = buffers[SAMPLES];
+}
+
+void GPUEvaluator::destroy()
+{
+	if (!isValid()) return;
+
+	wait();
+	GLuint buffers[] = { knotBuffer, pointBuffer, parameterBuffer, outputBuffer };
+	glDeleteBuffers(4, buffers);
+	knotBuffer = pointBuffer = parameterBuffer = outputBuffer = 0;
+	outputCapacity = 0;
+	shader = Shader();
+
+	hasSurface = false;
+	count = 0;
+}
+
+void GPUEvaluator::setSurface(const NURBS& surface)
+{
+	if (!isValid())
+		throw std::runtime_error
+		("GPUEvaluator::setSurface: not initialized.");
+
+	std::vector<float> knots = surface.knots[NURBS::U];
+	knots.insert(knots.end(), surface.knots[NURBS::V].begin(), surface.knots[NURBS::V].end());
+
+	std::vector<glm::vec4> points(surface.controlPoints.size());
+	for (size_t i = 0; i < points.size(); i++)
+	{
+		float w = surface.isRational() ? surface.weights[i] : 1.f;
+		points[i] = glm::vec4(surface.controlPoints[i] * w, w);
+	}
+
+	// Buffers may still be read by a queued evaluation, glBufferData orphans them
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, knotBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, GLsizeiptr(knots.size() * sizeof(float)), knots.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, pointBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, GLsizeiptr(points.size() * sizeof(glm::vec4)), points.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	shader.use();
+	glUniform2i(uniformDim, GLint(surface.dim[NURBS::U]), GLint(surface.dim[NURBS::V]));
+	glUniform2i(uniformDegree, GLint(surface.degree[NURBS::U]), GLint(surface.degree[NURBS::V]));
+	glUniform1i(uniformVKnots, GLint(surface.knots[NURBS::U].size()));
+	glUniform1i(uniformRational, surface.isRational());
+	glUseProgram(0);
+
+	hasSurface = true;
+}
+
+void GPUEvaluator::evaluateGrid(const std::vector<float>& u, const std::vector<float>& v)
+{
+	if (!hasSurface)
+		throw std::runtime_error
+		("GPUEvaluator::evaluateGrid: no surface set.");
+
+	std::vector<float> parameters(u);
+	parameters.insert(parameters.end(), v.begin(), v.end());
+	dispatch(parameters.data(), parameters.size(), u.size() * v.size(), u.size());
+}
+
+void GPUEvaluator::evaluate(const std::vector<glm::vec2>& parameters)
+{
+	if (!hasSurface)
+		throw std::runtime_error
+		("GPUEvaluator::evaluate: no surface set.");
+
+	dispatch(reinterpret_cast<const float*>(parameters.data()), parameters.size() * 2, parameters.size(), 0);
+}
+
+void GPUEvaluator::dispatch(const float* parameters, size_t floats, size_t samples, size_t columns)
+{
+	if (fence)
+	{
+		glDeleteSync(fence);
+		fence = nullptr;
+	}
+	count = samples;
+	if (count == 0) return;
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, parameterBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, GLsizeiptr(floats * sizeof(float)), parameters, GL_STREAM_DRAW);
+	// Kept while it's large enough, so a vertex array reading it stays valid
+	if (count > outputCapacity)
+	{
+		outputCapacity = count;
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, outputBuffer);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, GLsizeiptr(outputCapacity * SAMPLE_STRIDE), nullptr, GL_DYNAMIC_COPY);
+	}
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, KNOTS, knotBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, POINTS, pointBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, PARAMETERS, parameterBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SAMPLES, outputBuffer);
+
+	shader.use();
+	glUniform1i(uniformCount, GLint(count));
+	glUniform1i(uniformColumns, GLint(columns));
+	// Larger sets than a single dispatch can cover are split
+	for (size_t first = 0; first < count; first += MAX_GROUPS * GROUP_SIZE)
+	{
+		size_t groups = std::min(MAX_GROUPS, (count - first + GROUP_SIZE - 1) / GROUP_SIZE);
+		glUniform1i(uniformFirst, GLint(first));
+		glDispatchCompute(GLuint(groups), 1, 1);
+	}
+	glUseProgram(0);
+
+	// Samples are next read as vertices or by glGetBufferSubData
+	glMemoryBarrier(GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+	fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+bool GPUEvaluator::isReady()
+{
+	if (!fence) return true;
+
+	GLenum result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+	if (result == GL_TIMEOUT_EXPIRED) return false;
+
+	glDeleteSync(fence);
+	fence = nullptr;
+	return true;
+}
+
+void GPUEvaluator::wait()
+{
+	if (!fence) return;
+
+	const GLuint64 SECOND = 1000000000;
+	while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, SECOND) == GL_TIMEOUT_EXPIRED);
+	glDeleteSync(fence);
+	fence = nullptr;
+}
+
+void GPUEvaluator::read(std::vector<glm::vec3>& positions, std::vector<glm::vec3>& normals)
+{
+	wait();
+
+	std::vector<glm::vec4> samples(count * 2);
+	if (count)
+	{
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, outputBuffer);
+		glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, GLsizeiptr(count * SAMPLE_STRIDE), samples.data());
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	}
+
+	positions.resize(count);
+	normals.resize(count);
+	for (size_t i = 0; i < count; i++)
+	{
+		positions[i] = glm::vec3(samples[2*i]);
+		normals[i]   = glm::vec3(samples[2*i+1]);
+	}
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <vector>
+#include "glm/glm.hpp"
+
+#include "Core/Evaluator.h"
+#include "Core/Nurbs.h"
+#include "Core/OpenGL.h"
+#include "Core/Shader.h"
+
+
+// Compute shader backend (GL 4.3, which llvmpipe has). Knots, weighted control points and
+// parameters are kept in shader storage buffers, every invocation evaluates one sample into
+// the output buffer as two vec4s: (position, 1) and (normal, 0).
+// The output can be bound directly as a vertex buffer (SAMPLE_STRIDE, *_OFFSET) or read back:
+// an evaluation only queues the dispatches and a fence behind them, so the CPU is free until
+// read, and isReady polls the fence without waiting
+class GPUEvaluator : public Evaluator
+{
+public:
+	static const size_t GROUP_SIZE = 64;
+	static const size_t SAMPLE_STRIDE = 2 * sizeof(glm::vec4), POSITION_OFFSET = 0, NORMAL_OFFSET = sizeof(glm::vec4);
+
+	GPUEvaluator() = default;
+	~GPUEvaluator();
+
+	GPUEvaluator(const GPUEvaluator&) = delete;
+	GPUEvaluator& operator=(const GPUEvaluator&) = delete;
+
+	static bool isSupported();
+	// Needs a current context with the functions loaded by GL::load.
+	// Throws std::runtime_error if it isn't supported or the shader can't be built
+	void init();
+	inline bool isValid() const { return shader.isValid(); }
+	// Deletes the GL objects while their context is current, the destructor only calls it
+	void destroy();
+
+	inline const char* name() const override { return "GPU (compute)"; }
+
+	// Uploads the knots & control points, the surface isn't referenced later
+	void setSurface(const NURBS& surface) override;
+
+	void evaluateGrid(const std::vector<float>& u, const std::vector<float>& v) override;
+	void evaluate(const std::vector<glm::vec2>& parameters) override;
+
+	bool isReady() override;
+	void read(std::vector<glm::vec3>& positions, std::vector<glm::vec3>& normals) override;
+
+	// Written by the last evaluation, valid for the GPU to read right after it
+	inline GLuint getOutputBuffer() const { return outputBuffer; }
+	inline size_t getSampleCount() const { return count; }
+
+private:
+	enum Binding : GLuint { KNOTS, POINTS, PARAMETERS, SAMPLES };
+
+	Shader shader;
+	GLint uniformDim = -1, uniformDegree = -1, uniformVKnots = -1, uniformRational = -1;
+	GLint uniformFirst = -1, uniformCount = -1, uniformColumns = -1;
+
+	GLuint knotBuffer = 0, pointBuffer = 0, parameterBuffer = 0, outputBuffer = 0;
+	size_t outputCapacity = 0;
+	GLsync fence = nullptr;
+
+	bool hasSurface = false;
+	size_t count = 0;
+
+	// columns > 0 - the parameters are the grid's u values followed by its v values,
+	// 0 - they are (u, v) pairs
+	void dispatch(const float* parameters, size_t floats, size_t samples, size_t columns);
+	void wait();
+};
@@ -1,10 +1,22 @@
 #include "Core/GUI.h"
 #include "Core/Window.h"
+#include "Core/GLUTessellator.h"
+#include "Core/MeshExport.h"
+#include "Core/Tessellator.h"
+
+#include <filesystem>
+
+#include "glm/gtc/matrix_transform.hpp"
+#include "glm/gtc/type_ptr.hpp"
 
 
 void GUI::init(Window* window)
 {
+	framePacer = &window->getFramePacer();
+	float yScale;
+	glfwGetWindowContentScale(window->window, &uiScale, &yScale);
 	setRenderer();
+	setSurfaceRenderer();
 
 	// Setup Dear ImGui context
 	IMGUI_CHECKVERSION();
@@ -22,10 +34,27 @@ void GUI::init(Window* window)
 
 	ImGuiStyle& style = ImGui::GetStyle();
 	style.WindowBorderSize = style.ScrollbarRounding = style.TabRounding = 0.f;
+	style.ScaleAllSizes(uiScale);
+
+	if (std::filesystem::exists(DEFAULT_SCENE)) loadScene(DEFAULT_SCENE);
 }
 
 GUI::~GUI()
 {
+	shutdown();
+}
+
+void GUI::shutdown()
+{
+	surfaceRenderer.destroy();
+	dynamicResolution.destroy();
+	if (renderer)
+	{
+		gluDeleteNurbsRenderer((GLUnurbs*)renderer);
+		renderer = nullptr;
+	}
+
+	if (!ImGui::GetCurrentContext()) return;
 	ImGui_ImplOpenGL3_Shutdown();
 	ImGui_ImplGlfw_Shutdown();
 
@@ -42,26 +71,83 @@ void GUI::setCP()
 
 void GUI::mainloop(int width, int height, float time)
 {
+	// A long pause (e.g. the turntable switched on after idling) doesn't jump the view
+	if (turntable) turntableAngle += std::min(time - lastFrameTime, 0.1f) * TURNTABLE_SPEED;
+	lastFrameTime = time;
+
 	// Start the Dear ImGui frame
 	ImGui_ImplOpenGL3_NewFrame();
 	ImGui_ImplGlfw_NewFrame();
 	ImGui::NewFrame();
 
+	pickViewport();
 	NURBSSurfaceManager();
+	if (showPacingOverlay) framePacingOverlay();
 	ImGui::Render();
 
 	ImGui::EndFrame();
 
-	drawNURBS(width, height, time);
+	drawNURBS(width, height);
 
 	ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+
+	drawnRevision = nurbs.getRevision();
+	if (redrawFrames > 0) redrawFrames--;
+	framesDrawn++;
+}
+
+bool GUI::needsRedraw(float time) const
+{
+	if (redrawFrames > 0 || turntable || nurbs.getRevision() != drawnRevision) return true;
+	// The scale lowered during a drag is raised by the frames after it, timed a few frames late
+	if (dynamicRendering && dynamicResolution.isSettling()) return true;
+
+	// Blinking text cursor & delayed tooltips change without input
+	const ImGuiIO& imguiIO = ImGui::GetIO();
+	return (imguiIO.WantTextInput || imguiIO.WantCaptureMouse) && time - lastFrameTime >= float(IDLE_TIMEOUT);
+}
+
+
+void GUI::setControlPoint(size_t i, glm::vec3 cp)
+{
+	nurbs.setControlPoint(i, cp);
+	picker.controlPointMoved(nurbs, i);
+	if (!legacyRendering) surfaceRenderer.controlPointMoved(nurbs, i);
+}
+
+void GUI::pickViewport()
+{
+	surfaceHovered = false;
+	if (cpSelected >= nurbs.controlPoints.size())
+		cpSelected = NO_SELECTION;
+
+	ImGuiIO& imguiIO = ImGui::GetIO();
+	if (imguiIO.WantCaptureMouse) return;
+
+	// ImGui is in window coordinates, the camera in framebuffer pixels
+	glm::vec2 cursor(imguiIO.MousePos.x * imguiIO.DisplayFramebufferScale.x,
+		imguiIO.MousePos.y * imguiIO.DisplayFramebufferScale.y);
+	bool clicked = ImGui::IsMouseClicked(ImGuiMouseButton_Left);
+
+	Picker::PointHit pointHit;
+	if (showPoints && picker.pickPoint(nurbs, camera, cursor, pointHit))
+	{
+		cpFocused = &nurbs.controlPoints[pointHit.index];
+		if (clicked) cpSelected = pointHit.index;
+		return;
+	}
+
+	surfaceHovered = picker.pickSurface(nurbs, camera, cursor, surfaceHit);
+	if (clicked) cpSelected = NO_SELECTION;
 }
 
 
 void GUI::NURBSSurfaceManager()
 {
-	ImGui::SetNextWindowSize( {256, 680} );
-	ImGui::SetNextWindowPos( {1024, 20} );
+	ImVec2 display = ImGui::GetIO().DisplaySize;
+	float width = PANEL_WIDTH * uiScale, margin = PANEL_MARGIN * uiScale;
+	ImGui::SetNextWindowSize( {width, std::max(display.y - 2.f * margin, margin)} );
+	ImGui::SetNextWindowPos( {std::max(display.x - width, 0.f), margin} );
 	ImGui::Begin("NURBS Surface Manager", nullptr,
 		ImGuiWindowFlags_HorizontalScrollbar |
 		ImGuiWindowFlags_NoResize |
@@ -92,6 +178,20 @@ void GUI::NURBSSurfaceManager()
 
 	ImGui::Spacing(); ImGui::Separator();
 	ImGui::Text("CONTROL POINTS"); ImGui::Spacing();
+	if (cpSelected != NO_SELECTION)
+	{
+		ImGui::Text("Selected in viewport:");
+		glm::vec3 cp = nurbs.controlPoints[cpSelected];
+
+		if (ImGui::DragFloat3(concat(cpSelected, dim).c_str(), &cp[0], dragV))
+			setControlPoint(cpSelected, cp);
+		ImGui::Spacing();
+	}
+	if (surfaceHovered)
+	{
+		ImGui::Text("Surface at U %.3f, V %.3f", surfaceHit.uv[NURBS::U], surfaceHit.uv[NURBS::V]);
+		ImGui::Spacing();
+	}
 	if (ImGui::CollapsingHeader("Coordinates"))
 	{
 		ImGui::Spacing();
@@ -99,11 +199,13 @@ void GUI::NURBSSurfaceManager()
 
 		for (size_t i = 0; i < nurbs.controlPoints.size(); i++)
 		{
-			glm::vec3 &cp = nurbs.controlPoints[i];
+			// Edited through a copy, so the net can keep its cached bounds up to date
+			glm::vec3 cp = nurbs.controlPoints[i];
 
-			ImGui::DragFloat3(concat(i, dim).c_str(), & cp[0], dragV);
+			if (ImGui::DragFloat3(concat(i, dim).c_str(), &cp[0], dragV))
+				setControlPoint(i, cp);
 			if (ImGui::IsItemHovered() || ImGui::IsItemFocused())
-				cpFocused = &cp;
+				cpFocused = &nurbs.controlPoints[i];
 		}
 		ImGui::Spacing();
 	}
@@ -121,7 +223,7 @@ void GUI::NURBSSurfaceManager()
 			{
 				ImGui::Spacing();
 
-				bool dimIsMax = nurbs.dim[dim] >= NURBS::MAX_DIM;
+				bool dimIsMax = nurbs.dim[dim] >= MAX_DIM;
 				if (dimIsMax)
 					ImGui::Text("Max %s dimension reached!", NURBS::dim_char[dim]);
 				else
@@ -156,6 +258,7 @@ void GUI::NURBSSurfaceManager()
 				ImGui::Spacing();
 				if (ImGui::Button("Insert", ImVec2(165, 0)))
 				{
+					cpSelected = NO_SELECTION;
 					nurbs.insertDim(dim, layer[0][dim], controlPoints[dim]);
 					if (layer[0][dim]) layer[0][dim]++;
 				}
@@ -179,6 +282,7 @@ void GUI::NURBSSurfaceManager()
 				ImGui::Spacing();
 				if (ImGui::Button("Delete", ImVec2(165, 0)))
 				{
+					cpSelected = NO_SELECTION;
 					nurbs.removeDim(dim, layer[1][dim]);
 					if (layer[1][dim]) layer[1][dim]--;
 				}
@@ -192,6 +296,25 @@ void GUI::NURBSSurfaceManager()
 
 	ImGui::Spacing(); ImGui::Separator();
 	ImGui::Text("MISCELLANEOUS"); ImGui::Spacing();
+	if (ImGui::CollapsingHeader("File"))
+	{
+		ImGui::Text("Scene (.json)");
+		ImGui::InputText("##Scene Path", scenePath, sizeof(scenePath));
+		if (ImGui::Button("Save##Scene")) saveScene();
+		ImGui::SameLine();
+		if (ImGui::Button("Load##Scene")) loadScene(scenePath);
+
+		ImGui::Spacing(); ImGui::Text("Surface (.cwn)");
+		ImGui::InputText("##Path", filePath, sizeof(filePath));
+		if (ImGui::Button("Save")) saveSurface();
+		ImGui::SameLine();
+		if (ImGui::Button("Load")) loadSurface();
+
+		ImGui::Spacing(); ImGui::Text("Mesh (.obj, .stl, .glb)");
+		ImGui::InputText("##Mesh Path", meshPath, sizeof(meshPath));
+		if (ImGui::Button("Export")) exportMesh();
+		if (!fileStatus.empty()) ImGui::TextWrapped("%s", fileStatus.c_str());
+	}
 	if (ImGui::CollapsingHeader("Appearance"))
 	{
 		ImGui::Text("Background Color");
@@ -203,65 +326,395 @@ void GUI::NURBSSurfaceManager()
 		ImGui::ColorEdit3("Nearby", &Color::POINT_NEARBY[0]);
 		ImGui::ColorEdit3("Insert", &Color::POINT_INSERT[0]);
 		ImGui::ColorEdit3("Delete", &Color::POINT_DELETE[0]);
+		ImGui::ColorEdit3("Control Net", &Color::CONTROL_NET[0]);
 
 		ImGui::Spacing();
 		ImGui::Checkbox("Show Points?", &showPoints);
+		ImGui::Checkbox("Show Control Net?", &showNet);
+		ImGui::Checkbox("Turntable", &turntable);
+		ImGui::Checkbox("Redraw Only On Changes", &idleRendering);
+		ImGui::Text("%zu frames drawn", framesDrawn);
+
+		// Without the shader path (GL < 3.0) only the legacy one is left
+		ImGui::BeginDisabled(!surfaceRenderer.isReady());
+		ImGui::Checkbox("Legacy Rendering (GLU)", &legacyRendering);
+		ImGui::EndDisabled();
+		if (!surfaceRenderer.isReady()) ImGui::TextWrapped("Shader rendering isn't available");
+		else if (!legacyRendering)
+		{
+			// Tessellation shaders need GL 4.0
+			bool gpuTessellation = surfaceRenderer.isGPUTessellation();
+			ImGui::BeginDisabled(!surfaceRenderer.hasGPUTessellation());
+			if (ImGui::Checkbox("GPU Tessellation", &gpuTessellation))
+				surfaceRenderer.setGPUTessellation(gpuTessellation);
+			ImGui::EndDisabled();
+
+			if (gpuTessellation)
+			{
+				ImGui::SliderFloat("Edge Pixels", &surfaceRenderer.edgePixels, 2.f, 32.f, "%.0f");
+				ImGui::Text("%zu patches", surfaceRenderer.getStatistics().patches);
+			}
+			else
+			{
+				ImGui::Text("%zu triangles", surfaceRenderer.getStatistics().triangles);
+				if (surfaceRenderer.isStreaming())
+					ImGui::Text("Streaming, %zu stalls", surfaceRenderer.getRingStatistics().stalls);
+			}
+		}
+	}
+	if (ImGui::CollapsingHeader("Frame Pacing"))
+		framePacingSettings();
+	if (ImGui::CollapsingHeader("Resolution"))
+		resolutionSettings();
+
+	ImGui::End();
+}
+
+void GUI::resolutionSettings()
+{
+	ImGui::BeginDisabled(!dynamicResolution.isReady());
+	ImGui::Checkbox("Dynamic Resolution", &dynamicRendering);
+	ImGui::EndDisabled();
+	if (!dynamicResolution.isReady())
+	{
+		ImGui::TextWrapped("Framebuffer objects aren't available");
+		return;
+	}
+	if (!dynamicRendering) return;
+
+	// Without timer queries the scale is only set by hand
+	ImGui::BeginDisabled(!dynamicResolution.hasTimer());
+	ImGui::Checkbox("Automatic", &dynamicResolution.automatic);
+	ImGui::EndDisabled();
+
+	if (dynamicResolution.automatic)
+	{
+		ImGui::SliderFloat("Budget (ms)", &dynamicResolution.budget, 1.f, 33.f, "%.1f");
+		ImGui::Text("Scale %.0f%%", dynamicResolution.scale * 100.f);
+	}
+	else ImGui::SliderFloat("Scale", &dynamicResolution.scale, DynamicResolution::MIN_SCALE, 1.f, "%.2f");
+	if (dynamicResolution.hasTimer())
+		ImGui::Text("Viewport %.2f ms GPU", dynamicResolution.getGPUTime());
+}
+
+void GUI::framePacingSettings()
+{
+	bool vsync = framePacer->isVSync();
+	if (ImGui::Checkbox("VSync", &vsync)) framePacer->setVSync(vsync);
+	ImGui::SliderInt("FPS Limit", &framePacer->limit, 0, 240, framePacer->limit ? "%d" : "Off");
+	ImGui::Checkbox("Wait For GPU After Swap", &framePacer->finishAfterSwap);
+	ImGui::Checkbox("Show Overlay", &showPacingOverlay);
+
+	ImGui::Spacing(); ImGui::Text("Last %zu frames (.csv)", FramePacer::HISTORY);
+	ImGui::InputText("##Pacing Path", pacingPath, sizeof(pacingPath));
+	if (ImGui::Button("Export Frames"))
+	{
+		try
+		{
+			framePacer->exportCSV(pacingPath);
+			pacingStatus = std::string("Exported to ") + pacingPath;
+		}
+		catch (const std::exception& e) { pacingStatus = e.what(); }
 	}
+	if (!pacingStatus.empty()) ImGui::TextWrapped("%s", pacingStatus.c_str());
+}
+
+void GUI::framePacingOverlay()
+{
+	FramePacer::Statistics statistics = framePacer->statistics();
+	auto line = [](const char* name, const FramePacer::Summary& summary)
+	{ ImGui::Text("%-8s %6.2f avg %6.2f p99 %6.2f max ms", name, summary.average, summary.p99, summary.max); };
+
+	ImGui::SetNextWindowPos( {10, 10} );
+	ImGui::SetNextWindowBgAlpha(0.5f);
+	ImGui::Begin("Frame Pacing", nullptr,
+		ImGuiWindowFlags_NoDecoration |
+		ImGuiWindowFlags_AlwaysAutoResize |
+		ImGuiWindowFlags_NoSavedSettings |
+		ImGuiWindowFlags_NoFocusOnAppearing |
+		ImGuiWindowFlags_NoNav |
+		ImGuiWindowFlags_NoMove
+	);
+
+	double fps = (statistics.interval.average > 0.0) ? 1e3 / statistics.interval.average : 0.0;
+	ImGui::Text("%.1f FPS, vsync %s, limit %s", fps, framePacer->isVSync() ? "on" : "off",
+		framePacer->limit ? std::to_string(framePacer->limit).c_str() : "off");
+	line("Interval", statistics.interval);
+	line("Work",     statistics.work);
+	line("Latency",  statistics.latency);
 
 	ImGui::End();
 }
 
-void GUI::drawNURBS(int width, int height, float time)
+void GUI::setSurface(NURBS surface)
+{
+	nurbs = std::move(surface);
+	cpSelected = NO_SELECTION;
+	cpFocused  = nullptr;
+	picker     = Picker();
+	surfaceRenderer.invalidate();
+	legacyRevision = NO_REVISION;
+	setCP();
+}
+
+void GUI::loadScene(const std::string& path)
 {
-	float ratio = 1.f * width/height;
+	try
+	{
+		// Colors the scene doesn't mention stay as they are
+		Scene scene;
+		scene.appearance = getAppearance();
+		Scene::read(path, scene);
+
+		setAppearance(scene.appearance);
+		if (!scene.surfaces.empty()) setSurface(std::move(scene.surfaces.front()));
+		fileStatus = "Loaded " + path;
+		if (scene.surfaces.size() > 1)
+			fileStatus += " (first of " + std::to_string(scene.surfaces.size()) + " surfaces)";
+	}
+	catch (const std::exception& e) { fileStatus = e.what(); }
+}
+
+void GUI::saveScene()
+{
+	try
+	{
+		Scene scene;
+		scene.appearance = getAppearance();
+		scene.surfaces.push_back(nurbs);
+		Scene::write(scenePath, scene);
+		fileStatus = "Saved";
+	}
+	catch (const std::exception& e) { fileStatus = e.what(); }
+}
+
+void GUI::saveSurface()
+{
+	try
+	{
+		SurfaceFile::write<float, 2>(filePath, { &nurbs });
+		fileStatus = "Saved";
+	}
+	catch (const std::exception& e) { fileStatus = e.what(); }
+}
+
+void GUI::loadSurface()
+{
+	try
+	{
+		SurfaceFile file(filePath);
+		if (file.size() == 0)
+			throw std::runtime_error("File has no surfaces");
+
+		setSurface(file.load<float, 2>(0));
+		fileStatus = "Loaded";
+	}
+	catch (const std::exception& e) { fileStatus = e.what(); }
+}
+
+void GUI::exportMesh()
+{
+	try
+	{
+		MeshExport::write(Tessellator::tessellate(nurbs), meshPath);
+		fileStatus = "Exported";
+	}
+	catch (const std::exception& e) { fileStatus = e.what(); }
+}
+
+
+void GUI::drawNURBS(int width, int height)
+{
+	glEnable(GL_DEPTH_TEST);
+
+	glm::ivec2 viewport(width, height);
+	if (dynamicRendering)
+	{
+		try { viewport = dynamicResolution.begin(width, height); }
+		catch (const std::exception& e)
+		{
+			std::cerr << e.what() << "\nGUI::drawNURBS: rendering at full resolution\n";
+			dynamicRendering = false;
+		}
+	}
+	pixelScale = float(viewport.x) / float(width);
+
+	glViewport(0, 0, viewport.x, viewport.y);
+	Color::set4(glClearColor, Color::BACKGROUND);
 
+	// Kept as matrices (not glRotate & co) so the viewport can be picked with the same camera
+	camera.setPerspective(45.f, width, height, 0.1f, 100.f);
+	camera.view = glm::translate(glm::mat4(1.f), glm::vec3(-1.4f, 0.f, -10.f));
+	camera.view = glm::rotate(camera.view, glm::radians(-60.f), glm::vec3(1.f, 0.f, 0.f));
+	camera.view = glm::rotate(camera.view, glm::radians(turntableAngle), glm::vec3(0.f, 0.f, 1.f));
+
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+	if (legacyRendering)
+	{
+		drawSurfaceLegacy();
+		if (showNet)    drawNetLegacy();
+		if (showPoints) drawPointsLegacy();
+	}
+	else
+	{
+		surfaceRenderer.update(nurbs);
+		surfaceRenderer.drawSurface(camera);
+		if (showNet)    surfaceRenderer.drawNet(camera, Color::CONTROL_NET);
+		if (showPoints) drawPoints();
+	}
+
+	if (dynamicRendering)
+	{
+		dynamicResolution.end();
+		glViewport(0, 0, width, height);
+	}
+	glFlush();
+}
+
+void GUI::drawSurfaceLegacy()
+{
 	glEnable(GL_LIGHTING);
 	glEnable(GL_LIGHT0);
-	glEnable(GL_DEPTH_TEST);
 	glEnable(GL_AUTO_NORMAL);
 	glEnable(GL_NORMALIZE);
 
-	glViewport(0, 0, width, height);
-	Color::set4(glClearColor, Color::BACKGROUND);
-
 	glMatrixMode(GL_PROJECTION);
-	glLoadIdentity();
-	gluPerspective(45.0, 1.f * width/height, 0.1, 100.0);
+	glLoadMatrixf(glm::value_ptr(camera.projection));
 
 	glMatrixMode(GL_MODELVIEW);
-	glLoadIdentity();
-	glTranslatef(-1.4, 0.0, -10.0);
+	glLoadMatrixf(glm::value_ptr(camera.view));
 
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	GLUnurbs* r = (GLUnurbs*)renderer;
 
-	glPushMatrix();
-	glRotatef(-60.f, 1.f, 0.f, 0.f);
-	glRotatef(time*6.f, 0.f, 0.f, 1.f);
+	if (legacyCapture)
+	{
+		try
+		{
+			if (legacyRevision != nurbs.getRevision())
+			{
+				GLUTessellator::tessellate(r, nurbs, legacyMesh);
+				legacyRevision = nurbs.getRevision();
+			}
+			drawMeshLegacy();
+			return;
+		}
+		catch (const std::runtime_error& e)
+		{
+			std::cerr << e.what() << "\nGUI::drawSurfaceLegacy: tessellating with GLU every frame\n";
+			legacyCapture = false;
+		}
+	}
 
-	GLUnurbs* r = (GLUnurbs*)renderer;
+	// Rational surfaces are passed to GLU as weighted (w*P, w) points
+	std::vector<NURBS::hpoint_t> homogeneous;
+	if (nurbs.isRational())
+	{
+		homogeneous.resize(nurbs.controlPoints.size());
+		for (size_t i = 0; i < homogeneous.size(); i++)
+			homogeneous[i] = NURBS::hpoint_t(nurbs.controlPoints[i] * nurbs.weights[i], nurbs.weights[i]);
+	}
+	GLint stride = nurbs.isRational() ? 4 : 3;
 
 	// Render the NURBS surface
 	gluBeginSurface(r);
 	gluNurbsSurface(r,
 		nurbs.knots[NURBS::U].size(), nurbs.knots[NURBS::U].data(),
 		nurbs.knots[NURBS::V].size(), nurbs.knots[NURBS::V].data(),
-		3, 3 * nurbs.dim[NURBS::U],
-		&nurbs.controlPoints[0][0],
+		stride, stride * nurbs.dim[NURBS::U],
+		nurbs.isRational() ? &homogeneous[0][0] : &nurbs.controlPoints[0][0],
 		nurbs.getOrder(NURBS::U), nurbs.getOrder(NURBS::V),
-		GL_MAP2_VERTEX_3);
+		nurbs.isRational() ? GL_MAP2_VERTEX_4 : GL_MAP2_VERTEX_3);
 	gluEndSurface(r);
+}
 
-	if (showPoints) drawPoints();
+void GUI::drawMeshLegacy()
+{
+	// Client side arrays are GL 1.1, so they're there whatever the context is
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glEnableClientState(GL_NORMAL_ARRAY);
+	glVertexPointer(3, GL_FLOAT, 0, legacyMesh.vertices.data());
+	glNormalPointer(GL_FLOAT, 0, legacyMesh.normals.data());
 
-	glPopMatrix();
-	glFlush();
+	glDrawElements(GL_TRIANGLES, GLsizei(legacyMesh.indices.size()), GL_UNSIGNED_INT, legacyMesh.indices.data());
+
+	glDisableClientState(GL_NORMAL_ARRAY);
+	glDisableClientState(GL_VERTEX_ARRAY);
 }
 
-void GUI::drawPoint(glm::vec3 cp) { glVertex3f(cp.x, cp.y, cp.z); }
+void GUI::updatePointStates()
+{
+	pointStates.assign(nurbs.controlPoints.size(), SurfaceRenderer::COMMON);
+	for (size_t i = 0; i < pointStates.size(); i++)
+	{
+		size_t c = nurbs.index2uv(i, dim);
+		switch (action)
+		{
+		case Action::INSERT:
+			if (c == layer[0][dim] || c == layer[0][dim] - 1)
+				pointStates[i] = SurfaceRenderer::NEARBY;
+			break;
+		case Action::DELETE:
+			if (c == layer[1][dim])
+				pointStates[i] = SurfaceRenderer::DELETE;
+			break;
+		default:
+			break;
+		}
+	}
+}
+
+SurfaceRenderer::Palette GUI::palette() const
+{
+	return { Color::POINT_COMMON, Color::POINT_NEARBY, Color::POINT_INSERT, Color::POINT_DELETE, Color::POINT_ACCENT };
+}
 
 void GUI::drawPoints()
 {
-	glPointSize(5.f);
+	SurfaceRenderer::Palette colors = palette();
+
+	updatePointStates();
+	surfaceRenderer.setPointStates(pointStates);
+
+	if (action == Action::INSERT)
+		surfaceRenderer.drawExtraPoints(camera, colors, 5.f * pixelScale, controlPoints[dim], SurfaceRenderer::INSERT, true);
+	surfaceRenderer.drawPoints(camera, colors, 5.f * pixelScale);
+
+	std::vector<glm::vec3> accents;
+	if (cpFocused != nullptr)
+	{
+		accents.push_back(*cpFocused);
+		cpFocused = nullptr;
+	}
+	if (cpSelected != NO_SELECTION)
+		accents.push_back(nurbs.controlPoints[cpSelected]);
+	if (surfaceHovered)
+		accents.push_back(surfaceHit.point);
+	surfaceRenderer.drawExtraPoints(camera, colors, 8.f * pixelScale, accents, SurfaceRenderer::ACCENT, false);
+}
+
+void GUI::drawPoint(glm::vec3 cp) { glVertex3f(cp.x, cp.y, cp.z); }
+
+void GUI::drawNetLegacy()
+{
+	glDisable(GL_LIGHTING);
+	Color::set4(glColor4f, Color::CONTROL_NET);
+	glBegin(GL_LINES);
+	for (size_t i = 0; i < nurbs.controlPoints.size(); i++)
+		for (NURBS::Dim d : { NURBS::U, NURBS::V })
+			if (nurbs.index2uv(i, d) + 1 < nurbs.dim[d])
+			{
+				drawPoint(nurbs.controlPoints[i]);
+				drawPoint(nurbs.controlPoints[i + nurbs.stride(d)]);
+			}
+	glEnd();
+}
+
+void GUI::drawPointsLegacy()
+{
+	SurfaceRenderer::Palette colors = palette();
+
+	glPointSize(5.f * pixelScale);
 
 	glDisable(GL_LIGHTING);
 	glBegin(GL_POINTS);
@@ -273,37 +726,27 @@ void GUI::drawPoints()
 			drawPoint(controlPoints[dim][i]);
 	}
 
+	updatePointStates();
 	for (size_t i = 0; i < nurbs.controlPoints.size(); i++)
 	{
-		glm::vec4 color = Color::POINT_COMMON;
-
-		size_t c = nurbs.index2uv(i, dim);
-		switch (action)
-		{
-		case Action::INSERT:
-			if (c == layer[0][dim] || c == layer[0][dim] - 1)
-				color = Color::POINT_NEARBY;
-			break;
-		case Action::DELETE:
-			if (c == layer[1][dim])
-				color = Color::POINT_DELETE;
-			break;
-		}
-		Color::set4(glColor4f, color);
+		Color::set4(glColor4f, colors[pointStates[i]]);
 		drawPoint(nurbs.controlPoints[i]);
 	}
 	glEnd();
 
-	glPointSize(8.f);
+	glPointSize(8.f * pixelScale);
 	glDisable(GL_DEPTH_TEST);
 	glBegin(GL_POINTS);
+	Color::set4(glColor4f, Color::POINT_ACCENT);
 	if (cpFocused != nullptr)
 	{
-		Color::set4(glColor4f, Color::POINT_ACCENT);
 		drawPoint(*cpFocused);
-
 		cpFocused = nullptr;
 	}
+	if (cpSelected != NO_SELECTION)
+		drawPoint(nurbs.controlPoints[cpSelected]);
+	if (surfaceHovered)
+		drawPoint(surfaceHit.point);
 	glEnd();
 }
 
@@ -371,6 +814,7 @@ void GUI::setRenderer()
 
 	gluNurbsProperty(r, GLU_SAMPLING_TOLERANCE, 25.0);
 	gluNurbsProperty(r, GLU_DISPLAY_MODE, GLU_FILL);
+	legacyCapture = GLUTessellator::isSupported();
 
 	GLfloat mat_diffuse[]   = { 0.9f, 0.9f, 0.9f, 1.0f };
 	GLfloat mat_specular[]  = { 1.0f, 1.0f, 1.0f, 1.0f };
@@ -382,6 +826,61 @@ void GUI::setRenderer()
 }
 
 
+Scene::Appearance GUI::getAppearance() const
+{
+	Scene::Appearance appearance;
+	appearance.background  = Color::BACKGROUND;
+	appearance.pointCommon = Color::POINT_COMMON;
+	appearance.pointAccent = Color::POINT_ACCENT;
+	appearance.pointNearby = Color::POINT_NEARBY;
+	appearance.pointInsert = Color::POINT_INSERT;
+	appearance.pointDelete = Color::POINT_DELETE;
+	appearance.controlNet  = Color::CONTROL_NET;
+	appearance.showPoints  = showPoints;
+	appearance.showNet     = showNet;
+	return appearance;
+}
+
+void GUI::setAppearance(const Scene::Appearance& appearance)
+{
+	Color::BACKGROUND   = appearance.background;
+	Color::POINT_COMMON = appearance.pointCommon;
+	Color::POINT_ACCENT = appearance.pointAccent;
+	Color::POINT_NEARBY = appearance.pointNearby;
+	Color::POINT_INSERT = appearance.pointInsert;
+	Color::POINT_DELETE = appearance.pointDelete;
+	Color::CONTROL_NET  = appearance.controlNet;
+	showPoints = appearance.showPoints;
+	showNet    = appearance.showNet;
+}
+
+
+void GUI::setSurfaceRenderer()
+{
+	legacyRendering = true;
+	if (!GL::load(glfwGetProcAddress))
+	{
+		std::cerr << "GUI::setSurfaceRenderer: GL 3.0 isn't available, using the legacy renderer\n";
+		return;
+	}
+
+	// Both paths can render into it
+	if (DynamicResolution::isSupported())
+	{
+		try { dynamicResolution.init(); }
+		catch (const std::exception& e) { std::cerr << e.what() << '\n'; }
+	}
+
+	try
+	{
+		surfaceRenderer.init();
+		legacyRendering = false;
+	}
+	catch (const std::exception& e)
+	{ std::cerr << e.what() << "\nGUI::setSurfaceRenderer: using the legacy renderer\n"; }
+}
+
+
 void GUI::setConfigFlags()
 {
 	io.ConfigFlags |= ImGuiConfigFlags_NavEnableKeyboard;   // Enable Keyboard Controls
@@ -394,7 +893,7 @@ void GUI::setConfigFlags()
 void GUI::loadFonts()
 {
 	io.Fonts->
-		AddFontFromFileTTF("assets/fonts/opensans/OpenSans-Regular.ttf", FONT_SIZE);
-	io.FontDefault = io.Fonts->
-		AddFontFromFileTTF("assets/fonts/sourcesans_pro/SourceSansPro-Regular.ttf", FONT_SIZE);
+		AddFontFromFileTTF("assets/fonts/opensans/OpenSans-Regular.ttf", FONT_SIZE * uiScale);
+	ImGui::GetIO().FontDefault = io.Fonts->
+		AddFontFromFileTTF("assets/fonts/sourcesans_pro/SourceSansPro-Regular.ttf", FONT_SIZE * uiScale);
 }
\ No newline at end of file
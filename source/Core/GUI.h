@@ -8,7 +8,15 @@
 #include <vector>
 #include "glm/glm.hpp"
 
+#include "Core/Camera.h"
+#include "Core/DynamicResolution.h"
+#include "Core/FramePacer.h"
+#include "Core/Mesh.h"
 #include "Core/Nurbs.h"
+#include "Core/Picker.h"
+#include "Core/Scene.h"
+#include "Core/SurfaceFile.h"
+#include "Core/SurfaceRenderer.h"
 
 
 class Window;
@@ -23,6 +31,8 @@ namespace Color
 	static glm::vec4 POINT_INSERT = { 0.0f,  0.8f,  0.0f,  1.0f };
 	static glm::vec4 POINT_DELETE = { 0.8f,  0.0f,  0.0f,  1.0f };
 
+	static glm::vec4 CONTROL_NET  = { 0.3f,  0.3f,  0.3f,  1.0f };
+
 	inline void set3(void(*function)(float, float, float), glm::vec3 color)
 	{ function(color.x, color.y, color.z); }
 	inline void set4(void(*function)(float, float, float, float), glm::vec4 color)
@@ -33,7 +43,14 @@ class GUI
 {
 private:
 	const float FONT_SIZE = 15.f;
+	// Manager panel along the right edge of the window, in unscaled pixels
+	const float PANEL_WIDTH  = 256.f;
+	const float PANEL_MARGIN = 20.f;
+	// Content scale of the monitor (HiDPI), applied to the fonts & style on start
+	float uiScale = 1.f;
 	const float dragV  = 0.05f;
+	// The core handles much bigger nets, this only keeps the editor lists usable
+	static const size_t MAX_DIM = 20;
 
 	ImGuiIO io;
 private:
@@ -44,9 +61,57 @@ private:
 	glm::vec3* cpFocused = nullptr;
 	std::vector<glm::vec3> controlPoints[2];
 
+	static const size_t NO_SELECTION = size_t(-1);
+	size_t cpSelected = NO_SELECTION;
+
+	// Camera of the last drawn frame, used to pick in the viewport
+	Camera camera;
+	Picker picker;
+	bool surfaceHovered = false;
+	Picker::SurfaceHit surfaceHit;
+
 	void* renderer = nullptr;
+	// Shader path, the GLU one is kept as a fallback for contexts older than GL 3.0
+	SurfaceRenderer surfaceRenderer;
+	bool legacyRendering = false;
+	// The viewport may be rendered at a lower resolution & upscaled, sizes in pixels follow the scale
+	DynamicResolution dynamicResolution;
+	bool dynamicRendering = false;
+	float pixelScale = 1.f;
+	// With GLU 1.3 the legacy path tessellates once per surface revision and replays the mesh
+	static const size_t NO_REVISION = size_t(-1);
+	bool legacyCapture = false;
+	size_t legacyRevision = NO_REVISION;
+	Mesh legacyMesh;
+	std::vector<uint8_t> pointStates;
+
+	char scenePath[256] = "scene.json";
+	char filePath[256] = "surface.cwn";
+	char meshPath[256] = "surface.obj";
+	std::string fileStatus;
 
 	bool showPoints  = true;
+	bool showNet     = true;
+
+	// Idle rendering draws a frame only after input or when something changed since the last one,
+	// ImGui needs a few frames after an input to settle hover states & popups
+	static const int REDRAW_FRAMES = 3;
+	bool idleRendering = true;
+	int redrawFrames = REDRAW_FRAMES;
+	size_t drawnRevision = NO_REVISION;
+	float lastFrameTime = 0.f;
+	size_t framesDrawn = 0;
+
+	// Owned by the window, which paces the main loop
+	FramePacer* framePacer = nullptr;
+	bool showPacingOverlay = false;
+	char pacingPath[256] = "frames.csv";
+	std::string pacingStatus;
+
+	// Rotation of the view about Z, pausing keeps the angle
+	static constexpr float TURNTABLE_SPEED = 6.f;  // Degrees per second
+	bool turntable = false;
+	float turntableAngle = 0.f;
 	size_t layer[2][2] = { {0, 0}, {0, 0} };
 	int automatic[2]   = { 1, 1 };
 
@@ -56,12 +121,45 @@ public:
 
 	void init(Window* window);
 	void mainloop(int width, int height, float time);
+	// Releases the GL objects and ImGui's backends, the window's context has to be current.
+	// Window calls it before destroying the window, the destructor only repeats it
+	void shutdown();
+
+	// Longest sleep of an idle frame loop, ImGui's text cursor & tooltips are redrawn that often
+	static constexpr double IDLE_TIMEOUT = 0.5;
+	inline bool isIdleRendering() const { return idleRendering; }
+	// Whether a frame has to be drawn without new input: the surface changed, the turntable runs
+	// or some of the frames requested after the last input are left
+	bool needsRedraw(float time) const;
+	// Call on input events (and window refreshes)
+	inline void requestRedraw() { redrawFrames = REDRAW_FRAMES; }
+
+	// Loaded on start if it exists, replacing the built-in surface and colors
+	static constexpr const char* DEFAULT_SCENE = "assets/scenes/default.json";
+	// The first surface of the scene becomes the edited one, errors go to the status line
+	void loadScene(const std::string& path);
 	
 private:
 	void NURBSSurfaceManager();
-	void drawNURBS(int width, int height, float time);
+	void resolutionSettings();
+	void framePacingSettings();
+	void framePacingOverlay();
+	void pickViewport();
+	void setControlPoint(size_t i, glm::vec3 cp);
+	void setSurface(NURBS surface);
+	void saveScene();
+	void saveSurface();
+	void loadSurface();
+	void exportMesh();
+	void drawNURBS(int width, int height);
+	void drawSurfaceLegacy();
+	void drawMeshLegacy();
 	void drawPoint(glm::vec3 cp);
+	void drawPointsLegacy();
+	void drawNetLegacy();
 	void drawPoints();
+	void updatePointStates();
+	SurfaceRenderer::Palette palette() const;
 
 	void drawDegreeSlider(NURBS::Dim d);
 	void drawKnotsClamp(NURBS::Dim d);
@@ -73,6 +171,10 @@ private:
 	{ controlPoints[d] = std::vector<glm::vec3>(nurbs.dim[NURBS::reverseDim(d)], {0.f, 0.f, 0.f}); }
 
 	void setRenderer();
+	void setSurfaceRenderer();
+
+	Scene::Appearance getAppearance() const;
+	void setAppearance(const Scene::Appearance& appearance);
 
 	void setConfigFlags();
 	void loadFonts();
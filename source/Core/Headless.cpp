@@ -0,0 +1,401 @@
+#include "Core/Base.h"
+#include "Core/Headless.h"
+#include "Core/Benchmark.h"
+#include "Core/GPUEvaluator.h"
+#include "Core/GUI.h"
+
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+
+#include "glm/gtc/matrix_transform.hpp"
+
+// Without a display server there's nothing for the X11 types, the generic ones are enough
+#ifdef CW_PLATFORM_LINUX
+	#define EGL_NO_X11
+	#include <EGL/egl.h>
+	#include <EGL/eglext.h>
+#endif
+
+#ifndef GL_PACK_ALIGNMENT
+	#define GL_PACK_ALIGNMENT 0x0D05
+#endif
+
+
+namespace
+{
+	// Value of the option at argv[i], which is skipped
+	std::string_view value(int argc, char** argv, int& i)
+	{
+		if (i + 1 >= argc)
+			throw std::invalid_argument
+			(std::string("Headless::parse: ") + argv[i] + " needs a value");
+		return argv[++i];
+	}
+
+	size_t toCount(std::string_view text, std::string_view option, size_t min, size_t max = size_t(-1))
+	{
+		size_t count = 0;
+		auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), count);
+		if (error != std::errc() || end != text.data() + text.size() || count < min || count > max)
+			throw std::invalid_argument
+			("Headless::parse: bad value of " + std::string(option) + ": " + std::string(text));
+		return count;
+	}
+}
+
+
+Headless::Context::Context()
+{
+#ifdef CW_PLATFORM_LINUX
+	// Surfaceless Mesa needs neither a display server nor a window system, only a render node
+	// (or none at all for llvmpipe)
+	const char* clientExtensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+	auto getPlatformDisplay = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>
+		(eglGetProcAddress("eglGetPlatformDisplayEXT"));
+	if (getPlatformDisplay && clientExtensions && std::strstr(clientExtensions, "EGL_MESA_platform_surfaceless"))
+		display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+	if (display == EGL_NO_DISPLAY) display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+	EGLint major, minor;
+	if (display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor))
+	{
+		display = nullptr;
+		throw std::runtime_error
+		("Headless::Context: no EGL display.");
+	}
+
+	try
+	{
+		if (!eglBindAPI(EGL_OPENGL_API))
+			throw std::runtime_error
+			("Headless::Context: EGL doesn't support desktop GL.");
+
+		EGLint configAttributes[] =
+		{
+			EGL_SURFACE_TYPE, EGL_PBUFFER_BIT, EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+			EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8, EGL_NONE
+		};
+		EGLConfig config;
+		EGLint count = 0;
+		if (!eglChooseConfig(display, configAttributes, &config, 1, &count) || count == 0)
+			throw std::runtime_error
+			("Headless::Context: no EGL config for desktop GL.");
+
+		// Without a version Mesa makes the newest compatibility profile, like the window's 3.2 one
+		context = eglCreateContext(display, config, EGL_NO_CONTEXT, nullptr);
+		if (context == EGL_NO_CONTEXT)
+			throw std::runtime_error
+			("Headless::Context: can't create a GL context.");
+
+		// Frames go to a framebuffer object, a pbuffer is only there for the context to be current
+		const char* extensions = eglQueryString(display, EGL_EXTENSIONS);
+		if (!extensions || !std::strstr(extensions, "EGL_KHR_surfaceless_context"))
+		{
+			EGLint pbufferAttributes[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+			surface = eglCreatePbufferSurface(display, config, pbufferAttributes);
+			if (surface == EGL_NO_SURFACE)
+				throw std::runtime_error
+				("Headless::Context: can't create a pbuffer.");
+		}
+
+		if (!eglMakeCurrent(display, surface, surface, context))
+			throw std::runtime_error
+			("Headless::Context: can't make the context current.");
+
+		if (!GL::load(reinterpret_cast<GL::Loader>(eglGetProcAddress)))
+			throw std::runtime_error
+			("Headless::Context: GL 3.0 isn't available.");
+	}
+	catch (...)
+	{
+		release();
+		throw;
+	}
+#else
+	throw std::runtime_error
+	("Headless::Context: headless contexts are made through EGL, which is only used on Linux.");
+#endif
+}
+
+void Headless::Context::release()
+{
+#ifdef CW_PLATFORM_LINUX
+	if (!display) return;
+
+	eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+	if (context) eglDestroyContext(display, context);
+	if (surface) eglDestroySurface(display, surface);
+	eglTerminate(display);
+	display = surface = context = nullptr;
+#endif
+}
+
+
+bool Headless::parse(int argc, char** argv, Settings& settings)
+{
+	bool headless = false;
+	for (int i = 1; i < argc; i++)
+	{
+		std::string_view option = argv[i];
+		if      (option == "--headless")         headless = true;
+		else if (option == "--frames")           settings.frames = toCount(value(argc, argv, i), option, 1);
+		else if (option == "--capture")          settings.captureEvery = toCount(value(argc, argv, i), option, 0);
+		else if (option == "--output")           settings.output = value(argc, argv, i);
+		else if (option == "--gpu-tessellation") settings.gpuTessellation = true;
+		else if (option == "--samples")          settings.samples = toCount(value(argc, argv, i), option, 2, 4096);
+		else if (option == "--evaluate")         { settings.mode = EVALUATE;  headless = true; }
+		else if (option == "--size")
+		{
+			std::string_view size = value(argc, argv, i);
+			size_t x = size.find('x');
+			if (x == std::string_view::npos)
+				throw std::invalid_argument
+				("Headless::parse: --size needs WIDTHxHEIGHT, not " + std::string(size));
+			settings.width  = int(toCount(size.substr(0, x),  option, 1, MAX_SIZE));
+			settings.height = int(toCount(size.substr(x + 1), option, 1, MAX_SIZE));
+		}
+		else if (option.substr(0, 2) == "--")
+			throw std::invalid_argument
+			("Headless::parse: unknown option " + std::string(option));
+		else settings.scene = option;
+	}
+	return headless;
+}
+
+const char* Headless::usage()
+{
+	return
+		"Usage: [scene.json] [--headless [--frames N] [--size WIDTHxHEIGHT] [--capture N]\n"
+		"                                [--output DIR] [--gpu-tessellation]]\n"
+		"       [scene.json] --evaluate [--samples N]\n"
+		"  --headless          draw offscreen (EGL) instead of opening a window\n"
+		"  --frames N          frames to draw, a full turn of the view (120)\n"
+		"  --size WxH          framebuffer size (1280x720)\n"
+		"  --capture N         write every Nth frame as an image, 0 - only the last one (0)\n"
+		"  --output DIR        directory of the images & frames.csv (headless)\n"
+		"  --gpu-tessellation  draw the surface by tessellation shaders (GL 4.0)\n"
+		"  --evaluate          time & compare the CPU and GPU (GL 4.3) evaluators\n"
+		"  --samples N         benchmark grid of NxN parameters (256)\n";
+}
+
+
+Headless::Headless(const Settings& settings) : settings(settings)
+{
+	nurbs = loadSurface(settings.scene, scene);
+	createFramebuffer();
+
+	surfaceRenderer.init();
+	if (settings.gpuTessellation)
+	{
+		if (!surfaceRenderer.hasGPUTessellation())
+			throw std::runtime_error
+			("Headless::Headless: GPU tessellation needs GL 4.0.");
+		surfaceRenderer.setGPUTessellation(true);
+	}
+
+	// A frame's time includes the GPU finishing it
+	framePacer.finishAfterSwap = true;
+}
+
+Headless::~Headless()
+{
+	GLuint renderbuffers[] = { color, depth };
+	glDeleteRenderbuffers(2, renderbuffers);
+	glDeleteFramebuffers(1, &framebuffer);
+}
+
+NURBS Headless::loadSurface(const std::string& scenePath, Scene& scene)
+{
+	// Colors the scene doesn't set are the editor's
+	scene.appearance.background  = Color::BACKGROUND;
+	scene.appearance.pointCommon = Color::POINT_COMMON;
+	scene.appearance.pointAccent = Color::POINT_ACCENT;
+	scene.appearance.pointNearby = Color::POINT_NEARBY;
+	scene.appearance.pointInsert = Color::POINT_INSERT;
+	scene.appearance.pointDelete = Color::POINT_DELETE;
+	scene.appearance.controlNet  = Color::CONTROL_NET;
+
+	std::string path = scenePath;
+	if (path.empty() && std::filesystem::exists(GUI::DEFAULT_SCENE)) path = GUI::DEFAULT_SCENE;
+	if (!path.empty()) Scene::read(path, scene);
+
+	return scene.surfaces.empty() ? NURBS(5, 3) : std::move(scene.surfaces.front());
+}
+
+void Headless::evaluate()
+{
+	static const size_t REPEATS = 5;
+
+	size_t n = settings.samples;
+	std::vector<float> u(n), v(n);
+	for (size_t i = 0; i < n; i++)
+	{
+		float t = float(i) / float(n - 1);
+		u[i] = nurbs.domainStart(NURBS::U) + (nurbs.domainEnd(NURBS::U) - nurbs.domainStart(NURBS::U)) * t;
+		v[i] = nurbs.domainStart(NURBS::V) + (nurbs.domainEnd(NURBS::V) - nurbs.domainStart(NURBS::V)) * t;
+	}
+
+	// The first run of each uploads the surface and warms the caches (or compiles), it isn't timed
+	auto time = [&](Evaluator& evaluator, std::vector<glm::vec3>& positions, std::vector<glm::vec3>& normals)
+	{
+		evaluator.setSurface(nurbs);
+		evaluator.evaluateGrid(u, v);
+		evaluator.read(positions, normals);
+		return Benchmark::bestTime(REPEATS, [&]
+		{
+			evaluator.evaluateGrid(u, v);
+			evaluator.read(positions, normals);
+		});
+	};
+
+	std::printf("%s\n%zux%zu surface of degree %zux%zu%s, %zux%zu samples, best of %zu\n",
+		reinterpret_cast<const char*>(glGetString(GL_RENDERER)),
+		nurbs.dim[NURBS::U], nurbs.dim[NURBS::V], nurbs.degree[NURBS::U], nurbs.degree[NURBS::V],
+		nurbs.isRational() ? ", rational" : "", n, n, REPEATS);
+
+	CPUEvaluator cpu;
+	std::vector<glm::vec3> cpuPositions, cpuNormals;
+	double cpuTime = time(cpu, cpuPositions, cpuNormals);
+	std::printf("%s: %.3f ms\n", cpu.name(), cpuTime);
+
+	if (!GPUEvaluator::isSupported())
+	{
+		std::printf("GPU evaluation needs GL 4.3, not compared\n");
+		return;
+	}
+	GPUEvaluator gpu;
+	gpu.init();
+	std::vector<glm::vec3> gpuPositions, gpuNormals;
+	double gpuTime = time(gpu, gpuPositions, gpuNormals);
+	std::printf("%s: %.3f ms\n", gpu.name(), gpuTime);
+
+	float position = 0.f, normal = 0.f;
+	for (size_t i = 0; i < cpuPositions.size(); i++)
+	{
+		position = std::max(position, glm::length(gpuPositions[i] - cpuPositions[i]));
+		normal   = std::max(normal,   glm::length(gpuNormals[i]   - cpuNormals[i]));
+	}
+	float size = glm::length(nurbs.bounds().extent());
+	std::printf("Largest CPU/GPU difference: position %.3g (%.3g of the net's size), normal %.3g\n",
+		position, (size > 0.f) ? position / size : 0.f, normal);
+}
+
+
+void Headless::createFramebuffer()
+{
+	glGenFramebuffers(1, &framebuffer);
+	glGenRenderbuffers(1, &color);
+	glGenRenderbuffers(1, &depth);
+
+	glBindRenderbuffer(GL_RENDERBUFFER, color);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, settings.width, settings.height);
+	glBindRenderbuffer(GL_RENDERBUFFER, depth);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, settings.width, settings.height);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth);
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+		throw std::runtime_error
+		("Headless::createFramebuffer: incomplete framebuffer of " +
+			std::to_string(settings.width) + 'x' + std::to_string(settings.height) + '.');
+}
+
+
+void Headless::run()
+{
+	std::filesystem::path output(settings.output);
+	std::error_code error;
+	std::filesystem::create_directories(output, error);
+	if (error)
+		throw std::runtime_error
+		("Headless::run: can't create " + settings.output + ": " + error.message());
+
+	// The first frame tessellates & uploads the surface and the driver compiles on first use
+	drawFrame(0.f);
+	glFinish();
+
+	for (size_t i = 0; i < settings.frames; i++)
+	{
+		framePacer.beginFrame();
+		drawFrame(360.f * float(i) / float(settings.frames));
+		framePacer.endFrame();
+
+		bool last = (i + 1 == settings.frames);
+		if (last || (settings.captureEvery > 0 && i % settings.captureEvery == 0))
+		{
+			char name[32];
+			std::snprintf(name, sizeof(name), "frame_%04zu.ppm", i);
+			writeImage((output / name).string());
+		}
+	}
+	framePacer.exportCSV((output / "frames.csv").string());
+
+	FramePacer::Summary work = framePacer.statistics().work;
+	std::printf("%s\n%zu frames of %dx%d, %zu triangles, %zu patches\n"
+		"Frame time: %.3f ms average, %.3f ms p99, %.3f ms max\n",
+		reinterpret_cast<const char*>(glGetString(GL_RENDERER)),
+		settings.frames, settings.width, settings.height,
+		surfaceRenderer.getStatistics().triangles, surfaceRenderer.getStatistics().patches,
+		work.average, work.p99, work.max);
+	if (settings.frames > FramePacer::HISTORY)
+		std::printf("(of the last %zu frames)\n", FramePacer::HISTORY);
+}
+
+void Headless::drawFrame(float angle)
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glViewport(0, 0, settings.width, settings.height);
+	glEnable(GL_DEPTH_TEST);
+	Color::set4(glClearColor, scene.appearance.background);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+	// The view of the editor's viewport (GUI::drawNURBS), 'angle' is the turntable's
+	camera.setPerspective(45.f, settings.width, settings.height, 0.1f, 100.f);
+	camera.view = glm::translate(glm::mat4(1.f), glm::vec3(-1.4f, 0.f, -10.f));
+	camera.view = glm::rotate(camera.view, glm::radians(-60.f), glm::vec3(1.f, 0.f, 0.f));
+	camera.view = glm::rotate(camera.view, glm::radians(angle), glm::vec3(0.f, 0.f, 1.f));
+
+	surfaceRenderer.update(nurbs);
+	surfaceRenderer.drawSurface(camera);
+
+	const Scene::Appearance& a = scene.appearance;
+	if (a.showNet) surfaceRenderer.drawNet(camera, a.controlNet);
+	if (a.showPoints)
+	{
+		surfaceRenderer.setPointStates(std::vector<uint8_t>(nurbs.controlPoints.size(), SurfaceRenderer::COMMON));
+		surfaceRenderer.drawPoints(camera,
+			{ a.pointCommon, a.pointNearby, a.pointInsert, a.pointDelete, a.pointAccent }, 5.f);
+	}
+}
+
+void Headless::writeImage(const std::string& path) const
+{
+	size_t row = size_t(settings.width) * 3;
+	std::vector<uint8_t> pixels(row * settings.height);
+
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, settings.width, settings.height, GL_RGB, GL_UNSIGNED_BYTE, pixels.data());
+
+	std::ofstream out(path, std::ios::binary | std::ios::trunc);
+	if (!out)
+		throw std::runtime_error
+		("Headless::writeImage: can't create " + path);
+
+	// Binary PPM, rows top to bottom (GL reads them bottom up)
+	out << "P6\n" << settings.width << ' ' << settings.height << "\n255\n";
+	for (size_t y = settings.height; y-- > 0; )
+		out.write(reinterpret_cast<const char*>(&pixels[y * row]), std::streamsize(row));
+
+	if (!out)
+		throw std::runtime_error
+		("Headless::writeImage: failed to write " + path);
+}
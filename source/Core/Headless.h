@@ -0,0 +1,95 @@
+#pragma once
+
+#include <string>
+
+#include "Core/Camera.h"
+#include "Core/FramePacer.h"
+#include "Core/Nurbs.h"
+#include "Core/Scene.h"
+#include "Core/SurfaceRenderer.h"
+
+
+// Offscreen runs without a window, for machines without a display (CI, render nodes on Mesa llvmpipe).
+// The context is an EGL one on the surfaceless platform (EGL_MESA_platform_surfaceless) or, where
+// that isn't available, on the default display with a small pbuffer; frames are drawn into a
+// framebuffer object of the requested size either way.
+//
+// A run draws 'frames' frames of the scene, turning the view once around like the turntable,
+// and writes PPM images and the frame times (glFinish after every frame, so a time covers the
+// whole GPU work of the frame) as FramePacer's CSV. Reading the images back isn't timed.
+//
+// "--evaluate" times the CPU & GPU evaluators on a grid of the surface instead
+class Headless
+{
+public:
+	static const int MAX_SIZE = 16384;  // Pixels, the renderbuffer limit of most drivers
+
+	enum Mode { RENDER, EVALUATE };
+
+	struct Settings
+	{
+		Mode mode = RENDER;
+		int width  = 1280;
+		int height = 720;
+		size_t frames = 120;
+		// Frames between the written images, 0 - only the last frame
+		size_t captureEvery = 0;
+		// Scene to draw (its first surface), the default one if empty
+		std::string scene;
+		std::string output = "headless";
+		bool gpuTessellation = false;
+		// Grid of samples x samples parameters of --evaluate
+		size_t samples = 256;
+	};
+
+	// True if the command line asks for a headless run ("--headless"), see usage().
+	// Throws std::invalid_argument on an unknown option or a bad value
+	static bool parse(int argc, char** argv, Settings& settings);
+	static const char* usage();
+
+	// Makes the context current and loads the scene.
+	// Throws std::runtime_error if there's no EGL context with GL 3.0 or the scene can't be read
+	explicit Headless(const Settings& settings);
+	~Headless();
+
+	Headless(const Headless&) = delete;
+	Headless& operator=(const Headless&) = delete;
+
+	// Throws std::runtime_error if the output can't be written
+	void run();
+	// CPU against GPU evaluation of the surface, printed to stdout: the time of a grid
+	// (evaluation & reading the samples) and the largest differences of the results.
+	// The GPU one is skipped without GL 4.3
+	void evaluate();
+
+private:
+	// Declared first, so the GL objects of the members below are deleted before it goes
+	struct Context
+	{
+		// EGLDisplay, EGLSurface & EGLContext, which are pointers, kept out of the header
+		void* display = nullptr;
+		void* surface = nullptr;
+		void* context = nullptr;
+
+		Context();
+		inline ~Context() { release(); }
+		void release();
+	};
+	Context eglContext;
+
+	Settings settings;
+	GLuint framebuffer = 0, color = 0, depth = 0;
+
+	Scene scene;
+	NURBS nurbs;
+	Camera camera;
+	SurfaceRenderer surfaceRenderer;
+	FramePacer framePacer;
+
+	void createFramebuffer();
+	// First surface of the scene (the default one if path is empty), the editor's built-in one without any
+	static NURBS loadSurface(const std::string& path, Scene& scene);
+
+	void drawFrame(float angle);
+	void writeImage(const std::string& path) const;
+};
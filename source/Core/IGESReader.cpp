@@ -0,0 +1,372 @@
+#include "Core/IGESReader.h"
+
+#include <algorithm>
+#include <charconv>
+#include <fstream>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string_view>
+#include "Core/Parallel.h"
+
+
+namespace
+{
+	// Fixed format: 72 columns of data, section letter in column 73, sequence number after it
+	const size_t DATA_COLUMNS      = 72;
+	const size_t PARAMETER_COLUMNS = 64;  // Columns 65-72 of the Parameter section point back to the entry
+	const size_t SECTION_COLUMN    = 72;
+
+	const int SURFACE = 128;
+	const int CURVE   = 126;
+
+	// Integer in a fixed 8-column field of a directory entry, 0 for a blank one
+	long field(std::string_view line, size_t index)
+	{
+		std::string_view text = line.substr(std::min(line.size(), index * 8), 8);
+		while (!text.empty() && text.front() == ' ') text.remove_prefix(1);
+
+		long value = 0;
+		std::from_chars(text.data(), text.data() + text.size(), value);
+		return value;
+	}
+
+	// Free format parameter list: fields separated by the parameter delimiter, ended by the record one
+	class ParameterParser
+	{
+		const char* current;
+		const char* end;
+		char parameter, record;
+		bool failed = false;
+
+	public:
+		ParameterParser(std::string_view text, char parameter, char record)
+			: current(text.data()), end(text.data() + text.size()), parameter(parameter), record(record) {}
+
+		inline bool ok() const { return !failed; }
+
+		double real()
+		{
+			std::string_view token = next();
+			if (token.empty()) return 0.0;
+
+			// Fortran style exponents (1.0D3) and explicit plus signs aren't accepted by from_chars
+			char buffer[64];
+			size_t length = 0;
+			for (char c : token)
+			{
+				if (length == sizeof(buffer)) { failed = true; return 0.0; }
+				if (c == '+' && length == 0) continue;
+				buffer[length++] = (c == 'D' || c == 'd') ? 'E' : c;
+			}
+
+			double value = 0.0;
+			auto [last, error] = std::from_chars(buffer, buffer + length, value);
+			if (error != std::errc() || last != buffer + length) failed = true;
+			return value;
+		}
+
+		inline long integer()
+		{
+			double value = real();
+			return long(value);
+		}
+
+	private:
+		std::string_view next()
+		{
+			if (current >= end) { failed = true; return {}; }
+
+			while (current < end && *current == ' ') current++;
+			const char* start = current;
+			while (current < end && *current != parameter && *current != record) current++;
+
+			const char* last = current;
+			while (last > start && last[-1] == ' ') last--;
+			if (current < end) current++;  // Delimiter
+			return { start, size_t(last - start) };
+		}
+	};
+
+	// Parameters common to entities 126 and 128: knots of one direction
+	template<typename Spline>
+	bool readKnots(ParameterParser& parser, Spline& spline, typename Spline::Dim d)
+	{
+		std::vector<typename Spline::scalar_t> knots(spline.dim[d] + spline.degree[d] + 1);
+		for (auto& knot : knots) knot = parser.real();
+		if (!parser.ok() || !std::is_sorted(knots.begin(), knots.end()) ||
+			knots[spline.degree[d]] >= knots[spline.dim[d]])
+			return false;
+
+		spline.setKnots(d, std::move(knots));
+		return true;
+	}
+
+	// Weights, control points and the rational flag (PROP3: 0 - rational, 1 - polynomial)
+	template<typename Spline>
+	bool readPoints(ParameterParser& parser, Spline& spline, bool polynomial)
+	{
+		std::vector<typename Spline::scalar_t> weights(spline.controlPoints.size());
+		bool uniform = true;
+		for (auto& w : weights)
+		{
+			w = parser.real();
+			if (w <= 0.0) return false;
+			uniform = uniform && w == weights.front();
+		}
+		for (auto& cp : spline.controlPoints)
+			for (int c = 0; c < 3; c++)
+				cp[c] = parser.real();
+		if (!parser.ok()) return false;
+
+		// Equal weights cancel out, the spline is polynomial whatever the flag says
+		if (!polynomial && !uniform) spline.weights = std::move(weights);
+		spline.invalidate();
+		return true;
+	}
+
+	// Number of control points (K + 1) and degree (M) of a direction
+	bool validLayout(long upperIndex, long degree)
+	{
+		return degree >= long(NURBSd::MIN_DEGREE) && degree <= long(NURBSd::MAX_DEGREE) &&
+			upperIndex >= degree && upperIndex + 1 >= long(NURBSd::MIN_DIM) && upperIndex + 1 <= long(NURBSd::MAX_DIM);
+	}
+
+	// Whether the parameters can hold the knots, weights & coordinates of the layout: every value,
+	// even a defaulted (empty) one, takes at least its delimiter. Keeps a bogus layout from
+	// allocating the spline before the data runs out
+	bool fits(std::string_view parameters, size_t points, size_t knots)
+	{
+		return points * 4 + knots <= parameters.size();
+	}
+}
+
+
+bool IGESReader::parseSurface(const Entity& entity, Delimiters delimiters, surface_t& out)
+{
+	ParameterParser parser(entity.parameters, delimiters.parameter, delimiters.record);
+	if (parser.integer() != SURFACE) return false;
+
+	long k1 = parser.integer(), k2 = parser.integer();
+	long m1 = parser.integer(), m2 = parser.integer();
+	parser.integer(); parser.integer();             // Closed in U/V
+	bool polynomial = parser.integer() == 1;
+	parser.integer(); parser.integer();             // Periodic in U/V
+	if (!parser.ok() || !validLayout(k1, m1) || !validLayout(k2, m2)) return false;
+	if (!fits(entity.parameters, size_t(k1 + 1) * size_t(k2 + 1), size_t(k1 + m1 + 2) + size_t(k2 + m2 + 2)))
+		return false;
+
+	surface_t surface(size_t(k1 + 1), size_t(k2 + 1));
+	surface.setDegree(surface_t::U, size_t(m1));
+	surface.setDegree(surface_t::V, size_t(m2));
+	if (!readKnots(parser, surface, surface_t::U) || !readKnots(parser, surface, surface_t::V)) return false;
+	if (!readPoints(parser, surface, polynomial)) return false;
+
+	out = std::move(surface);
+	return true;
+}
+
+bool IGESReader::parseCurve(const Entity& entity, Delimiters delimiters, curve_t& out)
+{
+	ParameterParser parser(entity.parameters, delimiters.parameter, delimiters.record);
+	if (parser.integer() != CURVE) return false;
+
+	long k = parser.integer(), m = parser.integer();
+	parser.integer(); parser.integer();             // Planar, closed
+	bool polynomial = parser.integer() == 1;
+	parser.integer();                               // Periodic
+	if (!parser.ok() || !validLayout(k, m)) return false;
+	if (!fits(entity.parameters, size_t(k + 1), size_t(k + m + 2))) return false;
+
+	curve_t curve(size_t(k + 1));
+	curve.setDegree(curve_t::U, size_t(m));
+	if (!readKnots(parser, curve, curve_t::U)) return false;
+	if (!readPoints(parser, curve, polynomial)) return false;
+
+	out = std::move(curve);
+	return true;
+}
+
+
+IGESReader::Statistics IGESReader::read(std::istream& in, const SurfaceCallback& onSurface, const CurveCallback& onCurve)
+{
+	Statistics statistics;
+	Delimiters delimiters;
+	std::string global;
+
+	// Entities of interest ordered by their first parameter line, 'next' is the one being filled
+	std::vector<Entity> wanted;
+	size_t next = 0;
+
+	std::vector<Entity> batch;
+	size_t batchBytes = 0;
+
+	auto flush = [&]()
+	{
+		struct Result { std::optional<surface_t> surface; std::optional<curve_t> curve; };
+		std::vector<Result> results(batch.size());
+
+		// An entity that throws (e.g. bad_alloc) is counted as failed, like a malformed one
+		Parallel::forEach(0, batch.size(), [&](size_t i)
+		{
+			try
+			{
+				if (batch[i].type == SURFACE)
+				{
+					surface_t surface;
+					if (parseSurface(batch[i], delimiters, surface)) results[i].surface = std::move(surface);
+				}
+				else
+				{
+					curve_t curve;
+					if (parseCurve(batch[i], delimiters, curve)) results[i].curve = std::move(curve);
+				}
+			}
+			catch (const std::exception&) { results[i] = Result(); }
+		}, 4);
+
+		for (auto& result : results)
+		{
+			if (result.surface)
+			{
+				statistics.surfaces++;
+				if (onSurface) onSurface(std::move(*result.surface));
+			}
+			else if (result.curve)
+			{
+				statistics.curves++;
+				if (onCurve) onCurve(std::move(*result.curve));
+			}
+			else statistics.failed++;
+		}
+
+		batch.clear();
+		batchBytes = 0;
+	};
+
+	std::string line, directoryLine;
+	size_t parameterLine = 0;
+	bool globalParsed = false;
+
+	while (std::getline(in, line))
+	{
+		if (!line.empty() && line.back() == '\r') line.pop_back();
+		if (line.size() <= SECTION_COLUMN)
+		{
+			if (line.empty()) continue;
+			throw std::runtime_error
+			("IGESReader::read: line is shorter than 73 columns, not a fixed format IGES file.");
+		}
+
+		switch (line[SECTION_COLUMN])
+		{
+		case 'S':
+			break;
+
+		case 'G':
+			global.append(line, 0, DATA_COLUMNS);
+			break;
+
+		case 'D':
+		{
+			// Entries take two lines, the first one is stored until the second arrives
+			if (directoryLine.empty()) { directoryLine = line; break; }
+
+			long type = field(directoryLine, 0);
+			if (type == SURFACE || (type == CURVE && onCurve))
+			{
+				Entity entity;
+				entity.type  = int(type);
+				entity.first = size_t(field(directoryLine, 1));
+				entity.lines = size_t(field(line, 3));
+				if (entity.first > 0 && entity.lines > 0) wanted.push_back(std::move(entity));
+				else statistics.failed++;
+			}
+			else statistics.skipped++;
+
+			directoryLine.clear();
+			break;
+		}
+
+		case 'P':
+		{
+			if (!globalParsed)
+			{
+				// First two global parameters redefine the delimiters as 1Hx Hollerith strings
+				auto delimiter = [&global](size_t& at, char fallback)
+				{
+					if (global.compare(at, 2, "1H") == 0 && at + 2 < global.size())
+					{
+						char c = global[at + 2];
+						at += 4;
+						return c;
+					}
+					at += 1;
+					return fallback;
+				};
+				size_t at = 0;
+				delimiters.parameter = delimiter(at, ',');
+				delimiters.record    = delimiter(at, ';');
+
+				std::sort(wanted.begin(), wanted.end(),
+					[](const Entity& a, const Entity& b) { return a.first < b.first; });
+				globalParsed = true;
+			}
+
+			parameterLine++;
+			while (next < wanted.size() && parameterLine >= wanted[next].first + wanted[next].lines)
+			{
+				statistics.failed++;
+				next++;
+			}
+			if (next == wanted.size() || parameterLine < wanted[next].first) break;
+
+			Entity& entity = wanted[next];
+			entity.parameters.append(line, 0, PARAMETER_COLUMNS);
+			if (parameterLine + 1 < entity.first + entity.lines) break;
+
+			batchBytes += entity.parameters.size();
+			batch.push_back(std::move(entity));
+			next++;
+			if (batchBytes >= BATCH_BYTES) flush();
+			break;
+		}
+
+		case 'T':
+			break;
+
+		case 'C':
+			throw std::runtime_error
+			("IGESReader::read: compressed IGES files are not supported.");
+
+		default:
+			throw std::runtime_error
+			("IGESReader::read: unknown section, not an IGES file.");
+		}
+	}
+
+	flush();
+	statistics.failed += wanted.size() - next;
+	return statistics;
+}
+
+IGESReader::Statistics IGESReader::read(const std::string& path, const SurfaceCallback& onSurface, const CurveCallback& onCurve)
+{
+	std::ifstream in(path, std::ios::binary);
+	if (!in)
+		throw std::runtime_error
+		("IGESReader::read: can't open " + path);
+
+	// Larger buffer than the default one, the file is read strictly sequentially
+	auto buffer = std::make_unique<char[]>(1 << 20);
+	in.rdbuf()->pubsetbuf(buffer.get(), 1 << 20);
+
+	return read(in, onSurface, onCurve);
+}
+
+std::vector<IGESReader::surface_t> IGESReader::readSurfaces(const std::string& path)
+{
+	std::vector<surface_t> surfaces;
+	read(path, [&surfaces](surface_t&& surface) { surfaces.push_back(std::move(surface)); });
+	return surfaces;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <functional>
+#include <istream>
+#include <string>
+#include <vector>
+
+#include "Core/Nurbs.h"
+
+
+// Streaming reader of IGES files, decodes rational B-spline surfaces (entity 128)
+// and curves (entity 126), everything else is skipped.
+//
+// The file is read once, line by line: the Directory section tells which parameter
+// lines are of interest, so only those are kept. Collected entities are parsed in
+// parallel in batches of about BATCH_BYTES of parameter data and handed out in file
+// order, so memory doesn't depend on the size of the file.
+// Transformation matrices (entity 124) are not applied
+class IGESReader
+{
+public:
+	using surface_t = NURBSd;
+	using curve_t   = NURBSCurved;
+
+	using SurfaceCallback = std::function<void(surface_t&&)>;
+	using CurveCallback   = std::function<void(curve_t&&)>;
+
+	static const size_t BATCH_BYTES = 16 << 20;
+
+	struct Statistics
+	{
+		size_t surfaces = 0;
+		size_t curves   = 0;
+		size_t failed   = 0;  // Malformed or unsupported (e.g. degree above NURBS::MAX_DEGREE)
+		size_t skipped  = 0;  // Entities of other types
+	};
+
+	// Throws std::runtime_error if the file isn't a (fixed format) IGES file
+	static Statistics read(std::istream& in, const SurfaceCallback& onSurface, const CurveCallback& onCurve = {});
+	static Statistics read(const std::string& path, const SurfaceCallback& onSurface, const CurveCallback& onCurve = {});
+
+	static std::vector<surface_t> readSurfaces(const std::string& path);
+
+private:
+	struct Entity
+	{
+		int    type  = 0;
+		size_t first = 0;  // Sequence number of the first parameter line
+		size_t lines = 0;
+		std::string parameters;
+	};
+
+	struct Delimiters
+	{
+		char parameter = ',';
+		char record    = ';';
+	};
+
+	// Return false for malformed entities
+	static bool parseSurface(const Entity& entity, Delimiters delimiters, surface_t& out);
+	static bool parseCurve(const Entity& entity, Delimiters delimiters, curve_t& out);
+};
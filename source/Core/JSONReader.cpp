@@ -0,0 +1,219 @@
+#include "Core/JSONReader.h"
+
+#include <algorithm>
+#include <charconv>
+#include <stdexcept>
+#include "Core/MappedFile.h"
+
+
+namespace
+{
+	class Parser
+	{
+		const char* begin;
+		const char* p;
+		const char* end;
+		JSONReader::Handler& handler;
+		// Unescaped strings, reused between values
+		std::string buffer;
+
+	public:
+		Parser(std::string_view text, JSONReader::Handler& handler)
+			: begin(text.data()), p(text.data()), end(text.data() + text.size()), handler(handler) {}
+
+		void document()
+		{
+			// UTF-8 byte order mark
+			if (end - p >= 3 && std::string_view(p, 3) == "\xEF\xBB\xBF") p += 3;
+
+			value(0);
+			skipSpace();
+			if (p != end) fail("unexpected text after the document");
+		}
+
+	private:
+		[[noreturn]] void fail(const char* what) const
+		{
+			size_t line = 1 + std::count(begin, p, '\n');
+			throw std::runtime_error
+			("JSONReader::parse: " + std::string(what) + " at line " + std::to_string(line));
+		}
+
+		inline void skipSpace()
+		{
+			while (p < end && (*p == ' ' || *p == '\n' || *p == '\r' || *p == '\t')) p++;
+		}
+
+		inline bool consume(char c)
+		{
+			skipSpace();
+			if (p < end && *p == c) { p++; return true; }
+			return false;
+		}
+
+		void literal(std::string_view word)
+		{
+			if (size_t(end - p) < word.size() || std::string_view(p, word.size()) != word)
+				fail("invalid literal");
+			p += word.size();
+		}
+
+		void value(size_t depth)
+		{
+			if (depth > JSONReader::MAX_DEPTH) fail("document is nested too deep");
+
+			skipSpace();
+			if (p == end) fail("unexpected end of the document");
+
+			switch (*p)
+			{
+			case '{': object(depth); break;
+			case '[': array(depth);  break;
+			case '"': handler.string(string()); break;
+			case 't': literal("true");  handler.boolean(true);  break;
+			case 'f': literal("false"); handler.boolean(false); break;
+			case 'n': literal("null");  handler.null(); break;
+			default:  handler.number(number()); break;
+			}
+		}
+
+		void object(size_t depth)
+		{
+			p++;
+			handler.beginObject();
+			if (!consume('}'))
+			{
+				do
+				{
+					skipSpace();
+					if (p == end || *p != '"') fail("expected a member name");
+					handler.key(string());
+					if (!consume(':')) fail("expected ':'");
+					value(depth + 1);
+				}
+				while (consume(','));
+				if (!consume('}')) fail("expected ',' or '}'");
+			}
+			handler.endObject();
+		}
+
+		void array(size_t depth)
+		{
+			p++;
+			handler.beginArray();
+			if (!consume(']'))
+			{
+				do value(depth + 1);
+				while (consume(','));
+				if (!consume(']')) fail("expected ',' or ']'");
+			}
+			handler.endArray();
+		}
+
+		double number()
+		{
+			// from_chars accepts a few forms JSON doesn't (inf, nan, hex in some modes), check the first character
+			if (*p != '-' && (*p < '0' || *p > '9')) fail("unexpected character");
+
+			double value = 0.0;
+			auto [last, error] = std::from_chars(p, end, value);
+			if (error != std::errc() || last == p) fail("invalid number");
+			p = last;
+			return value;
+		}
+
+		// Points into the text if there are no escapes, into the buffer otherwise
+		std::string_view string()
+		{
+			const char* start = ++p;
+			while (p < end && *p != '"' && *p != '\\')
+			{
+				if ((unsigned char)*p < 0x20) fail("control character in a string");
+				p++;
+			}
+			if (p == end) fail("unterminated string");
+			if (*p == '"') return { start, size_t(p++ - start) };
+
+			buffer.assign(start, p);
+			while (p < end && *p != '"')
+			{
+				char c = *p++;
+				if ((unsigned char)c < 0x20) fail("control character in a string");
+				if (c != '\\') { buffer.push_back(c); continue; }
+				if (p == end) break;
+
+				switch (c = *p++)
+				{
+				case '"': case '\\': case '/': buffer.push_back(c); break;
+				case 'b': buffer.push_back('\b'); break;
+				case 'f': buffer.push_back('\f'); break;
+				case 'n': buffer.push_back('\n'); break;
+				case 'r': buffer.push_back('\r'); break;
+				case 't': buffer.push_back('\t'); break;
+				case 'u': appendCodePoint(); break;
+				default:  fail("invalid escape");
+				}
+			}
+			if (p == end) fail("unterminated string");
+			p++;
+			return buffer;
+		}
+
+		unsigned hex4()
+		{
+			unsigned code = 0;
+			if (end - p < 4) fail("invalid \\u escape");
+			auto [last, error] = std::from_chars(p, p + 4, code, 16);
+			if (error != std::errc() || last != p + 4) fail("invalid \\u escape");
+			p += 4;
+			return code;
+		}
+
+		// \uXXXX (or a surrogate pair of them) as UTF-8
+		void appendCodePoint()
+		{
+			unsigned code = hex4();
+			if (code >= 0xD800 && code < 0xDC00)
+			{
+				if (end - p < 6 || p[0] != '\\' || p[1] != 'u') fail("unpaired surrogate");
+				p += 2;
+				unsigned low = hex4();
+				if (low < 0xDC00 || low >= 0xE000) fail("unpaired surrogate");
+				code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+			}
+
+			if (code < 0x80)
+				buffer.push_back(char(code));
+			else if (code < 0x800)
+			{
+				buffer.push_back(char(0xC0 | (code >> 6)));
+				buffer.push_back(char(0x80 | (code & 0x3F)));
+			}
+			else if (code < 0x10000)
+			{
+				buffer.push_back(char(0xE0 | (code >> 12)));
+				buffer.push_back(char(0x80 | ((code >> 6) & 0x3F)));
+				buffer.push_back(char(0x80 | (code & 0x3F)));
+			}
+			else
+			{
+				buffer.push_back(char(0xF0 | (code >> 18)));
+				buffer.push_back(char(0x80 | ((code >> 12) & 0x3F)));
+				buffer.push_back(char(0x80 | ((code >> 6) & 0x3F)));
+				buffer.push_back(char(0x80 | (code & 0x3F)));
+			}
+		}
+	};
+}
+
+
+void JSONReader::parse(std::string_view text, Handler& handler)
+{
+	Parser(text, handler).document();
+}
+
+void JSONReader::parseFile(const std::string& path, Handler& handler)
+{
+	MappedFile file(path);
+	parse({ reinterpret_cast<const char*>(file.getData()), file.getSize() }, handler);
+}
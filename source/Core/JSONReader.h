@@ -0,0 +1,40 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+
+// Event based (SAX) JSON parser: values are reported to a Handler as they are read,
+// no document tree is built, so the handler can put them straight into its own storage.
+// Numbers are read with std::from_chars, strings are only copied when they have escapes
+class JSONReader
+{
+public:
+	class Handler
+	{
+	public:
+		virtual ~Handler() = default;
+
+		virtual void beginObject() {}
+		// Name of the member whose value comes next
+		virtual void key(std::string_view name) {}
+		virtual void endObject() {}
+
+		virtual void beginArray() {}
+		virtual void endArray() {}
+
+		virtual void number(double value) {}
+		virtual void boolean(bool value) {}
+		virtual void string(std::string_view value) {}
+		virtual void null() {}
+	};
+
+	// Deeper documents are rejected rather than risking the stack
+	static const size_t MAX_DEPTH = 256;
+
+	// Throws std::runtime_error with the line of the error if the text isn't valid JSON,
+	// exceptions thrown by the handler are passed through
+	static void parse(std::string_view text, Handler& handler);
+	// The file is mapped, not read
+	static void parseFile(const std::string& path, Handler& handler);
+};
@@ -0,0 +1,94 @@
+#include "Core/LinearAlgebra.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+
+template<typename Scalar>
+void SymmetricBandMatrix<Scalar>::resize(size_t size, size_t bandwidth)
+{
+	n    = size;
+	band = (size > 0) ? std::min(bandwidth, size - 1) : 0;
+	data.assign(n * (band+1), Scalar(0));
+}
+
+template<typename Scalar>
+SymmetricBandMatrix<Scalar>& SymmetricBandMatrix<Scalar>::operator+=(const SymmetricBandMatrix& other)
+{
+	if (other.n != n || other.band != band)
+		throw std::invalid_argument
+		("SymmetricBandMatrix::operator+=: layouts differ.");
+
+	for (size_t i = 0; i < data.size(); i++)
+		data[i] += other.data[i];
+	return *this;
+}
+
+template<typename Scalar>
+void SymmetricBandMatrix<Scalar>::factorize()
+{
+	for (size_t i = 0; i < n; i++)
+	{
+		size_t first = (i > band) ? i - band : 0;
+		Scalar* rowI = &at(i, first);
+
+		for (size_t j = first; j <= i; j++)
+		{
+			// Dot product of the already factorized parts of rows i and j, both contiguous
+			size_t start = std::max(first, (j > band) ? j - band : 0);
+			const Scalar* a = rowI + (start - first);
+			const Scalar* b = &at(j, start);
+
+			Scalar sum = at(i, j);
+			for (size_t k = 0; k < j - start; k++)
+				sum -= a[k] * b[k];
+
+			if (j < i)
+				at(i, j) = sum / at(j, j);
+			else if (sum > Scalar(0))
+				at(i, i) = std::sqrt(sum);
+			else
+				throw std::runtime_error
+				("SymmetricBandMatrix::factorize: matrix isn't positive definite.");
+		}
+	}
+}
+
+
+template<typename Scalar>
+void BandMatrix<Scalar>::resize(size_t size, size_t lowerBand, size_t upperBand)
+{
+	n     = size;
+	lower = (size > 0) ? std::min(lowerBand, size - 1) : 0;
+	upper = (size > 0) ? std::min(upperBand, size - 1) : 0;
+	data.assign(n * (lower+upper+1), Scalar(0));
+}
+
+template<typename Scalar>
+void BandMatrix<Scalar>::factorize()
+{
+	for (size_t k = 0; k < n; k++)
+	{
+		Scalar pivot = at(k, k);
+		if (pivot == Scalar(0))
+			throw std::runtime_error
+			("BandMatrix::factorize: zero pivot, matrix is singular or needs pivoting.");
+
+		size_t lastRow    = std::min(n, k + lower + 1);
+		size_t lastColumn = std::min(n, k + upper + 1);
+		for (size_t i = k + 1; i < lastRow; i++)
+		{
+			Scalar factor = at(i, k) /= pivot;
+			if (factor == Scalar(0)) continue;
+			for (size_t j = k + 1; j < lastColumn; j++)
+				at(i, j) -= factor * at(k, j);
+		}
+	}
+}
+
+
+template class SymmetricBandMatrix<float>;
+template class SymmetricBandMatrix<double>;
+template class BandMatrix<float>;
+template class BandMatrix<double>;
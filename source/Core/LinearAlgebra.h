@@ -0,0 +1,124 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+
+// Symmetric positive definite matrix with nonzeros only within 'band' diagonals
+// of the main one (e.g. B-spline normal equations). Only the lower half is stored,
+// row by row, so a row is a contiguous run of band+1 values ending at the diagonal.
+//
+// Factorization is a banded Cholesky: O(size * band^2) time, O(size * band) memory
+template<typename Scalar>
+class SymmetricBandMatrix
+{
+	size_t n    = 0;
+	size_t band = 0;
+	std::vector<Scalar> data;
+
+public:
+	SymmetricBandMatrix() = default;
+	inline SymmetricBandMatrix(size_t size, size_t bandwidth) { resize(size, bandwidth); }
+
+	void resize(size_t size, size_t bandwidth);
+	inline size_t size()      const { return n; }
+	inline size_t bandwidth() const { return band; }
+
+	// Element (i, j) of the lower half, requires j <= i <= j + band
+	inline Scalar& at(size_t i, size_t j)       { return data[i * (band+1) + band + j - i]; }
+	inline Scalar  at(size_t i, size_t j) const { return data[i * (band+1) + band + j - i]; }
+
+	// Adds a matrix of the same layout (e.g. partial sums assembled on other threads)
+	SymmetricBandMatrix& operator+=(const SymmetricBandMatrix& other);
+
+	// In place L*L^T decomposition, throws if the matrix isn't positive definite
+	void factorize();
+
+	// Solves A*x = rhs in place after factorize(). Value can be anything supporting
+	// scaling and subtraction (a scalar or a glm vector for several right-hand sides at once)
+	template<typename Value>
+	void solve(std::vector<Value>& rhs) const;
+};
+
+// General square matrix with 'lower' diagonals below and 'upper' above the main one,
+// stored row by row like SymmetricBandMatrix.
+//
+// Factorized by LU without pivoting, which keeps the band and is stable for diagonally
+// dominant and totally positive matrices (B-spline collocation): O(size * lower * upper)
+template<typename Scalar>
+class BandMatrix
+{
+	size_t n     = 0;
+	size_t lower = 0;
+	size_t upper = 0;
+	std::vector<Scalar> data;
+
+public:
+	BandMatrix() = default;
+	inline BandMatrix(size_t size, size_t lowerBand, size_t upperBand) { resize(size, lowerBand, upperBand); }
+
+	void resize(size_t size, size_t lowerBand, size_t upperBand);
+	inline size_t size() const { return n; }
+	inline bool inBand(size_t i, size_t j) const { return j + lower >= i && j <= i + upper; }
+
+	// Element (i, j), requires inBand(i, j)
+	inline Scalar& at(size_t i, size_t j)       { return data[i * (lower+upper+1) + lower + j - i]; }
+	inline Scalar  at(size_t i, size_t j) const { return data[i * (lower+upper+1) + lower + j - i]; }
+
+	// In place decomposition into unit lower L and upper U, throws on a zero pivot
+	void factorize();
+
+	// Solves A*x = rhs in place after factorize(), x[i] being rhs[i * stride]
+	template<typename Value>
+	void solve(Value* rhs, size_t stride = 1) const;
+	template<typename Value>
+	inline void solve(std::vector<Value>& rhs) const { solve(rhs.data()); }
+};
+
+
+template<typename Scalar>
+template<typename Value>
+void SymmetricBandMatrix<Scalar>::solve(std::vector<Value>& x) const
+{
+	// Forward substitution with L
+	for (size_t i = 0; i < n; i++)
+	{
+		size_t first = (i > band) ? i - band : 0;
+		for (size_t j = first; j < i; j++)
+			x[i] -= x[j] * at(i, j);
+		x[i] /= at(i, i);
+	}
+	// Backward substitution with L^T
+	for (size_t i = n; i-- > 0;)
+	{
+		x[i] /= at(i, i);
+		size_t first = (i > band) ? i - band : 0;
+		for (size_t j = first; j < i; j++)
+			x[j] -= x[i] * at(i, j);
+	}
+}
+
+template<typename Scalar>
+template<typename Value>
+void BandMatrix<Scalar>::solve(Value* x, size_t stride) const
+{
+	for (size_t i = 0; i < n; i++)
+	{
+		size_t first = (i > lower) ? i - lower : 0;
+		for (size_t j = first; j < i; j++)
+			x[i * stride] -= x[j * stride] * at(i, j);
+	}
+	for (size_t i = n; i-- > 0;)
+	{
+		size_t last = std::min(n, i + upper + 1);
+		for (size_t j = i + 1; j < last; j++)
+			x[i * stride] -= x[j * stride] * at(i, j);
+		x[i * stride] /= at(i, i);
+	}
+}
+
+extern template class SymmetricBandMatrix<float>;
+extern template class SymmetricBandMatrix<double>;
+extern template class BandMatrix<float>;
+extern template class BandMatrix<double>;
@@ -1,8 +1,53 @@
 #include "Core/Base.h"
+#include "Core/Benchmark.h"
+#include "Core/Headless.h"
 #include "Core/Window.h"
 
 int main(int argc, char** argv)
 {
+	// Optional scene to open instead of the default one, "--headless" draws it offscreen
+	// and "--benchmark" times the CPU core on it
+	Benchmark::Settings benchmarkSettings;
+	Headless::Settings settings;
+	bool benchmark = false, headless = false;
+	try
+	{
+		benchmark = Benchmark::parse(argc, argv, benchmarkSettings);
+		if (!benchmark) headless = Headless::parse(argc, argv, settings);
+	}
+	catch (const std::invalid_argument& e)
+	{
+		std::cerr << e.what() << '\n' << Headless::usage() << Benchmark::usage();
+		return 1;
+	}
+
+	if (benchmark)
+	{
+		try { Benchmark::run(benchmarkSettings); }
+		catch (const std::exception& e)
+		{
+			std::cerr << e.what() << '\n';
+			return 1;
+		}
+		return 0;
+	}
+
+	if (headless)
+	{
+		try
+		{
+			if (settings.mode == Headless::EVALUATE) Headless(settings).evaluate();
+			else Headless(settings).run();
+		}
+		catch (const std::exception& e)
+		{
+			std::cerr << e.what() << '\n';
+			return 1;
+		}
+		return 0;
+	}
+
 	Window window = Window("CourseWork App");
+	if (!settings.scene.empty()) window.getGUI().loadScene(settings.scene);
 	window.mainloop();
 }
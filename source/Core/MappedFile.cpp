@@ -0,0 +1,115 @@
+#include "Core/MappedFile.h"
+
+#include <stdexcept>
+#include <utility>
+#include "Core/PlatformDetector.h"
+
+#if defined(CW_PLATFORM_WINDOWS)
+	#define WIN32_LEAN_AND_MEAN
+	#define NOMINMAX
+	#include <Windows.h>
+#else
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+{
+	*this = std::move(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+	if (this == &other) return *this;
+
+	close();
+	data    = std::exchange(other.data, nullptr);
+	size    = std::exchange(other.size, 0);
+	file    = std::exchange(other.file, nullptr);
+	mapping = std::exchange(other.mapping, nullptr);
+	return *this;
+}
+
+void MappedFile::open(const std::string& path)
+{
+	close();
+
+#if defined(CW_PLATFORM_WINDOWS)
+	HANDLE handle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+		OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS, nullptr);
+	if (handle == INVALID_HANDLE_VALUE)
+		throw std::runtime_error
+		("MappedFile::open: can't open " + path);
+	file = handle;
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(handle, &fileSize))
+	{
+		close();
+		throw std::runtime_error
+		("MappedFile::open: can't get the size of " + path);
+	}
+	// Empty files have nothing to map
+	if (fileSize.QuadPart == 0)
+	{
+		close();
+		return;
+	}
+	size = size_t(fileSize.QuadPart);
+
+	mapping = CreateFileMappingA(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (mapping)
+		data = static_cast<const std::byte*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+#else
+	int descriptor = ::open(path.c_str(), O_RDONLY);
+	if (descriptor < 0)
+		throw std::runtime_error
+		("MappedFile::open: can't open " + path);
+
+	struct stat info;
+	if (fstat(descriptor, &info) != 0)
+	{
+		::close(descriptor);
+		throw std::runtime_error
+		("MappedFile::open: can't get the size of " + path);
+	}
+	if (info.st_size == 0)
+	{
+		::close(descriptor);
+		return;
+	}
+	size = size_t(info.st_size);
+
+	// The mapping keeps its own reference to the file
+	void* address = mmap(nullptr, size, PROT_READ, MAP_SHARED, descriptor, 0);
+	::close(descriptor);
+	if (address != MAP_FAILED)
+		data = static_cast<const std::byte*>(address);
+#endif
+
+	if (!data)
+	{
+		close();
+		throw std::runtime_error
+		("MappedFile::open: can't map " + path);
+	}
+}
+
+void MappedFile::close()
+{
+#if defined(CW_PLATFORM_WINDOWS)
+	if (data)    UnmapViewOfFile(data);
+	if (mapping) CloseHandle(mapping);
+	if (file)    CloseHandle(file);
+#else
+	if (data) munmap(const_cast<std::byte*>(data), size);
+#endif
+
+	data    = nullptr;
+	size    = 0;
+	file    = nullptr;
+	mapping = nullptr;
+}
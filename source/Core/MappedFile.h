@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+
+// Read-only memory mapping of a whole file. Pages are loaded on first access
+// and shared with every other process mapping the same file
+class MappedFile
+{
+	const std::byte* data = nullptr;
+	size_t size = 0;
+
+	// Platform handles (file & mapping objects on Windows)
+	void* file    = nullptr;
+	void* mapping = nullptr;
+
+public:
+	MappedFile() = default;
+	inline explicit MappedFile(const std::string& path) { open(path); }
+	inline ~MappedFile() { close(); }
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+	MappedFile(MappedFile&& other) noexcept;
+	MappedFile& operator=(MappedFile&& other) noexcept;
+
+	// Throws std::runtime_error if the file can't be opened or mapped, an empty file maps to no data
+	void open(const std::string& path);
+	void close();
+
+	inline bool isOpen() const { return data != nullptr; }
+	inline const std::byte* getData() const { return data; }
+	inline size_t getSize() const { return size; }
+};
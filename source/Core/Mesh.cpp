@@ -0,0 +1,24 @@
+#include "Core/Mesh.h"
+
+#include "Core/Parallel.h"
+
+
+void Mesh::calculateNormals()
+{
+	normals.assign(vertices.size(), glm::vec3(0.f));
+
+	// Accumulating per face is a scatter, so it stays single threaded
+	for (size_t t = 0; t + 2 < indices.size(); t += 3)
+	{
+		uint32_t a = indices[t], b = indices[t+1], c = indices[t+2];
+		glm::vec3 n = glm::cross(vertices[b] - vertices[a], vertices[c] - vertices[a]);
+
+		normals[a] += n; normals[b] += n; normals[c] += n;
+	}
+
+	Parallel::forEach(0, normals.size(), [this](size_t i)
+	{
+		float length = glm::length(normals[i]);
+		normals[i] = (length > 0.f) ? normals[i] / length : glm::vec3(0.f, 0.f, 1.f);
+	});
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "glm/glm.hpp"
+
+
+// Indexed triangle mesh, every 3 consecutive indices make a triangle
+struct Mesh
+{
+	std::vector<glm::vec3> vertices;
+	std::vector<glm::vec3> normals;
+	std::vector<uint32_t>  indices;
+
+	inline size_t triangleCount() const { return indices.size() / 3; }
+	inline void clear() { vertices.clear(); normals.clear(); indices.clear(); }
+
+	// Area-weighted vertex normals
+	void calculateNormals();
+};
@@ -0,0 +1,250 @@
+#include "Core/MeshExport.h"
+
+#include <algorithm>
+#include <bit>
+#include <cctype>
+#include <charconv>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+#include "Core/Parallel.h"
+
+// Binary formats are written straight from memory, both STL and glTF are little endian
+static_assert(std::endian::native == std::endian::little, "MeshExport requires a little endian host");
+
+
+namespace
+{
+	std::ofstream create(const std::string& path, const char* function)
+	{
+		std::ofstream out(path, std::ios::binary | std::ios::trunc);
+		if (!out)
+			throw std::runtime_error
+			(std::string("MeshExport::") + function + ": can't create " + path);
+		return out;
+	}
+
+	void check(const std::ofstream& out, const std::string& path, const char* function)
+	{
+		if (!out)
+			throw std::runtime_error
+			(std::string("MeshExport::") + function + ": failed to write " + path);
+	}
+
+	// Splits [0, count) into chunks of CHUNK_ITEMS, formats a round of them in parallel
+	// (format(first, last, buffer) appends to the buffer) and writes them in order
+	template<typename Format>
+	void writeChunks(std::ofstream& out, size_t count, Format&& format)
+	{
+		const size_t CHUNK = MeshExport::CHUNK_ITEMS;
+		std::vector<std::string> buffers(Parallel::threadCount());
+
+		for (size_t round = 0; round < count; round += CHUNK * buffers.size())
+		{
+			size_t chunks = std::min(buffers.size(), (count - round + CHUNK - 1) / CHUNK);
+			Parallel::forEach(0, chunks, [&](size_t c)
+			{
+				size_t first = round + c * CHUNK;
+				buffers[c].clear();
+				format(first, std::min(count, first + CHUNK), buffers[c]);
+			}, 1);
+
+			for (size_t c = 0; c < chunks; c++)
+				out.write(buffers[c].data(), std::streamsize(buffers[c].size()));
+		}
+	}
+
+	// "prefix x y z\n" with the shortest representation of every coordinate
+	void appendVector(std::string& buffer, const char* prefix, const glm::vec3& v)
+	{
+		char line[128];
+		char* p = line;
+		for (; *prefix; prefix++) *p++ = *prefix;
+		for (int c = 0; c < 3; c++)
+		{
+			*p++ = ' ';
+			p = std::to_chars(p, line + sizeof(line), v[c]).ptr;
+		}
+		*p++ = '\n';
+		buffer.append(line, p);
+	}
+}
+
+
+void MeshExport::writeOBJ(const Mesh& mesh, const std::string& path)
+{
+	std::ofstream out = create(path, "writeOBJ");
+	bool withNormals = mesh.normals.size() == mesh.vertices.size();
+
+	writeChunks(out, mesh.vertices.size(), [&mesh](size_t first, size_t last, std::string& buffer)
+	{
+		for (size_t i = first; i < last; i++) appendVector(buffer, "v", mesh.vertices[i]);
+	});
+	if (withNormals)
+		writeChunks(out, mesh.normals.size(), [&mesh](size_t first, size_t last, std::string& buffer)
+		{
+			for (size_t i = first; i < last; i++) appendVector(buffer, "vn", mesh.normals[i]);
+		});
+
+	// "f a//a b//b c//c" (or "f a b c"), indices are 1-based
+	writeChunks(out, mesh.triangleCount(), [&mesh, withNormals](size_t first, size_t last, std::string& buffer)
+	{
+		char line[128];
+		for (size_t t = first; t < last; t++)
+		{
+			char* p = line;
+			*p++ = 'f';
+			for (int k = 0; k < 3; k++)
+			{
+				uint32_t index = mesh.indices[t * 3 + k] + 1;
+				*p++ = ' ';
+				p = std::to_chars(p, line + sizeof(line), index).ptr;
+				if (withNormals)
+				{
+					std::memcpy(p, "//", 2);
+					p += 2;
+					p = std::to_chars(p, line + sizeof(line), index).ptr;
+				}
+			}
+			*p++ = '\n';
+			buffer.append(line, p);
+		}
+	});
+
+	check(out, path, "writeOBJ");
+}
+
+void MeshExport::writeSTL(const Mesh& mesh, const std::string& path)
+{
+	const size_t RECORD = 50;  // Normal, 3 vertices, attribute byte count
+
+	std::ofstream out = create(path, "writeSTL");
+
+	// Header mustn't start with "solid", readers would take the file for ASCII STL
+	char header[80] = "Binary STL";
+	uint32_t count = uint32_t(mesh.triangleCount());
+	out.write(header, sizeof(header));
+	out.write(reinterpret_cast<const char*>(&count), sizeof(count));
+
+	writeChunks(out, mesh.triangleCount(), [&mesh](size_t first, size_t last, std::string& buffer)
+	{
+		buffer.resize((last - first) * RECORD);
+		char* record = buffer.data();
+		for (size_t t = first; t < last; t++, record += RECORD)
+		{
+			glm::vec3 v[3];
+			for (int k = 0; k < 3; k++) v[k] = mesh.vertices[mesh.indices[t * 3 + k]];
+
+			glm::vec3 normal = glm::cross(v[1] - v[0], v[2] - v[0]);
+			float length = glm::length(normal);
+			if (length > 0.f) normal /= length;
+
+			std::memcpy(record, &normal, 12);
+			std::memcpy(record + 12, v, 36);
+			std::memset(record + 48, 0, 2);
+		}
+	});
+
+	check(out, path, "writeSTL");
+}
+
+void MeshExport::writeGLB(const Mesh& mesh, const std::string& path)
+{
+	const uint32_t MAGIC = 0x46546C67, VERSION = 2;  // "glTF"
+	const uint32_t JSON  = 0x4E4F534A, BIN = 0x004E4942;
+	const uint32_t ARRAY_BUFFER = 34962, ELEMENT_ARRAY_BUFFER = 34963;
+	const uint32_t FLOAT = 5126, UNSIGNED_INT = 5125, TRIANGLES = 4;
+
+	if (mesh.vertices.empty())
+		throw std::runtime_error
+		("MeshExport::writeGLB: mesh has no vertices.");
+
+	bool withNormals = mesh.normals.size() == mesh.vertices.size();
+	uint64_t vertexBytes = mesh.vertices.size() * sizeof(glm::vec3);
+	uint64_t normalBytes = withNormals ? vertexBytes : 0;
+	uint64_t indexBytes  = mesh.indices.size() * sizeof(uint32_t);
+	uint64_t binBytes    = vertexBytes + normalBytes + indexBytes;
+
+	// POSITION accessors are required to have bounds
+	glm::vec3 min = mesh.vertices[0], max = mesh.vertices[0];
+	for (auto& vertex : mesh.vertices)
+	{
+		min = glm::min(min, vertex);
+		max = glm::max(max, vertex);
+	}
+
+	auto number = [](auto value)
+	{
+		char text[32];
+		return std::string(text, std::to_chars(text, text + sizeof(text), value).ptr);
+	};
+	auto vec3 = [&number](const glm::vec3& v)
+	{ return "[" + number(v.x) + "," + number(v.y) + "," + number(v.z) + "]"; };
+	auto view = [&number](uint64_t offset, uint64_t length, uint32_t target)
+	{
+		return "{\"buffer\":0,\"byteOffset\":" + number(offset) + ",\"byteLength\":" + number(length) +
+			",\"target\":" + number(target) + "}";
+	};
+
+	std::string views = view(0, vertexBytes, ARRAY_BUFFER);
+	std::string accessors = "{\"bufferView\":0,\"componentType\":" + number(FLOAT) + ",\"count\":" +
+		number(mesh.vertices.size()) + ",\"type\":\"VEC3\",\"min\":" + vec3(min) + ",\"max\":" + vec3(max) + "}";
+	std::string attributes = "\"POSITION\":0";
+	if (withNormals)
+	{
+		views += "," + view(vertexBytes, normalBytes, ARRAY_BUFFER);
+		accessors += ",{\"bufferView\":1,\"componentType\":" + number(FLOAT) + ",\"count\":" +
+			number(mesh.normals.size()) + ",\"type\":\"VEC3\"}";
+		attributes += ",\"NORMAL\":1";
+	}
+	uint32_t indexView = withNormals ? 2 : 1;
+	views += "," + view(vertexBytes + normalBytes, indexBytes, ELEMENT_ARRAY_BUFFER);
+	accessors += ",{\"bufferView\":" + number(indexView) + ",\"componentType\":" + number(UNSIGNED_INT) +
+		",\"count\":" + number(mesh.indices.size()) + ",\"type\":\"SCALAR\"}";
+
+	std::string json =
+		"{\"asset\":{\"version\":\"2.0\",\"generator\":\"CourseWork\"},"
+		"\"scene\":0,\"scenes\":[{\"nodes\":[0]}],\"nodes\":[{\"mesh\":0}],"
+		"\"meshes\":[{\"primitives\":[{\"attributes\":{" + attributes + "},\"indices\":" + number(indexView) +
+		",\"mode\":" + number(TRIANGLES) + "}]}],"
+		"\"buffers\":[{\"byteLength\":" + number(binBytes) + "}],"
+		"\"bufferViews\":[" + views + "],\"accessors\":[" + accessors + "]}";
+	// Chunks are 4-byte aligned, JSON is padded with spaces (all binary arrays are multiples of 4)
+	json.resize((json.size() + 3) / 4 * 4, ' ');
+
+	uint32_t jsonHeader[2] = { uint32_t(json.size()), JSON };
+	uint32_t binHeader[2]  = { uint32_t(binBytes), BIN };
+	uint32_t header[3]     = { MAGIC, VERSION, uint32_t(12 + 8 + json.size() + 8 + binBytes) };
+
+	std::ofstream out = create(path, "writeGLB");
+	out.write(reinterpret_cast<const char*>(header), sizeof(header));
+	out.write(reinterpret_cast<const char*>(jsonHeader), sizeof(jsonHeader));
+	out.write(json.data(), std::streamsize(json.size()));
+	out.write(reinterpret_cast<const char*>(binHeader), sizeof(binHeader));
+
+	out.write(reinterpret_cast<const char*>(mesh.vertices.data()), std::streamsize(vertexBytes));
+	if (withNormals)
+		out.write(reinterpret_cast<const char*>(mesh.normals.data()), std::streamsize(normalBytes));
+	out.write(reinterpret_cast<const char*>(mesh.indices.data()), std::streamsize(indexBytes));
+
+	check(out, path, "writeGLB");
+}
+
+void MeshExport::write(const Mesh& mesh, const std::string& path)
+{
+	auto extension = [&path](const char* suffix)
+	{
+		size_t length = std::strlen(suffix);
+		if (path.size() < length) return false;
+		return std::equal(path.end() - length, path.end(), suffix,
+			[](char a, char b) { return std::tolower((unsigned char)a) == b; });
+	};
+
+	if      (extension(".obj")) writeOBJ(mesh, path);
+	else if (extension(".stl")) writeSTL(mesh, path);
+	else if (extension(".glb")) writeGLB(mesh, path);
+	else
+		throw std::runtime_error
+		("MeshExport::write: unknown format of " + path + ", expected .obj, .stl or .glb");
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <string>
+
+#include "Core/Mesh.h"
+
+
+// Mesh writers. Text and records are produced in chunks of CHUNK_ITEMS items,
+// a round of chunks being formatted in parallel and written with one call per chunk,
+// so memory use doesn't grow with the size of the file.
+// Arrays that already have the file layout (glTF buffers) are written straight from the mesh
+namespace MeshExport
+{
+	static const size_t CHUNK_ITEMS = 1 << 15;
+
+	// Wavefront OBJ with normals (if the mesh has one per vertex), shortest round-trip floats
+	void writeOBJ(const Mesh& mesh, const std::string& path);
+	// Binary STL, facet normals are computed from the triangles
+	void writeSTL(const Mesh& mesh, const std::string& path);
+	// Binary glTF 2.0 (.glb) holding one mesh
+	void writeGLB(const Mesh& mesh, const std::string& path);
+
+	// Format by extension: .obj, .stl or .glb.
+	// All writers throw std::runtime_error if the file can't be written
+	void write(const Mesh& mesh, const std::string& path);
+}
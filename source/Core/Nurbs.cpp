@@ -2,51 +2,257 @@
 
 #include <iostream>
 #include <stdexcept>
+#include <string>
+#include "Core/TextStream.h"
 
-const float NURBS::DEFAULT_STEP = 1.0f;
-const char* NURBS::dim_char[2]  = { "U", "V" };
+// Shorthands for out-of-class member definitions, undefined at the end of the file
+#define NURBS_TEMPLATE template<typename Scalar, int PointDim, int ParamDim>
+#define NURBS_CLASS    BasicNURBS<Scalar, PointDim, ParamDim>
 
+NURBS_TEMPLATE
+const Scalar NURBS_CLASS::DEFAULT_STEP = Scalar(1);
+NURBS_TEMPLATE
+const char* NURBS_CLASS::dim_char[3] = { "U", "V", "W" };
 
-NURBS::NURBS(size_t dimU, size_t dimV)
+
+NURBS_TEMPLATE
+NURBS_CLASS::BasicNURBS(const index_t& dims)
 {
-	setDim(U, dimU); setDegree(U);
-	setDim(V, dimV); setDegree(V);
+	size_t count = 1;
+	for (int d = 0; d < ParamDim; d++)
+	{
+		clampKnots[d][START] = clampKnots[d][END] = true;
+		degree[d] = DEFAULT_DEGREE;
+
+		setDim(Dim(d), dims[d]); setDegree(Dim(d));
+		count *= dim[d];
+	}
 	
-	controlPoints = std::vector<glm::vec3>(dim[U] * dim[V]);
+	// Initial net is a regular grid centered at the origin
+	controlPoints = cp_t(count, point_t(Scalar(0)));
 	for (size_t i = 0; i < controlPoints.size(); i++)
-		controlPoints[i] = glm::vec3
-		(
-			(1.f - dim[U]) / 2.f + index2uv(i, U),
-			(1.f - dim[V]) / 2.f + index2uv(i, V),
-			0.f
-		);
+		for (int d = 0; d < std::min(ParamDim, PointDim); d++)
+			controlPoints[i][d] = (Scalar(1) - dim[d]) / Scalar(2) + index2uv(i, Dim(d));
 }
 
-glm::vec3 NURBS::calculateCenter()
+NURBS_TEMPLATE
+template<typename OtherScalar>
+NURBS_CLASS::BasicNURBS(const BasicNURBS<OtherScalar, PointDim, ParamDim>& other)
 {
-	glm::vec3 min, max;
-	min = max = controlPoints[0];
+	for (int d = 0; d < ParamDim; d++)
+	{
+		dim[d]    = other.dim[d];
+		degree[d] = other.degree[d];
 
-	for (auto& cp : controlPoints)
+		clampKnots[d][START] = other.clampKnots[d][START];
+		clampKnots[d][END]   = other.clampKnots[d][END];
+
+		knots[d].assign(other.knots[d].begin(), other.knots[d].end());
+	}
+
+	controlPoints.reserve(other.controlPoints.size());
+	for (auto& cp : other.controlPoints)
+		controlPoints.emplace_back(cp);
+	weights.assign(other.weights.begin(), other.weights.end());
+}
+
+NURBS_TEMPLATE
+void NURBS_CLASS::setControlPoint(size_t i, const point_t& point)
+{
+	point_t old = controlPoints[i];
+	controlPoints[i] = point;
+	revision++;
+
+	// Nothing to maintain, the next query rebuilds everything anyway
+	if (cache.dirty) return;
+
+	// A box only has to be recomputed when the old point could have been on its boundary
+	auto update = [&old, &point](aabb_t& box, auto&& recompute)
 	{
-		for (int i = 0; i < 3; i++)
+		if (box.containsInterior(old)) box.expand(point);
+		else                           box = recompute();
+	};
+
+	index_t uvw;
+	for (int d = 0; d < ParamDim; d++) uvw[d] = index2uv(i, Dim(d));
+
+	for (int d = 0; d < ParamDim; d++)
+		update(cache.layers[d][uvw[d]], [&]()
 		{
-			if (cp[i] < min[i]) min[i] = cp[i];
-			if (cp[i] > max[i]) max[i] = cp[i];
-		}
+			index_t begin = filled(0), end;
+			for (int k = 0; k < ParamDim; k++) end[k] = dim[k];
+			begin[d] = uvw[d]; end[d] = uvw[d] + 1;
+
+			return blockBounds(begin, end);
+		});
+
+	for (size_t patch : controlPointPatches(i))
+		update(cache.patches[patch], [&]()
+		{
+			index_t spanIndex = patchSpans(patch);
+			return blockBounds(patchBlockBegin(spanIndex), patchBlockEnd(spanIndex));
+		});
+
+	// Whole net is the union of the layers along the shortest direction
+	update(cache.net, [this]()
+	{
+		int shortest = 0;
+		for (int d = 1; d < ParamDim; d++)
+			if (dim[d] < dim[shortest]) shortest = d;
+
+		aabb_t box;
+		for (auto& layer : cache.layers[shortest]) box.expand(layer);
+		return box;
+	});
+}
+
+
+NURBS_TEMPLATE
+const typename NURBS_CLASS::aabb_t& NURBS_CLASS::bounds() const
+{
+	if (cache.dirty) rebuildBounds();
+	return cache.net;
+}
+
+NURBS_TEMPLATE
+const typename NURBS_CLASS::aabb_t& NURBS_CLASS::layerBounds(Dim d, size_t layer) const
+{
+	if (cache.dirty) rebuildBounds();
+	return cache.layers[d][layer];
+}
+
+NURBS_TEMPLATE
+const std::vector<size_t>& NURBS_CLASS::spans(Dim d) const
+{
+	if (cache.dirty) rebuildBounds();
+	return cache.spans[d];
+}
+
+NURBS_TEMPLATE
+size_t NURBS_CLASS::patchCount() const
+{
+	if (cache.dirty) rebuildBounds();
+	return cache.patches.size();
+}
+
+NURBS_TEMPLATE
+const typename NURBS_CLASS::aabb_t& NURBS_CLASS::patchBounds(size_t patch) const
+{
+	if (cache.dirty) rebuildBounds();
+	return cache.patches[patch];
+}
+
+NURBS_TEMPLATE
+typename NURBS_CLASS::index_t NURBS_CLASS::patchSpans(size_t patch) const
+{
+	if (cache.dirty) rebuildBounds();
+
+	index_t spanIndex;
+	for (int d = 0; d < ParamDim; d++)
+	{
+		size_t count = cache.spans[d].size();
+		spanIndex[d] = cache.spans[d][patch % count];
+		patch /= count;
 	}
+	return spanIndex;
+}
+
+NURBS_TEMPLATE
+std::vector<size_t> NURBS_CLASS::controlPointPatches(size_t i) const
+{
+	if (cache.dirty) rebuildBounds();
+
+	// Point uvw is in the block of spans s with s - degree <= uvw <= s
+	index_t begin, end, patchStride;
+	for (int d = 0; d < ParamDim; d++)
+	{
+		const std::vector<size_t>& s = cache.spans[d];
+		size_t uvw = index2uv(i, Dim(d));
 
-	return (max + min) / 2.f;
+		begin[d] = std::lower_bound(s.begin(), s.end(), uvw) - s.begin();
+		end[d]   = std::upper_bound(s.begin(), s.end(), uvw + degree[d]) - s.begin();
+
+		patchStride[d] = (d == 0) ? 1 : patchStride[d-1] * cache.spans[d-1].size();
+	}
+
+	std::vector<size_t> patches;
+	forEachIndex(begin, end, [&](const index_t& position)
+	{
+		size_t patch = 0;
+		for (int d = 0; d < ParamDim; d++) patch += position[d] * patchStride[d];
+		patches.push_back(patch);
+	});
+	return patches;
+}
+
+NURBS_TEMPLATE
+void NURBS_CLASS::rebuildBounds() const
+{
+	cache.net = aabb_t();
+	for (int d = 0; d < ParamDim; d++)
+		cache.layers[d].assign(dim[d], aabb_t());
+
+	// Single pass over the net for the whole box & all the layers
+	index_t uvw = filled(0);
+	for (auto& cp : controlPoints)
+	{
+		cache.net.expand(cp);
+		for (int d = 0; d < ParamDim; d++)
+			cache.layers[d][uvw[d]].expand(cp);
+
+		for (int d = 0; d < ParamDim && ++uvw[d] == dim[d]; d++)
+			uvw[d] = 0;
+	}
+
+	index_t spanCount;
+	for (int d = 0; d < ParamDim; d++)
+	{
+		cache.spans[d].clear();
+		for (size_t s = degree[d]; s < dim[d]; s++)
+			if (knots[d][s] < knots[d][s+1])
+				cache.spans[d].push_back(s);
+		spanCount[d] = cache.spans[d].size();
+	}
+
+	cache.patches.clear();
+	forEachIndex(filled(0), spanCount, [this](const index_t& position)
+	{
+		index_t spanIndex;
+		for (int d = 0; d < ParamDim; d++) spanIndex[d] = cache.spans[d][position[d]];
+
+		cache.patches.push_back(blockBounds(patchBlockBegin(spanIndex), patchBlockEnd(spanIndex)));
+	});
+
+	cache.dirty = false;
+}
+
+NURBS_TEMPLATE
+typename NURBS_CLASS::aabb_t NURBS_CLASS::blockBounds(const index_t& begin, const index_t& end) const
+{
+	// Rows along U are contiguous, so only the outer directions are iterated over
+	index_t rowEnd = end;
+	rowEnd[U] = begin[U] + 1;
+
+	size_t length = end[U] - begin[U];
+
+	aabb_t box;
+	forEachIndex(begin, rowEnd, [&](const index_t& uvw)
+	{
+		const point_t* row = &controlPoints[uvw2index(uvw)];
+		for (size_t u = 0; u < length; u++) box.expand(row[u]);
+	});
+	return box;
 }
 
 
-void NURBS::setKnots(Dim d)
+NURBS_TEMPLATE
+void NURBS_CLASS::setKnots(Dim d)
 {
 	size_t knotCount = dim[d] + degree[d];
 	knots[d].resize(knotCount+1);
 
-	float uniform_delta = 1.f / (knotCount - (clampKnots[d][START]+clampKnots[d][END]) * degree[d]);
-	float stash = 0.f;
+	Scalar uniform_delta = Scalar(1) / (knotCount - (clampKnots[d][START]+clampKnots[d][END]) * degree[d]);
+	Scalar stash = Scalar(0);
 
 	for (int i = 0; i < knots[d].size(); i++)
 	{
@@ -54,18 +260,37 @@ void NURBS::setKnots(Dim d)
 		             (clampKnots[d][END]   && i >= knotCount - degree[d]);
 
 		knots[d][i] = stash;
-		stash += (clamp) ? 0.f : uniform_delta;
+		stash += (clamp) ? Scalar(0) : uniform_delta;
 	}
+	invalidate();
+}
+
+NURBS_TEMPLATE
+void NURBS_CLASS::setKnots(Dim d, std::vector<Scalar> values)
+{
+	if (values.size() != dim[d] + degree[d] + 1)
+		throw std::invalid_argument
+		("NURBS::setKnots: knot count has to be dim + degree + 1.");
+	if (!std::is_sorted(values.begin(), values.end()) || values[degree[d]] >= values[dim[d]])
+		throw std::invalid_argument
+		("NURBS::setKnots: knots have to be non-decreasing with a nonempty domain.");
+
+	knots[d] = std::move(values);
+	clampKnots[d][START] = knots[d][0] == knots[d][degree[d]];
+	clampKnots[d][END]   = knots[d][dim[d]] == knots[d].back();
+	invalidate();
 }
 
-void NURBS::setDegree(Dim d, size_t value)
+NURBS_TEMPLATE
+void NURBS_CLASS::setDegree(Dim d, size_t value)
 {
 	degree[d] = std::clamp(value, MIN_DEGREE, getMaxDegree(d));
 	setKnots(d);
 }
 
 
-void NURBS::setDim(Dim d, size_t value)
+NURBS_TEMPLATE
+void NURBS_CLASS::setDim(Dim d, size_t value)
 {
 	if (value < MIN_DIM || value > MAX_DIM)
 		throw std::invalid_argument
@@ -75,89 +300,400 @@ void NURBS::setDim(Dim d, size_t value)
 	setDegree(d, degree[d]);
 }
 
-void NURBS::removeDim(Dim d, size_t layer)
+NURBS_TEMPLATE
+void NURBS_CLASS::removeDim(Dim d, size_t layer)
 {
-	if (layer < 0 || layer > dim[d])
+	if (layer < 0 || layer >= dim[d])
 		throw std::invalid_argument
 		("NURBS::removeDim: place is out of range.");
 
+	cp_t result = withoutLayer(controlPoints, d, layer);
+	std::vector<Scalar> resultWeights;
+	if (isRational()) resultWeights = withoutLayer(weights, d, layer);
+
+	// Nothing is replaced if setDim throws (at MIN_DIM), weights stay one per point
 	setDim(d, dim[d] - 1);
-	switch (d)
-	{
-	case U:
-		for (int i = 0; i < dim[V]; i++)
-			controlPoints.erase(controlPoints.begin() + uv2index(layer, i));
-		break;
-	case V:
-		cp_t::iterator start = controlPoints.begin() + uv2index(0, layer);
-		controlPoints.erase(start, start+dim[U]);
-		break;
-	}
+	controlPoints = std::move(result);
+	if (isRational()) weights = std::move(resultWeights);
+	invalidate();
 }
 
-void NURBS::insertDim(Dim d, size_t layer, std::vector<glm::vec3> newCP)
+NURBS_TEMPLATE
+void NURBS_CLASS::insertDim(Dim d, size_t layer, cp_t newCP)
 {
-	if (newCP.size() != dim[reverseDim(d)])
+	if (newCP.size() != layerSize(d))
 		throw std::invalid_argument
 		("NURBS::insertDim: newCP size doesn't equal to the number of control points in the other dimension.");
 	if (layer < 0 || layer > dim[d])
 		throw std::invalid_argument
 		("NURBS::insertDim: place is out of range.");
 
+	cp_t result = withLayer(controlPoints, d, layer, newCP);
+	// Inserted points get unit weight
+	std::vector<Scalar> resultWeights;
+	if (isRational()) resultWeights = withLayer(weights, d, layer, std::vector<Scalar>(newCP.size(), Scalar(1)));
+
+	// Nothing is replaced if setDim throws (at MAX_DIM), weights stay one per point
 	setDim(d, dim[d] + 1);
+	controlPoints = std::move(result);
+	if (isRational()) weights = std::move(resultWeights);
+	invalidate();
+}
+
+NURBS_TEMPLATE
+template<typename T>
+std::vector<T> NURBS_CLASS::withoutLayer(const std::vector<T>& data, Dim d, size_t layer) const
+{
+	// The net is a sequence of 'outer' blocks, each holding dim[d] layers of 'inner' points
+	size_t inner = stride(d);
+	size_t outer = data.size() / (inner * dim[d]);
+
+	std::vector<T> result;
+	result.reserve(data.size() - inner * outer);
+	for (size_t o = 0; o < outer; o++)
+	{
+		auto block = data.begin() + o * inner * dim[d];
+		result.insert(result.end(), block, block + layer * inner);
+		result.insert(result.end(), block + (layer+1) * inner, block + dim[d] * inner);
+	}
+	return result;
+}
+
+NURBS_TEMPLATE
+template<typename T>
+std::vector<T> NURBS_CLASS::withLayer(const std::vector<T>& data, Dim d, size_t layer,
+	const std::vector<T>& values) const
+{
+	size_t inner = stride(d);
+	size_t outer = data.size() / (inner * dim[d]);
 
-	controlPoints.reserve(dim[U] * dim[V]);
-	switch (d)
+	std::vector<T> result;
+	result.reserve(data.size() + values.size());
+	for (size_t o = 0; o < outer; o++)
 	{
-	case U:
-		for (int i = 0; i < dim[V]; i++)
-			controlPoints.emplace(controlPoints.begin() + uv2index(layer, i), newCP[i]);
-		break;
-	case V:
-		controlPoints.insert(controlPoints.begin() + uv2index(0, layer),
-			newCP.begin(), newCP.end());
-		break;
+		auto block = data.begin() + o * inner * dim[d];
+		result.insert(result.end(), block, block + layer * inner);
+		result.insert(result.end(), values.begin() + o * inner, values.begin() + (o+1) * inner);
+		result.insert(result.end(), block + layer * inner, block + dim[d] * inner);
 	}
+	return result;
 }
 
-std::vector<glm::vec3> NURBS::interpolateCP(Dim d, size_t layer)
+NURBS_TEMPLATE
+typename NURBS_CLASS::cp_t NURBS_CLASS::interpolateCP(Dim d, size_t layer) const
 {
-	std::vector<glm::vec3> cp(dim[reverseDim(d)], glm::vec3(0.f));
+	size_t inner = stride(d);
+	size_t block = inner * dim[d];
+
+	cp_t cp(layerSize(d), point_t(Scalar(0)));
 	for (size_t i = 0; i < cp.size(); i++)
 	{
-		float step = 0.f;
-		switch (d)
+		// Index of the i-th point of the layer preceding/following the inserted one
+		size_t base = (i / inner) * block + i % inner;
+
+		Scalar step = Scalar(0);
+		if (layer > 0)      cp[i] += controlPoints[base + (layer-1) * inner];
+		else                step  -= DEFAULT_STEP;
+		if (layer < dim[d]) cp[i] += controlPoints[base + layer * inner];
+		else                step  += DEFAULT_STEP;
+
+		if (d < PointDim) cp[i][d] += step;
+		if (!step) cp[i] /= Scalar(2);
+	}
+	return cp;
+}
+
+
+NURBS_TEMPLATE
+size_t NURBS_CLASS::findSpan(Dim d, Scalar t) const
+{
+	const std::vector<Scalar>& k = knots[d];
+	size_t p = degree[d], n = dim[d];
+
+	if (t >= k[n])
+	{
+		// The end of the domain belongs to the last non-empty span
+		size_t span = n - 1;
+		while (span > p && k[span] == k[n]) span--;
+		return span;
+	}
+	if (t <= k[p]) return p;
+
+	return std::upper_bound(k.begin() + p, k.begin() + n, t) - k.begin() - 1;
+}
+
+NURBS_TEMPLATE
+void NURBS_CLASS::basisFunctions(Dim d, size_t span, Scalar t, Scalar* N, Scalar* dN) const
+{
+	// The NURBS Book, A2.2 & A2.3 (first derivatives only)
+	const std::vector<Scalar>& k = knots[d];
+	size_t p = degree[d];
+
+	Scalar left[MAX_DEGREE+1], right[MAX_DEGREE+1], lower[MAX_DEGREE+1];
+
+	N[0] = Scalar(1);
+	for (size_t j = 1; j <= p; j++)
+	{
+		left[j]  = t - k[span+1-j];
+		right[j] = k[span+j] - t;
+
+		if (j == p && dN)
+			std::copy(N, N + p, lower);
+
+		Scalar saved = Scalar(0);
+		for (size_t r = 0; r < j; r++)
 		{
-		case U:
-			if (layer > 0)      cp[i] += controlPoints[uv2index(layer-1, i)];
-			else                step  -= DEFAULT_STEP;
-			if (layer < dim[U]) cp[i] += controlPoints[uv2index(layer, i)];
-			else                step  += DEFAULT_STEP;
-
-			cp[i].x += step; break;
-		case V:
-			if (layer > 0)      cp[i] += controlPoints[uv2index(i, layer-1)];
-			else                step  -= DEFAULT_STEP;
-			if (layer < dim[V]) cp[i] += controlPoints[uv2index(i, layer)];
-			else                step  += DEFAULT_STEP;
-
-			cp[i].y += step; break;
+			Scalar denom = right[r+1] + left[j-r];
+			Scalar temp  = (denom != Scalar(0)) ? N[r] / denom : Scalar(0);
+
+			N[r]  = saved + right[r+1] * temp;
+			saved = left[j-r] * temp;
 		}
-		if (!step) cp[i] /= 2.f;
+		N[j] = saved;
 	}
-	return cp;
+
+	if (!dN) return;
+	for (size_t r = 0; r <= p; r++)
+	{
+		Scalar value = Scalar(0);
+		if (r > 0)
+		{
+			Scalar a = k[span+r] - k[span-p+r];
+			if (a != Scalar(0)) value += lower[r-1] / a;
+		}
+		if (r < p)
+		{
+			Scalar b = k[span+r+1] - k[span-p+r+1];
+			if (b != Scalar(0)) value -= lower[r] / b;
+		}
+		dN[r] = value * Scalar(p);
+	}
+}
+
+NURBS_TEMPLATE
+template<int D>
+typename NURBS_CLASS::point_t NURBS_CLASS::contract(size_t offset, const size_t (&first)[ParamDim],
+	const size_t (&strides)[ParamDim], const Scalar* const (&basis)[ParamDim]) const
+{
+	point_t sum(Scalar(0));
+	for (size_t k = 0; k <= degree[D]; k++)
+	{
+		size_t index = offset + (first[D] + k) * strides[D];
+		if constexpr (D == 0)
+			sum += basis[0][k] * controlPoints[index];
+		else
+			sum += basis[D][k] * contract<D-1>(index, first, strides, basis);
+	}
+	return sum;
+}
+
+NURBS_TEMPLATE
+template<int D>
+typename NURBS_CLASS::hpoint_t NURBS_CLASS::contractHomogeneous(size_t offset, const size_t (&first)[ParamDim],
+	const size_t (&strides)[ParamDim], const Scalar* const (&basis)[ParamDim]) const
+{
+	hpoint_t sum(Scalar(0));
+	for (size_t k = 0; k <= degree[D]; k++)
+	{
+		size_t index = offset + (first[D] + k) * strides[D];
+		if constexpr (D == 0)
+			sum += basis[0][k] * hpoint_t(controlPoints[index] * weights[index], weights[index]);
+		else
+			sum += basis[D][k] * contractHomogeneous<D-1>(index, first, strides, basis);
+	}
+	return sum;
+}
+
+NURBS_TEMPLATE
+void NURBS_CLASS::setRational(bool rational)
+{
+	if (rational == isRational()) return;
+
+	if (rational) weights.assign(controlPoints.size(), Scalar(1));
+	else          weights.clear();
+	invalidate();
+}
+
+NURBS_TEMPLATE
+typename NURBS_CLASS::point_t NURBS_CLASS::evaluate(const param_t& t) const
+{
+	Scalar N[ParamDim][MAX_DEGREE+1];
+	const Scalar* basis[ParamDim];
+	size_t first[ParamDim], strides[ParamDim];
+
+	for (int d = 0; d < ParamDim; d++)
+	{
+		size_t span = findSpan(Dim(d), t[d]);
+		basisFunctions(Dim(d), span, t[d], N[d]);
+
+		basis[d]   = N[d];
+		first[d]   = span - degree[d];
+		strides[d] = (d == 0) ? 1 : strides[d-1] * dim[d-1];
+	}
+	if (!isRational())
+		return contract<ParamDim-1>(0, first, strides, basis);
+
+	hpoint_t h = contractHomogeneous<ParamDim-1>(0, first, strides, basis);
+	return point_t(h) / h[PointDim];
+}
+
+NURBS_TEMPLATE
+typename NURBS_CLASS::point_t NURBS_CLASS::evaluate(const param_t& t, point_t (&partials)[ParamDim]) const
+{
+	Scalar N[ParamDim][MAX_DEGREE+1], dN[ParamDim][MAX_DEGREE+1];
+	const Scalar* basis[ParamDim];
+	size_t first[ParamDim], strides[ParamDim];
+
+	for (int d = 0; d < ParamDim; d++)
+	{
+		size_t span = findSpan(Dim(d), t[d]);
+		basisFunctions(Dim(d), span, t[d], N[d], dN[d]);
+
+		basis[d]   = N[d];
+		first[d]   = span - degree[d];
+		strides[d] = (d == 0) ? 1 : strides[d-1] * dim[d-1];
+	}
+
+	// Partial along d is the same contraction with d-th basis swapped for its derivative
+	if (!isRational())
+	{
+		for (int d = 0; d < ParamDim; d++)
+		{
+			basis[d] = dN[d];
+			partials[d] = contract<ParamDim-1>(0, first, strides, basis);
+			basis[d] = N[d];
+		}
+		return contract<ParamDim-1>(0, first, strides, basis);
+	}
+
+	// Quotient rule on S = A/w: dS = (dA - dw * S) / w
+	hpoint_t h = contractHomogeneous<ParamDim-1>(0, first, strides, basis);
+	point_t point = point_t(h) / h[PointDim];
+	for (int d = 0; d < ParamDim; d++)
+	{
+		basis[d] = dN[d];
+		hpoint_t dh = contractHomogeneous<ParamDim-1>(0, first, strides, basis);
+		partials[d] = (point_t(dh) - dh[PointDim] * point) / h[PointDim];
+		basis[d] = N[d];
+	}
+	return point;
 }
 
 
-void NURBS::output()
+NURBS_TEMPLATE
+void NURBS_CLASS::output() const
+{
+	output(std::cout);
+}
+
+NURBS_TEMPLATE
+void NURBS_CLASS::output(std::ostream& out) const
 {
-	for (int v = 0; v < dim[V]; v++)
+	TextWriter writer(out);
+	auto header = [&writer](const char* name, auto&& value)
+	{
+		writer.text(name);
+		for (int d = 0; d < ParamDim; d++) writer.character(' ').number(value(d));
+		writer.character('\n');
+	};
+	// Every line is a row along U, layers of higher directions follow each other
+	auto rows = [this, &writer](auto&& item)
+	{
+		for (size_t i = 0; i < controlPoints.size(); i++)
+		{
+			item(i);
+			writer.character((i % dim[U] == dim[U] - 1) ? '\n' : '\t');
+		}
+	};
+
+	writer.text("nurbs ").number(ParamDim).character('\n');
+	header("dim",    [this](int d) { return dim[d]; });
+	header("degree", [this](int d) { return degree[d]; });
+	for (int d = 0; d < ParamDim; d++)
 	{
-		for (int u = 0; u < dim[U]; u++)
+		writer.text("knots");
+		for (Scalar knot : knots[d]) writer.character(' ').number(knot);
+		writer.character('\n');
+	}
+
+	if (isRational())
+	{
+		writer.text("weights\n");
+		rows([this, &writer](size_t i) { writer.number(weights[i]); });
+	}
+	writer.text("points\n");
+	rows([this, &writer](size_t i)
+	{
+		for (int c = 0; c < PointDim; c++)
 		{
-			glm::vec3 cp = controlPoints[uv2index(u, v)];
-			std::cout << cp.x << ' ' << cp.y << ' ' << cp.z << '\t';
+			if (c > 0) writer.character(' ');
+			writer.number(controlPoints[i][c]);
 		}
-		std::cout << '\n';
+	});
+}
+
+NURBS_TEMPLATE
+NURBS_CLASS NURBS_CLASS::parse(std::string_view text)
+{
+	TextReader reader(text);
+	auto fail = [](const char* what)
+	{
+		throw std::invalid_argument
+		(std::string("NURBS::parse: ") + what);
+	};
+
+	size_t paramDim = 0;
+	if (!reader.expect("nurbs") || !reader.number(paramDim)) fail("missing header.");
+	if (paramDim != ParamDim) fail("parametric dimension doesn't match.");
+
+	index_t dims, degrees;
+	if (!reader.expect("dim")) fail("missing dims.");
+	for (auto& value : dims)
+		if (!reader.number(value) || value < MIN_DIM || value > MAX_DIM) fail("invalid dim.");
+	if (!reader.expect("degree")) fail("missing degrees.");
+	for (auto& value : degrees)
+		if (!reader.number(value)) fail("invalid degree.");
+
+	BasicNURBS spline(dims);
+	for (int d = 0; d < ParamDim; d++)
+	{
+		spline.setDegree(Dim(d), degrees[d]);
+		if (spline.degree[d] != degrees[d]) fail("degree is out of range.");
+
+		std::vector<Scalar> values(dims[d] + degrees[d] + 1);
+		if (!reader.expect("knots")) fail("missing knots.");
+		for (auto& knot : values)
+			if (!reader.number(knot)) fail("invalid knot.");
+		spline.setKnots(Dim(d), std::move(values));
+	}
+
+	if (reader.expect("weights"))
+	{
+		spline.weights.resize(spline.controlPoints.size());
+		for (auto& w : spline.weights)
+			if (!reader.number(w) || !(w > Scalar(0))) fail("invalid weight.");
 	}
-}
\ No newline at end of file
+	if (!reader.expect("points")) fail("missing control points.");
+	for (auto& cp : spline.controlPoints)
+		for (int c = 0; c < PointDim; c++)
+			if (!reader.number(cp[c])) fail("invalid control point.");
+	if (!reader.atEnd()) fail("unexpected text after the control points.");
+
+	spline.invalidate();
+	return spline;
+}
+
+
+#define NURBS_INSTANTIATE(ParamDim) \
+	template class BasicNURBS<float,  3, ParamDim>; \
+	template class BasicNURBS<double, 3, ParamDim>; \
+	template BasicNURBS<float,  3, ParamDim>::BasicNURBS(const BasicNURBS<double, 3, ParamDim>&); \
+	template BasicNURBS<double, 3, ParamDim>::BasicNURBS(const BasicNURBS<float,  3, ParamDim>&);
+
+NURBS_INSTANTIATE(1)
+NURBS_INSTANTIATE(2)
+NURBS_INSTANTIATE(3)
+
+#undef NURBS_INSTANTIATE
+#undef NURBS_CLASS
+#undef NURBS_TEMPLATE
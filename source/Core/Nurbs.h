@@ -1,26 +1,52 @@
 #pragma once
 
 #include <algorithm>
+#include <array>
+#include <concepts>
+#include <iosfwd>
+#include <string_view>
 #include <vector>
 #include "glm/glm.hpp"
 
+#include "Core/Bounds.h"
+#include "Core/BVH.h"
 
-class NURBS
+
+// Scalar   - type of knots & control point coordinates (float for rendering, double for CAD work)
+// PointDim - number of coordinates per control point
+// ParamDim - number of parametric directions (1 - curve, 2 - surface, 3 - volume)
+//
+// Control points are stored in a single array with U being the fastest changing index,
+// so a point (u, v, w) lives at u + v*dim[U] + w*dim[U]*dim[V]
+template<typename Scalar, int PointDim = 3, int ParamDim = 2>
+class BasicNURBS
 {
+	static_assert(ParamDim >= 1 && ParamDim <= 3, "BasicNURBS supports 1 to 3 parametric directions");
+
 public:
-	using cp_t = std::vector<glm::vec3>;
+	using scalar_t = Scalar;
+	using point_t  = glm::vec<PointDim, Scalar>;
+	using param_t  = glm::vec<ParamDim, Scalar>;
+	using index_t  = std::array<size_t, ParamDim>;
+	using cp_t     = std::vector<point_t>;
+	using aabb_t   = BasicAABB<Scalar, PointDim>;
+	// Weighted point (w*P, w) of a rational spline
+	using hpoint_t = glm::vec<PointDim + 1, Scalar>;
+
+	static constexpr int POINT_DIM = PointDim;
+	static constexpr int PARAM_DIM = ParamDim;
 public:
-	enum Dim : int { U, V };
-	static const char* dim_char[2];
+	enum Dim : int { U, V, W };
+	static const char* dim_char[3];
 
-	size_t dim[2];
-	static const float DEFAULT_STEP;
+	size_t dim[ParamDim];
+	static const Scalar DEFAULT_STEP;
 	static const size_t
 		DEFAULT_DIM = 3,
 		MIN_DIM = 2,
-		MAX_DIM = 20;
+		MAX_DIM = 1 << 16;
 
-	size_t degree[2];
+	size_t degree[ParamDim];
 	static const size_t
 		DEFAULT_DEGREE = 2,
 	    MIN_DEGREE = 1,
@@ -28,35 +54,225 @@ public:
 
 	enum Pos : int { START, END };
 	
-	bool clampKnots[2][2] = { {1, 1}, {1, 1} };
-	std::vector<float> knots[2];
+	bool clampKnots[ParamDim][2];
+	std::vector<Scalar> knots[ParamDim];
 	cp_t controlPoints;
+	// One positive weight per control point for rational splines, empty for polynomial ones
+	std::vector<Scalar> weights;
 	
 public:
-	NURBS(size_t dimU, size_t dimV);
-	inline NURBS(size_t dimUV=DEFAULT_DIM) : NURBS(dimUV, dimUV) {}
+	BasicNURBS(const index_t& dims);
+	inline BasicNURBS(size_t dimAll=DEFAULT_DIM) : BasicNURBS(filled(dimAll)) {}
+
+	template<std::convertible_to<size_t> ... Dims>
+		requires (sizeof...(Dims) == ParamDim && ParamDim > 1)
+	inline BasicNURBS(Dims ... dims) : BasicNURBS(index_t{ static_cast<size_t>(dims)... }) {}
 
-	inline size_t index2uv(size_t i, Dim d)
-	{ return (d == U) ? i % dim[U] : i / dim[U]; }
-	inline size_t uv2index(size_t u, size_t v)
+	// Precision conversion (e.g. double CAD data -> float for rendering)
+	template<typename OtherScalar>
+	explicit BasicNURBS(const BasicNURBS<OtherScalar, PointDim, ParamDim>& other);
+
+	inline size_t stride(Dim d) const
+	{
+		size_t s = 1;
+		for (int k = 0; k < d; k++) s *= dim[k];
+		return s;
+	}
+	// Number of control points in a single layer orthogonal to d
+	inline size_t layerSize(Dim d) const { return controlPoints.size() / dim[d]; }
+
+	inline size_t index2uv(size_t i, Dim d) const
+	{ return (i / stride(d)) % dim[d]; }
+	inline size_t uv2index(size_t u, size_t v) const requires (ParamDim == 2)
 	{ return v * dim[U] + u; }
+	inline size_t uvw2index(const index_t& uvw) const
+	{
+		size_t i = 0;
+		for (int d = ParamDim-1; d >= 0; d--) i = i * dim[d] + uvw[d];
+		return i;
+	}
+
+	// Writing to controlPoints or weights directly has to be followed by invalidate(),
+	// single point edits through setControlPoint keep the cached bounds up to date
+	void setControlPoint(size_t i, const point_t& point);
+	inline void invalidate() { cache.dirty = true; revision++; }
+	// Changes on every edit, so dependent data (meshes, GPU buffers) can tell when to refresh
+	inline size_t getRevision() const { return revision; }
+
+	inline bool isRational() const { return !weights.empty(); }
+	// Switching on gives every point unit weight, switching off drops the weights
+	void setRational(bool rational);
 
-	glm::vec3 calculateCenter();
+	inline point_t calculateCenter() const { return bounds().center(); }
 
-	inline static constexpr Dim reverseDim(Dim dim) { return (dim == U) ? V : U; }
+	// Bounds of the control net, which (by the convex hull property) also bound the spline.
+	// All of them are O(1) to query, a structural edit makes the next query rebuild them
+	const aabb_t& bounds() const;
+	const aabb_t& layerBounds(Dim d, size_t layer) const;
+	inline const aabb_t& rowBounds(size_t v)    const requires (ParamDim == 2) { return layerBounds(V, v); }
+	inline const aabb_t& columnBounds(size_t u) const requires (ParamDim == 2) { return layerBounds(U, u); }
+
+	// Bezier patches are the products of knot spans of nonzero length (U changing the fastest)
+	const std::vector<size_t>& spans(Dim d) const;
+	size_t patchCount() const;
+	const aabb_t& patchBounds(size_t patch) const;
+	index_t patchSpans(size_t patch) const;
+	// Patches the control point has influence on (e.g. to refit a BVH after setControlPoint)
+	std::vector<size_t> controlPointPatches(size_t i) const;
+
+	inline static constexpr Dim reverseDim(Dim dim) requires (ParamDim == 2) { return (dim == U) ? V : U; }
 	void setDim(Dim d, size_t value);
 	void removeDim(Dim d, size_t layer);
-	void insertDim(Dim d, size_t layer, std::vector<glm::vec3> newCP);
+	void insertDim(Dim d, size_t layer, cp_t newCP);
 	inline void insertDim(Dim d, size_t layer) { insertDim(d, layer, interpolateCP(d, layer)); }
 	inline void insertDim(Dim d)               { insertDim(d, dim[d]); }
 
-	inline size_t getOrder(Dim d)     { return degree[d] + 1; }
-	inline size_t getMaxDegree(Dim d) { return std::min<size_t>(MAX_DEGREE, dim[d] - 1); }
+	inline size_t getOrder(Dim d) const     { return degree[d] + 1; }
+	inline size_t getMaxDegree(Dim d) const { return std::min<size_t>(MAX_DEGREE, dim[d] - 1); }
 	void setDegree(Dim d, size_t value = DEFAULT_DEGREE);
 
 	void setKnots(Dim d);
+	// Custom knot vector of dim+degree+1 non-decreasing values, clamp flags are derived from it
+	void setKnots(Dim d, std::vector<Scalar> values);
+
+	cp_t interpolateCP(Dim d, size_t layer) const;
+
+	// Valid parametric range is [knots[degree], knots[dim]] in every direction
+	inline Scalar domainStart(Dim d) const { return knots[d][degree[d]]; }
+	inline Scalar domainEnd(Dim d)   const { return knots[d][dim[d]]; }
+
+	// Index of the knot span containing t (clamped to the valid range)
+	size_t findSpan(Dim d, Scalar t) const;
+	// Fills N (and dN if given) with degree+1 nonzero basis functions (& their derivatives) at t
+	void basisFunctions(Dim d, size_t span, Scalar t, Scalar* N, Scalar* dN = nullptr) const;
+
+	point_t evaluate(const param_t& t) const;
+	point_t evaluate(const param_t& t, point_t (&partials)[ParamDim]) const;
+
+	struct Projection
+	{
+		param_t t;
+		point_t point;
+		Scalar  distance;
+		size_t  patch;
+	};
+	static const size_t MAX_PROJECTION_ITERATIONS = 32;
+
+	// Closest point of the spline: a patch BVH picks the candidates and every candidate
+	// is refined by safeguarded Gauss-Newton from its best coarse sample.
+	// The first call after an edit (re)builds the BVH, so it isn't thread-safe
+	Projection closestPoint(const point_t& p) const;
+	// Batched version: points are processed in parallel in Morton order,
+	// every query starts from the patch of the previous one to prune the search
+	void closestPoints(const std::vector<point_t>& points, std::vector<Projection>& out) const;
+
+	// Text dump: parametric dimension, dims, degrees, knots, weights (if rational) and the
+	// control net with every line a row along U. Numbers are the shortest representation
+	// that reads back to the same value, so parse(output) restores the spline exactly
+	void output() const;
+	void output(std::ostream& out) const;
+	// Throws std::invalid_argument if the text isn't a dump of a spline of this parametric dimension
+	static BasicNURBS parse(std::string_view text);
+
+private:
+	struct BoundsCache
+	{
+		bool dirty = true;
+
+		aabb_t net;
+		std::vector<aabb_t> layers[ParamDim];
+		std::vector<size_t> spans[ParamDim];
+		std::vector<aabb_t> patches;
+	};
+	mutable BoundsCache cache;
+	size_t revision = 0;
+
+	struct ProjectionCache
+	{
+		size_t revision = size_t(-1);
+		BasicBVH<Scalar, PointDim> bvh;
+	};
+	mutable ProjectionCache projection;
+
+	// Defined in Core/NurbsProjection.cpp
+	void syncProjection() const;
+	Projection closestPoint(const point_t& p, size_t hint) const;
+	Projection projectOnPatch(const point_t& p, size_t patch) const;
+	Projection refineProjection(const point_t& p, param_t t, const param_t& start, const param_t& end) const;
+	size_t patchAt(const param_t& t) const;
+
+	void rebuildBounds() const;
+	// Bounds of the sub-box [begin, end) of the net
+	aabb_t blockBounds(const index_t& begin, const index_t& end) const;
+	inline index_t patchBlockBegin(const index_t& spanIndex) const
+	{
+		index_t begin;
+		for (int d = 0; d < ParamDim; d++) begin[d] = spanIndex[d] - degree[d];
+		return begin;
+	}
+	inline index_t patchBlockEnd(const index_t& spanIndex) const
+	{
+		index_t end;
+		for (int d = 0; d < ParamDim; d++) end[d] = spanIndex[d] + 1;
+		return end;
+	}
+
+	static inline index_t filled(size_t value)
+	{ index_t dims; dims.fill(value); return dims; }
+
+	// Calls function(index) for every index of [begin, end), U changing the fastest
+	template<typename Function>
+	static void forEachIndex(const index_t& begin, const index_t& end, Function&& function)
+	{
+		for (int d = 0; d < ParamDim; d++)
+			if (begin[d] >= end[d]) return;
+
+		index_t i = begin;
+		while (true)
+		{
+			function(i);
+
+			int d = 0;
+			for (; d < ParamDim; d++)
+			{
+				if (++i[d] < end[d]) break;
+				i[d] = begin[d];
+			}
+			if (d == ParamDim) return;
+		}
+	}
+
+	// Successive 1D contraction of the (degree+1)^ParamDim block of control points
+	// starting from the outermost direction D, so a surface costs (p+1)(q+1) + (q+1) madds
+	template<int D>
+	point_t contract(size_t offset, const size_t (&first)[ParamDim], const size_t (&strides)[ParamDim],
+		const Scalar* const (&basis)[ParamDim]) const;
+	// Same for rational splines, over the weighted points
+	template<int D>
+	hpoint_t contractHomogeneous(size_t offset, const size_t (&first)[ParamDim], const size_t (&strides)[ParamDim],
+		const Scalar* const (&basis)[ParamDim]) const;
+
+	// Copies of a per control point array without/with a layer orthogonal to d
+	template<typename T>
+	std::vector<T> withoutLayer(const std::vector<T>& data, Dim d, size_t layer) const;
+	template<typename T>
+	std::vector<T> withLayer(const std::vector<T>& data, Dim d, size_t layer, const std::vector<T>& values) const;
+};
+
+
+// Float is what GL consumes, double is kept for the CAD-side computations
+using NURBS  = BasicNURBS<float>;
+using NURBSd = BasicNURBS<double>;
 
-	std::vector<glm::vec3> interpolateCP(Dim d, size_t layer);
+using NURBSCurve   = BasicNURBS<float,  3, 1>;
+using NURBSCurved  = BasicNURBS<double, 3, 1>;
+using NURBSVolume  = BasicNURBS<float,  3, 3>;
+using NURBSVolumed = BasicNURBS<double, 3, 3>;
 
-	void output();
-};
\ No newline at end of file
+// All of them are explicitly instantiated in Core/Nurbs.cpp
+extern template class BasicNURBS<float,  3, 1>;
+extern template class BasicNURBS<double, 3, 1>;
+extern template class BasicNURBS<float,  3, 2>;
+extern template class BasicNURBS<double, 3, 2>;
+extern template class BasicNURBS<float,  3, 3>;
+extern template class BasicNURBS<double, 3, 3>;
@@ -0,0 +1,285 @@
+// Point inversion / closest point projection part of BasicNURBS
+#include "Core/Nurbs.h"
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+
+#include "Core/Parallel.h"
+
+#define NURBS_TEMPLATE template<typename Scalar, int PointDim, int ParamDim>
+#define NURBS_CLASS    BasicNURBS<Scalar, PointDim, ParamDim>
+
+
+namespace
+{
+	// Gaussian elimination with partial pivoting for the tiny ParamDim x ParamDim systems
+	template<typename Scalar, int N>
+	bool solve(Scalar (&A)[N][N], Scalar (&b)[N], Scalar (&x)[N])
+	{
+		for (int c = 0; c < N; c++)
+		{
+			int pivot = c;
+			for (int r = c+1; r < N; r++)
+				if (std::abs(A[r][c]) > std::abs(A[pivot][c])) pivot = r;
+			if (std::abs(A[pivot][c]) < std::numeric_limits<Scalar>::min()) return false;
+
+			std::swap(A[c], A[pivot]); std::swap(b[c], b[pivot]);
+			for (int r = c+1; r < N; r++)
+			{
+				Scalar f = A[r][c] / A[c][c];
+				for (int k = c; k < N; k++) A[r][k] -= f * A[c][k];
+				b[r] -= f * b[c];
+			}
+		}
+		for (int r = N-1; r >= 0; r--)
+		{
+			Scalar sum = b[r];
+			for (int k = r+1; k < N; k++) sum -= A[r][k] * x[k];
+			x[r] = sum / A[r][r];
+		}
+		return true;
+	}
+
+	// Interleaves the top 10 bits of every coordinate
+	inline uint32_t mortonCode(const uint32_t (&cell)[3])
+	{
+		uint32_t code = 0;
+		for (int bit = 9; bit >= 0; bit--)
+			for (int i = 0; i < 3; i++)
+				code = (code << 1) | ((cell[i] >> bit) & 1u);
+		return code;
+	}
+}
+
+
+NURBS_TEMPLATE
+void NURBS_CLASS::syncProjection() const
+{
+	bounds();  // makes sure the patch cache is clean before anything reads it
+	if (projection.revision == revision) return;
+
+	if (projection.bvh.isEmpty() || projection.bvh.itemCount() != patchCount())
+		projection.bvh.build(*this);
+	else
+		projection.bvh.refit(*this);
+	projection.revision = revision;
+}
+
+NURBS_TEMPLATE
+typename NURBS_CLASS::Projection NURBS_CLASS::closestPoint(const point_t& p) const
+{
+	syncProjection();
+	return closestPoint(p, size_t(-1));
+}
+
+NURBS_TEMPLATE
+typename NURBS_CLASS::Projection NURBS_CLASS::closestPoint(const point_t& p, size_t hint) const
+{
+	Projection best;
+	bool found = false;
+
+	std::pair<size_t, Scalar> start = { size_t(-1), std::numeric_limits<Scalar>::max() };
+	if (hint < patchCount())
+	{
+		best  = projectOnPatch(p, hint);
+		found = true;
+		start = { hint, best.distance * best.distance };
+	}
+
+	projection.bvh.nearest(p, [&](size_t patch, Scalar)
+	{
+		Projection candidate = projectOnPatch(p, patch);
+		if (!found || candidate.distance < best.distance)
+		{
+			best  = candidate;
+			found = true;
+		}
+		return candidate.distance * candidate.distance;
+	}, start);
+
+	return best;
+}
+
+NURBS_TEMPLATE
+void NURBS_CLASS::closestPoints(const std::vector<point_t>& points, std::vector<Projection>& out) const
+{
+	syncProjection();
+	out.resize(points.size());
+	if (points.empty()) return;
+
+	// Morton order of the queries, so neighbouring ones in a chunk land on the same patches
+	aabb_t box;
+	for (auto& point : points) box.expand(point);
+	point_t extent = glm::max(box.extent(), point_t(std::numeric_limits<Scalar>::epsilon()));
+
+	std::vector<uint32_t> codes(points.size()), order(points.size());
+	Parallel::forEach(0, points.size(), [&](size_t i)
+	{
+		uint32_t cell[3] = { 0, 0, 0 };
+		for (int k = 0; k < std::min(PointDim, 3); k++)
+			cell[k] = uint32_t(Scalar(1023) * (points[i][k] - box.min[k]) / extent[k]);
+		codes[i] = mortonCode(cell);
+	});
+	std::iota(order.begin(), order.end(), 0u);
+	std::sort(order.begin(), order.end(), [&codes](uint32_t a, uint32_t b) { return codes[a] < codes[b]; });
+
+	Parallel::forChunks(0, points.size(), [&](size_t begin, size_t end)
+	{
+		size_t hint = size_t(-1);
+		for (size_t k = begin; k < end; k++)
+		{
+			Projection& result = out[order[k]];
+			result = closestPoint(points[order[k]], hint);
+			hint = result.patch;
+		}
+	}, 256);
+}
+
+
+NURBS_TEMPLATE
+typename NURBS_CLASS::Projection NURBS_CLASS::projectOnPatch(const point_t& p, size_t patch) const
+{
+	index_t spanIndex = patchSpans(patch);
+
+	// Best of a 2^ParamDim sample of the patch interior as the starting point
+	const size_t SAMPLES = 2;
+
+	param_t seed;
+	Scalar bestDistance = std::numeric_limits<Scalar>::max();
+	forEachIndex(filled(0), filled(SAMPLES), [&](const index_t& sample)
+	{
+		param_t t;
+		for (int d = 0; d < ParamDim; d++)
+		{
+			Scalar a = knots[d][spanIndex[d]], b = knots[d][spanIndex[d] + 1];
+			t[d] = a + (b - a) * (Scalar(sample[d]) + Scalar(0.5)) / Scalar(SAMPLES);
+		}
+
+		point_t diff = evaluate(t) - p;
+		Scalar distance = glm::dot(diff, diff);
+		if (distance < bestDistance)
+		{
+			bestDistance = distance;
+			seed = t;
+		}
+	});
+
+	// Refinement may leave the patch, finding the true minimum early prunes the search harder
+	param_t start, end;
+	for (int d = 0; d < ParamDim; d++)
+	{
+		start[d] = domainStart(Dim(d));
+		end[d]   = domainEnd(Dim(d));
+	}
+	return refineProjection(p, seed, start, end);
+}
+
+NURBS_TEMPLATE
+typename NURBS_CLASS::Projection NURBS_CLASS::refineProjection(const point_t& p, param_t t,
+	const param_t& start, const param_t& end) const
+{
+	const Scalar eps = std::sqrt(std::numeric_limits<Scalar>::epsilon());
+
+	point_t partials[ParamDim];
+	point_t point = evaluate(t, partials);
+	point_t diff  = point - p;
+	Scalar  f     = glm::dot(diff, diff);
+
+	// Gauss-Newton on |S(t) - p|^2 with a backtracking line search, staying inside [start, end]
+	for (size_t iteration = 0; iteration < MAX_PROJECTION_ITERATIONS; iteration++)
+	{
+		Scalar A[ParamDim][ParamDim], b[ParamDim], step[ParamDim];
+
+		// Zero-distance or orthogonality (cosine) criterion
+		bool converged = f < eps * eps * eps * eps;
+		if (!converged)
+		{
+			converged = true;
+			Scalar diffLength = std::sqrt(f);
+			for (int d = 0; d < ParamDim; d++)
+				if (std::abs(glm::dot(partials[d], diff)) > eps * glm::length(partials[d]) * diffLength)
+					converged = false;
+		}
+		if (converged) break;
+
+		for (int d = 0; d < ParamDim; d++)
+		{
+			for (int e = 0; e < ParamDim; e++) A[d][e] = glm::dot(partials[d], partials[e]);
+			b[d] = -glm::dot(partials[d], diff);
+		}
+		if (!solve<Scalar, ParamDim>(A, b, step)) break;
+
+		bool improved = false;
+		param_t next;
+		for (Scalar scale = Scalar(1); scale > Scalar(1) / 256; scale /= 2)
+		{
+			for (int d = 0; d < ParamDim; d++)
+				next[d] = std::clamp(t[d] + step[d] * scale, start[d], end[d]);
+
+			point_t nextPartials[ParamDim];
+			point_t nextPoint = evaluate(next, nextPartials);
+			point_t nextDiff  = nextPoint - p;
+			Scalar  nextF     = glm::dot(nextDiff, nextDiff);
+			if (nextF < f)
+			{
+				improved = true;
+				point = nextPoint; diff = nextDiff; f = nextF;
+				std::copy(nextPartials, nextPartials + ParamDim, partials);
+				break;
+			}
+		}
+		if (!improved) break;
+
+		Scalar moved = Scalar(0);
+		for (int d = 0; d < ParamDim; d++)
+			moved = std::max(moved, std::abs(next[d] - t[d]) / std::max(end[d] - start[d], eps));
+		t = next;
+		if (moved < eps * eps) break;
+	}
+
+	return { t, point, std::sqrt(f), patchAt(t) };
+}
+
+NURBS_TEMPLATE
+size_t NURBS_CLASS::patchAt(const param_t& t) const
+{
+	size_t patch = 0, patchStride = 1;
+	for (int d = 0; d < ParamDim; d++)
+	{
+		const std::vector<size_t>& s = cache.spans[d];
+		size_t position = std::lower_bound(s.begin(), s.end(), findSpan(Dim(d), t[d])) - s.begin();
+
+		patch       += std::min(position, s.size() - 1) * patchStride;
+		patchStride *= s.size();
+	}
+	return patch;
+}
+
+
+// Every member defined here has to be listed, the class itself is instantiated in Core/Nurbs.cpp
+#define PROJECTION_INSTANTIATE(Scalar, ParamDim) \
+	template void BasicNURBS<Scalar, 3, ParamDim>::syncProjection() const; \
+	template BasicNURBS<Scalar, 3, ParamDim>::Projection \
+		BasicNURBS<Scalar, 3, ParamDim>::closestPoint(const point_t&) const; \
+	template BasicNURBS<Scalar, 3, ParamDim>::Projection \
+		BasicNURBS<Scalar, 3, ParamDim>::closestPoint(const point_t&, size_t) const; \
+	template void BasicNURBS<Scalar, 3, ParamDim>::closestPoints( \
+		const std::vector<point_t>&, std::vector<Projection>&) const; \
+	template BasicNURBS<Scalar, 3, ParamDim>::Projection \
+		BasicNURBS<Scalar, 3, ParamDim>::projectOnPatch(const point_t&, size_t) const; \
+	template BasicNURBS<Scalar, 3, ParamDim>::Projection \
+		BasicNURBS<Scalar, 3, ParamDim>::refineProjection(const point_t&, param_t, const param_t&, const param_t&) const; \
+	template size_t BasicNURBS<Scalar, 3, ParamDim>::patchAt(const param_t&) const;
+
+PROJECTION_INSTANTIATE(float,  1)
+PROJECTION_INSTANTIATE(double, 1)
+PROJECTION_INSTANTIATE(float,  2)
+PROJECTION_INSTANTIATE(double, 2)
+PROJECTION_INSTANTIATE(float,  3)
+PROJECTION_INSTANTIATE(double, 3)
+
+#undef PROJECTION_INSTANTIATE
+#undef NURBS_CLASS
+#undef NURBS_TEMPLATE
@@ -0,0 +1,44 @@
+#include "Core/OpenGL.h"
+
+#include <cstring>
+
+
+namespace GL
+{
+	#define CW_GL_DEFINE(type, name, parameters) type (APIENTRY* name) parameters = nullptr;
+	CW_GL_FUNCTIONS(CW_GL_DEFINE)
+	#undef CW_GL_DEFINE
+
+	bool load(Loader loader)
+	{
+		#define CW_GL_LOAD(type, name, parameters) \
+			name = reinterpret_cast<type (APIENTRY*) parameters>(loader("gl" #name));
+		CW_GL_FUNCTIONS(CW_GL_LOAD)
+		#undef CW_GL_LOAD
+
+		return version() >= 30 && GenVertexArrays && CreateProgram && VertexAttribIPointer;
+	}
+
+	int version()
+	{
+		// GL_MAJOR_VERSION isn't known before 3.0, the glGetIntegerv call leaves 0 then
+		GLint major = 0, minor = 0;
+		glGetIntegerv(GL_MAJOR_VERSION, &major);
+		glGetIntegerv(GL_MINOR_VERSION, &minor);
+		return major * 10 + minor;
+	}
+
+	bool hasExtension(const char* name)
+	{
+		if (!GetStringi) return false;
+
+		GLint count = 0;
+		glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+		for (GLint i = 0; i < count; i++)
+		{
+			const GLubyte* extension = GetStringi(GL_EXTENSIONS, GLuint(i));
+			if (extension && std::strcmp(reinterpret_cast<const char*>(extension), name) == 0) return true;
+		}
+		return false;
+	}
+}
@@ -0,0 +1,243 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Declarations up to GL 1.1 come from the system header (through GLFW, which also takes care
+// of the Windows prerequisites), newer functions are loaded from the current context by GL::load
+#ifndef GLFW_INCLUDE_GLU
+	#define GLFW_INCLUDE_GLU
+#endif
+#include "glfw3.h"
+
+
+typedef char           GLchar;
+typedef std::ptrdiff_t GLsizeiptr;
+typedef std::ptrdiff_t GLintptr;
+typedef std::uint64_t  GLuint64;
+typedef struct __GLsync* GLsync;
+
+#ifndef GL_ARRAY_BUFFER
+	#define GL_ARRAY_BUFFER          0x8892
+	#define GL_ELEMENT_ARRAY_BUFFER  0x8893
+	#define GL_STREAM_DRAW           0x88E0
+	#define GL_STATIC_DRAW           0x88E4
+	#define GL_DYNAMIC_DRAW          0x88E8
+#endif
+#ifndef GL_VERTEX_SHADER
+	#define GL_FRAGMENT_SHADER       0x8B30
+	#define GL_VERTEX_SHADER         0x8B31
+	#define GL_COMPILE_STATUS        0x8B81
+	#define GL_LINK_STATUS           0x8B82
+	#define GL_INFO_LOG_LENGTH       0x8B84
+#endif
+#ifndef GL_MAJOR_VERSION
+	#define GL_MAJOR_VERSION         0x821B
+	#define GL_MINOR_VERSION         0x821C
+	#define GL_NUM_EXTENSIONS        0x821D
+#endif
+#ifndef GL_TEXTURE0
+	#define GL_TEXTURE0              0x84C0
+#endif
+#ifndef GL_RGBA32F
+	#define GL_RGBA32F               0x8814
+#endif
+#ifndef GL_TEXTURE_BUFFER
+	#define GL_TEXTURE_BUFFER        0x8C2A
+#endif
+#ifndef GL_PATCHES
+	#define GL_PATCHES               0x000E
+	#define GL_PATCH_VERTICES        0x8E72
+	#define GL_MAX_TESS_GEN_LEVEL    0x8E7E
+	#define GL_TESS_EVALUATION_SHADER 0x8E87
+	#define GL_TESS_CONTROL_SHADER   0x8E88
+#endif
+#ifndef GL_COMPUTE_SHADER
+	#define GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT 0x00000001
+	#define GL_BUFFER_UPDATE_BARRIER_BIT       0x00000200
+	#define GL_SHADER_STORAGE_BUFFER 0x90D2
+	#define GL_COMPUTE_SHADER        0x91B9
+#endif
+#ifndef GL_DYNAMIC_COPY
+	#define GL_DYNAMIC_COPY          0x88EA
+#endif
+#ifndef GL_FRAMEBUFFER
+	#define GL_DEPTH_COMPONENT24     0x81A6
+	#define GL_READ_FRAMEBUFFER      0x8CA8
+	#define GL_DRAW_FRAMEBUFFER      0x8CA9
+	#define GL_FRAMEBUFFER_COMPLETE  0x8CD5
+	#define GL_COLOR_ATTACHMENT0     0x8CE0
+	#define GL_DEPTH_ATTACHMENT      0x8D00
+	#define GL_FRAMEBUFFER           0x8D40
+	#define GL_RENDERBUFFER          0x8D41
+#endif
+#ifndef GL_TIME_ELAPSED
+	#define GL_QUERY_RESULT          0x8866
+	#define GL_QUERY_RESULT_AVAILABLE 0x8867
+	#define GL_TIME_ELAPSED          0x88BF
+#endif
+#ifndef GL_MAP_WRITE_BIT
+	#define GL_MAP_WRITE_BIT         0x0002
+#endif
+#ifndef GL_MAP_PERSISTENT_BIT
+	#define GL_MAP_PERSISTENT_BIT    0x0040
+	#define GL_MAP_COHERENT_BIT      0x0080
+	#define GL_DYNAMIC_STORAGE_BIT   0x0100
+#endif
+#ifndef GL_SYNC_GPU_COMMANDS_COMPLETE
+	#define GL_SYNC_FLUSH_COMMANDS_BIT     0x00000001
+	#define GL_SYNC_GPU_COMMANDS_COMPLETE  0x9117
+	#define GL_ALREADY_SIGNALED            0x911A
+	#define GL_TIMEOUT_EXPIRED             0x911B
+	#define GL_CONDITION_SATISFIED         0x911C
+	#define GL_WAIT_FAILED                 0x911D
+#endif
+
+// Functions newer than GL 1.1: X(return type, name without the gl prefix, parameters)
+#define CW_GL_FUNCTIONS(X) \
+	X(void,   GenBuffers,               (GLsizei n, GLuint* buffers)) \
+	X(void,   DeleteBuffers,            (GLsizei n, const GLuint* buffers)) \
+	X(void,   BindBuffer,               (GLenum target, GLuint buffer)) \
+	X(void,   BufferData,               (GLenum target, GLsizeiptr size, const void* data, GLenum usage)) \
+	X(void,   BufferSubData,            (GLenum target, GLintptr offset, GLsizeiptr size, const void* data)) \
+	X(void,   GetBufferSubData,         (GLenum target, GLintptr offset, GLsizeiptr size, void* data)) \
+	X(void,   BindBufferBase,           (GLenum target, GLuint index, GLuint buffer)) \
+	X(void,   GenVertexArrays,          (GLsizei n, GLuint* arrays)) \
+	X(void,   DeleteVertexArrays,       (GLsizei n, const GLuint* arrays)) \
+	X(void,   BindVertexArray,          (GLuint array)) \
+	X(void,   EnableVertexAttribArray,  (GLuint index)) \
+	X(void,   VertexAttribPointer,      (GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void* pointer)) \
+	X(void,   VertexAttribIPointer,     (GLuint index, GLint size, GLenum type, GLsizei stride, const void* pointer)) \
+	X(GLuint, CreateShader,             (GLenum type)) \
+	X(void,   DeleteShader,             (GLuint shader)) \
+	X(void,   ShaderSource,             (GLuint shader, GLsizei count, const GLchar* const* string, const GLint* length)) \
+	X(void,   CompileShader,            (GLuint shader)) \
+	X(void,   GetShaderiv,              (GLuint shader, GLenum name, GLint* params)) \
+	X(void,   GetShaderInfoLog,         (GLuint shader, GLsizei size, GLsizei* length, GLchar* log)) \
+	X(GLuint, CreateProgram,            ()) \
+	X(void,   DeleteProgram,            (GLuint program)) \
+	X(void,   AttachShader,             (GLuint program, GLuint shader)) \
+	X(void,   BindAttribLocation,       (GLuint program, GLuint index, const GLchar* name)) \
+	X(void,   LinkProgram,              (GLuint program)) \
+	X(void,   GetProgramiv,             (GLuint program, GLenum name, GLint* params)) \
+	X(void,   GetProgramInfoLog,        (GLuint program, GLsizei size, GLsizei* length, GLchar* log)) \
+	X(void,   UseProgram,               (GLuint program)) \
+	X(GLint,  GetUniformLocation,       (GLuint program, const GLchar* name)) \
+	X(void,   Uniform1i,                (GLint location, GLint v0)) \
+	X(void,   Uniform2i,                (GLint location, GLint v0, GLint v1)) \
+	X(void,   Uniform1f,                (GLint location, GLfloat v0)) \
+	X(void,   Uniform2f,                (GLint location, GLfloat v0, GLfloat v1)) \
+	X(void,   Uniform3fv,               (GLint location, GLsizei count, const GLfloat* value)) \
+	X(void,   Uniform4fv,               (GLint location, GLsizei count, const GLfloat* value)) \
+	X(void,   UniformMatrix4fv,         (GLint location, GLsizei count, GLboolean transpose, const GLfloat* value)) \
+	X(const GLubyte*, GetStringi,       (GLenum name, GLuint index)) \
+	X(void,   BufferStorage,            (GLenum target, GLsizeiptr size, const void* data, GLbitfield flags)) \
+	X(void*,  MapBufferRange,           (GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access)) \
+	X(GLboolean, UnmapBuffer,           (GLenum target)) \
+	X(GLsync, FenceSync,                (GLenum condition, GLbitfield flags)) \
+	X(GLenum, ClientWaitSync,           (GLsync sync, GLbitfield flags, GLuint64 timeout)) \
+	X(void,   DeleteSync,               (GLsync sync)) \
+	X(void,   ActiveTexture,            (GLenum texture)) \
+	X(void,   TexBuffer,                (GLenum target, GLenum format, GLuint buffer)) \
+	X(void,   PatchParameteri,          (GLenum name, GLint value)) \
+	X(void,   DispatchCompute,          (GLuint x, GLuint y, GLuint z)) \
+	X(void,   MemoryBarrier,            (GLbitfield barriers)) \
+	X(void,   GenFramebuffers,          (GLsizei n, GLuint* framebuffers)) \
+	X(void,   DeleteFramebuffers,       (GLsizei n, const GLuint* framebuffers)) \
+	X(void,   BindFramebuffer,          (GLenum target, GLuint framebuffer)) \
+	X(GLenum, CheckFramebufferStatus,   (GLenum target)) \
+	X(void,   BlitFramebuffer,          (GLint srcX0, GLint srcY0, GLint srcX1, GLint srcY1, GLint dstX0, GLint dstY0, GLint dstX1, GLint dstY1, GLbitfield mask, GLenum filter)) \
+	X(void,   GenRenderbuffers,         (GLsizei n, GLuint* renderbuffers)) \
+	X(void,   DeleteRenderbuffers,      (GLsizei n, const GLuint* renderbuffers)) \
+	X(void,   BindRenderbuffer,         (GLenum target, GLuint renderbuffer)) \
+	X(void,   RenderbufferStorage,      (GLenum target, GLenum format, GLsizei width, GLsizei height)) \
+	X(void,   FramebufferRenderbuffer,  (GLenum target, GLenum attachment, GLenum renderbufferTarget, GLuint renderbuffer)) \
+	X(void,   GenQueries,               (GLsizei n, GLuint* ids)) \
+	X(void,   DeleteQueries,            (GLsizei n, const GLuint* ids)) \
+	X(void,   BeginQuery,               (GLenum target, GLuint id)) \
+	X(void,   EndQuery,                 (GLenum target)) \
+	X(void,   GetQueryObjectiv,         (GLuint id, GLenum name, GLint* value)) \
+	X(void,   GetQueryObjectui64v,      (GLuint id, GLenum name, GLuint64* value))
+
+namespace GL
+{
+	#define CW_GL_DECLARE(type, name, parameters) extern type (APIENTRY* name) parameters;
+	CW_GL_FUNCTIONS(CW_GL_DECLARE)
+	#undef CW_GL_DECLARE
+
+	using Proc   = void (*)();
+	using Loader = Proc (*)(const char* name);
+
+	// Loads every function the current context has (glfwGetProcAddress, eglGetProcAddress, ..),
+	// the missing ones stay null. False if the context is older than GL 3.0
+	bool load(Loader loader);
+	// major * 10 + minor of the current context, e.g. 45 for GL 4.5
+	int version();
+	// Extension of the current context ("GL_ARB_buffer_storage"), through glGetStringi
+	bool hasExtension(const char* name);
+}
+
+// The pointers live in a namespace, so they can't clash with the symbols a GL library exports
+#define glGenBuffers              GL::GenBuffers
+#define glDeleteBuffers           GL::DeleteBuffers
+#define glBindBuffer              GL::BindBuffer
+#define glBufferData              GL::BufferData
+#define glBufferSubData           GL::BufferSubData
+#define glGetBufferSubData        GL::GetBufferSubData
+#define glBindBufferBase          GL::BindBufferBase
+#define glGenVertexArrays         GL::GenVertexArrays
+#define glDeleteVertexArrays      GL::DeleteVertexArrays
+#define glBindVertexArray         GL::BindVertexArray
+#define glEnableVertexAttribArray GL::EnableVertexAttribArray
+#define glVertexAttribPointer     GL::VertexAttribPointer
+#define glVertexAttribIPointer    GL::VertexAttribIPointer
+#define glCreateShader            GL::CreateShader
+#define glDeleteShader            GL::DeleteShader
+#define glShaderSource            GL::ShaderSource
+#define glCompileShader           GL::CompileShader
+#define glGetShaderiv             GL::GetShaderiv
+#define glGetShaderInfoLog        GL::GetShaderInfoLog
+#define glCreateProgram           GL::CreateProgram
+#define glDeleteProgram           GL::DeleteProgram
+#define glAttachShader            GL::AttachShader
+#define glBindAttribLocation      GL::BindAttribLocation
+#define glLinkProgram             GL::LinkProgram
+#define glGetProgramiv            GL::GetProgramiv
+#define glGetProgramInfoLog       GL::GetProgramInfoLog
+#define glUseProgram              GL::UseProgram
+#define glGetUniformLocation      GL::GetUniformLocation
+#define glUniform1i               GL::Uniform1i
+#define glUniform2i               GL::Uniform2i
+#define glUniform1f               GL::Uniform1f
+#define glUniform2f               GL::Uniform2f
+#define glUniform3fv              GL::Uniform3fv
+#define glUniform4fv              GL::Uniform4fv
+#define glUniformMatrix4fv        GL::UniformMatrix4fv
+#define glGetStringi              GL::GetStringi
+#define glBufferStorage           GL::BufferStorage
+#define glMapBufferRange          GL::MapBufferRange
+#define glUnmapBuffer             GL::UnmapBuffer
+#define glFenceSync               GL::FenceSync
+#define glClientWaitSync          GL::ClientWaitSync
+#define glDeleteSync              GL::DeleteSync
+#define glActiveTexture           GL::ActiveTexture
+#define glTexBuffer               GL::TexBuffer
+#define glPatchParameteri         GL::PatchParameteri
+#define glDispatchCompute         GL::DispatchCompute
+#define glMemoryBarrier           GL::MemoryBarrier
+#define glGenFramebuffers         GL::GenFramebuffers
+#define glDeleteFramebuffers      GL::DeleteFramebuffers
+#define glBindFramebuffer         GL::BindFramebuffer
+#define glCheckFramebufferStatus  GL::CheckFramebufferStatus
+#define glBlitFramebuffer         GL::BlitFramebuffer
+#define glGenRenderbuffers        GL::GenRenderbuffers
+#define glDeleteRenderbuffers     GL::DeleteRenderbuffers
+#define glBindRenderbuffer        GL::BindRenderbuffer
+#define glRenderbufferStorage     GL::RenderbufferStorage
+#define glFramebufferRenderbuffer GL::FramebufferRenderbuffer
+#define glGenQueries              GL::GenQueries
+#define glDeleteQueries           GL::DeleteQueries
+#define glBeginQuery              GL::BeginQuery
+#define glEndQuery                GL::EndQuery
+#define glGetQueryObjectiv        GL::GetQueryObjectiv
+#define glGetQueryObjectui64v     GL::GetQueryObjectui64v
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <algorithm>
+#include <exception>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+
+namespace Parallel
+{
+	inline size_t threadCount()
+	{ return std::max<size_t>(1, std::thread::hardware_concurrency()); }
+
+	// Splits [begin, end) into contiguous chunks of at least 'grain' items and runs
+	// function(chunkBegin, chunkEnd) for each of them on its own thread.
+	// Small ranges are processed on the calling thread.
+	// Every chunk runs even if another one throws, the exception of the first chunk that threw
+	// is rethrown once all the threads have joined
+	template<typename Function>
+	void forChunks(size_t begin, size_t end, Function&& function, size_t grain = 1024)
+	{
+		if (end <= begin) return;
+
+		size_t count  = end - begin;
+		size_t chunks = std::min(threadCount(), (count + grain - 1) / grain);
+		if (chunks <= 1)
+		{
+			function(begin, end);
+			return;
+		}
+
+		size_t chunkSize = (count + chunks - 1) / chunks;
+
+		std::vector<std::exception_ptr> errors(chunks);
+		auto run = [&function, &errors](size_t c, size_t first, size_t last)
+		{
+			try { function(first, last); }
+			catch (...) { errors[c] = std::current_exception(); }
+		};
+
+		std::vector<std::thread> workers;
+		workers.reserve(chunks - 1);
+		for (size_t c = 1; c < chunks; c++)
+		{
+			size_t first = begin + c * chunkSize;
+			size_t last  = std::min(end, first + chunkSize);
+			if (first >= last) continue;
+
+			// A thread that can't be started leaves its chunk to the calling one
+			try { workers.emplace_back(run, c, first, last); }
+			catch (const std::system_error&) { run(c, first, last); }
+		}
+		run(0, begin, std::min(end, begin + chunkSize));
+
+		for (auto& worker : workers) worker.join();
+		for (auto& error : errors)
+			if (error) std::rethrow_exception(error);
+	}
+
+	// Per-item version of forChunks
+	template<typename Function>
+	void forEach(size_t begin, size_t end, Function&& function, size_t grain = 1024)
+	{
+		forChunks(begin, end, [&function](size_t first, size_t last)
+		{
+			for (size_t i = first; i < last; i++) function(i);
+		}, grain);
+	}
+}
@@ -0,0 +1,129 @@
+#include "Core/Picker.h"
+
+#include <limits>
+
+const float Picker::POINT_RADIUS = 6.f;
+
+
+void Picker::syncGrid(const NURBS& nurbs)
+{
+	if (gridRevision == nurbs.getRevision()) return;
+
+	grid.build(nurbs.controlPoints, nurbs.bounds());
+	gridRevision = nurbs.getRevision();
+}
+
+void Picker::syncBVH(const NURBS& nurbs)
+{
+	if (bvhRevision == nurbs.getRevision()) return;
+
+	// Same patch count means the topology is still usable, only the boxes moved
+	if (bvh.isEmpty() || bvh.itemCount() != nurbs.patchCount())
+		bvh.build(nurbs);
+	else
+		bvh.refit(nurbs);
+	bvhRevision = nurbs.getRevision();
+}
+
+void Picker::controlPointMoved(const NURBS& nurbs, size_t i)
+{
+	// Only valid when the move is the single edit since the last sync
+	if (bvhRevision + 1 != nurbs.getRevision() || bvhRevision == UNSYNCED) return;
+
+	bvh.refit(nurbs, nurbs.controlPointPatches(i));
+	bvhRevision = nurbs.getRevision();
+}
+
+
+bool Picker::pickPoint(const NURBS& nurbs, const Camera& camera, glm::vec2 cursor, PointHit& hit)
+{
+	syncGrid(nurbs);
+
+	Camera::Ray ray = camera.unproject(cursor.x, cursor.y);
+	float slope = camera.pixelSize(1.f) * POINT_RADIUS;
+
+	return grid.raycast(nurbs.controlPoints, ray.origin, ray.direction, 0.f, slope, hit.index, hit.t);
+}
+
+bool Picker::pickSurface(const NURBS& nurbs, const Camera& camera, glm::vec2 cursor, SurfaceHit& hit)
+{
+	syncBVH(nurbs);
+
+	Camera::Ray ray = camera.unproject(cursor.x, cursor.y);
+
+	bool found = false;
+	bvh.traverseRay(ray.origin, ray.direction, [&](size_t patch, float tNear, float tFar)
+	{
+		SurfaceHit candidate;
+		if (intersectPatch(nurbs, patch, ray, candidate) && (!found || candidate.t < hit.t))
+		{
+			hit   = candidate;
+			found = true;
+		}
+		// Patches starting farther than the closest hit are culled
+		return found ? hit.t : std::numeric_limits<float>::max();
+	});
+	return found;
+}
+
+
+bool Picker::intersectPatch(const NURBS& nurbs, size_t patch, const Camera::Ray& ray, SurfaceHit& hit)
+{
+	NURBS::index_t spans = nurbs.patchSpans(patch);
+
+	NURBS::param_t start, end;
+	for (int d = 0; d < 2; d++)
+	{
+		start[d] = nurbs.knots[d][spans[d]];
+		end[d]   = nurbs.knots[d][spans[d] + 1];
+	}
+
+	// Seed with the sample closest to the ray
+	const int SAMPLES = 3;
+	NURBS::param_t uv;
+	float bestDistance = std::numeric_limits<float>::max();
+	for (int j = 0; j < SAMPLES; j++)
+		for (int i = 0; i < SAMPLES; i++)
+		{
+			NURBS::param_t sample
+			(
+				start[0] + (end[0] - start[0]) * (i + 0.5f) / SAMPLES,
+				start[1] + (end[1] - start[1]) * (j + 0.5f) / SAMPLES
+			);
+			glm::vec3 offset = glm::cross(nurbs.evaluate(sample) - ray.origin, ray.direction);
+
+			float distance = glm::dot(offset, offset);
+			if (distance < bestDistance)
+			{
+				bestDistance = distance;
+				uv = sample;
+			}
+		}
+	float t = glm::dot(nurbs.evaluate(uv) - ray.origin, ray.direction);
+
+	float tolerance = 1e-5f * std::max(1.f, glm::length(nurbs.bounds().extent()));
+
+	// Newton iteration on S(u, v) - (origin + t * direction) = 0
+	for (size_t iteration = 0; iteration < MAX_ITERATIONS; iteration++)
+	{
+		glm::vec3 partials[2];
+		glm::vec3 point = nurbs.evaluate(uv, partials);
+		glm::vec3 residual = point - ray.origin - ray.direction * t;
+
+		if (glm::dot(residual, residual) < tolerance * tolerance)
+		{
+			if (t < 0.f) return false;
+
+			hit = { uv, point, t, patch };
+			return true;
+		}
+
+		glm::mat3 jacobian(partials[0], partials[1], -ray.direction);
+		if (std::abs(glm::determinant(jacobian)) < 1e-12f) return false;
+
+		glm::vec3 delta = glm::inverse(jacobian) * residual;
+		uv = glm::clamp(uv - NURBS::param_t(delta.x, delta.y), start, end);
+		t -= delta.z;
+	}
+	return false;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "Core/BVH.h"
+#include "Core/Camera.h"
+#include "Core/Nurbs.h"
+#include "Core/PointGrid.h"
+
+
+// Viewport picking of control points (through a uniform grid)
+// and of surface points (through a patch BVH + Newton refinement of the ray hit).
+// Both structures follow the surface lazily by its revision
+class Picker
+{
+public:
+	static const float  POINT_RADIUS;  // in pixels
+	static const size_t MAX_ITERATIONS = 12;
+
+	struct PointHit
+	{
+		size_t index;
+		float  t;
+	};
+	struct SurfaceHit
+	{
+		NURBS::param_t uv;
+		glm::vec3 point;
+		float  t;
+		size_t patch;
+	};
+
+private:
+	static const size_t UNSYNCED = size_t(-1);
+
+	PointGrid grid;
+	BVH bvh;
+
+	size_t gridRevision = UNSYNCED;
+	size_t bvhRevision  = UNSYNCED;
+
+public:
+	// Call right after nurbs.setControlPoint(i, ...) to refit only the affected patches
+	void controlPointMoved(const NURBS& nurbs, size_t i);
+
+	bool pickPoint(const NURBS& nurbs, const Camera& camera, glm::vec2 cursor, PointHit& hit);
+	bool pickSurface(const NURBS& nurbs, const Camera& camera, glm::vec2 cursor, SurfaceHit& hit);
+
+	// Ray/patch intersection, seeded from a coarse sample of the patch
+	static bool intersectPatch(const NURBS& nurbs, size_t patch, const Camera::Ray& ray, SurfaceHit& hit);
+
+private:
+	void syncGrid(const NURBS& nurbs);
+	void syncBVH(const NURBS& nurbs);
+};
@@ -36,7 +36,7 @@
 #elif defined(__linux__)                         // Linux...
 	#define CW_PLATFORM_LINUX                  // Debian, Ubuntu, Gentoo, Fedora, 
                                                  // openSUSE, RedHat, Centos & other
-	#error "Linux is not supported!"
+	// Headless (EGL) runs on CI & render nodes, see Core/Headless.h
 #else                                            // Unknown compiler/platform
 	#error "Unknown platform!"
 #endif
@@ -0,0 +1,153 @@
+#include "Core/PointGrid.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+
+void PointGrid::build(const std::vector<glm::vec3>& points, const AABB& bounds)
+{
+	box = bounds;
+	items.clear(); cellStart.clear();
+	if (points.empty()) return;
+
+	// Cell edge from the area of the two widest axes, the third one may well be flat.
+	// If it isn't, the volume bounds the cell count, grown further while rounding up exceeds it
+	glm::vec3 extent = box.extent();
+	float axes[3] = { extent.x, extent.y, extent.z };
+	std::sort(axes, axes + 3);
+
+	float area = std::max(axes[2] * axes[1], axes[2] * axes[2] * 1e-6f);
+	float volume = axes[2] * axes[1] * axes[0];
+	size_t maxCells = MAX_CELLS_PER_POINT * points.size();
+	cellSize = std::max({ std::sqrt(area / points.size()), std::cbrt(volume / maxCells), 1e-6f });
+
+	size_t cells = 0;
+	for (;; cellSize *= 1.25f)
+	{
+		cells = 1;
+		for (int i = 0; i < 3; i++)
+		{
+			resolution[i] = std::max(1, int(std::ceil(extent[i] / cellSize)));
+			cells *= resolution[i];
+		}
+		if (cells <= maxCells) break;
+	}
+
+	// Counting sort of the points by cell
+	cellStart.assign(cells + 1, 0);
+	for (auto& point : points) cellStart[cellIndex(cellOf(point)) + 1]++;
+	for (size_t c = 0; c < cells; c++) cellStart[c+1] += cellStart[c];
+
+	std::vector<uint32_t> fill(cellStart.begin(), cellStart.end() - 1);
+	items.resize(points.size());
+	for (uint32_t i = 0; i < points.size(); i++)
+		items[fill[cellIndex(cellOf(points[i]))]++] = i;
+}
+
+bool PointGrid::raycast(const std::vector<glm::vec3>& points, const glm::vec3& origin, const glm::vec3& direction,
+	float radius, float slope, size_t& index, float& t) const
+{
+	if (items.empty()) return false;
+
+	glm::vec3 invDir;
+	for (int i = 0; i < 3; i++)
+		invDir[i] = (direction[i] != 0.f) ? 1.f / direction[i] : std::numeric_limits<float>::max();
+
+	// Clip the ray by the grid box grown by the largest pick radius it could need:
+	// no point of the box is farther along the ray than its center plus half the diagonal
+	float tNear = 0.f, tFar = std::numeric_limits<float>::max();
+	AABB grown = box;
+	float margin = radius + slope * (glm::length(box.center() - origin) + glm::length(box.extent()));
+	grown.min -= glm::vec3(margin);
+	grown.max += glm::vec3(margin);
+	if (!grown.intersect(origin, invDir, tNear, tFar)) return false;
+
+	bool found = false;
+	float bestT = std::numeric_limits<float>::max();
+
+	auto testPoint = [&](uint32_t i)
+	{
+		const glm::vec3& point = points[i];
+
+		float along = glm::dot(point - origin, direction);
+		if (along < 0.f || along >= bestT) return;
+
+		glm::vec3 offset = point - origin - direction * along;
+		float allowed = radius + slope * along;
+		if (glm::dot(offset, offset) <= allowed * allowed)
+		{
+			found = true;
+			bestT = along;
+			index = i;
+		}
+	};
+
+	// A point is tested from the cell its projection on the ray is in, so a cell is widened
+	// by the radius where the ray leaves it. Past the grid's size that adds nothing
+	int maxResolution = std::max({ resolution.x, resolution.y, resolution.z });
+	auto reachAt = [&](float t)
+	{ return int(std::min(std::ceil((radius + slope * t) / cellSize), float(maxResolution))); };
+	int maxReach = reachAt(tFar);
+
+	double steps = 3.0, neighbourhood = 1.0;
+	for (int i = 0; i < 3; i++)
+	{
+		steps += double(tFar - tNear) * std::abs(direction[i]) / cellSize;
+		neighbourhood *= std::min(2 * maxReach + 1, resolution[i]);
+	}
+	if (steps * neighbourhood >= double(cellStart.size()))
+	{
+		for (uint32_t i : items) testPoint(i);
+		if (found) t = bestT;
+		return found;
+	}
+
+	// 3D DDA over the cells the ray passes, each one widened by its reach.
+	// Starting cell isn't clamped, the ray may enter from the grown margin
+	glm::vec3 start = origin + direction * tNear;
+	glm::ivec3 cell, step;
+	for (int i = 0; i < 3; i++)
+		cell[i] = int(std::floor((start[i] - box.min[i]) / cellSize));
+
+	glm::vec3 tNext, tDelta;
+	for (int i = 0; i < 3; i++)
+	{
+		step[i] = (direction[i] >= 0.f) ? 1 : -1;
+
+		float boundary = box.min[i] + (cell[i] + (step[i] > 0 ? 1 : 0)) * cellSize;
+		tNext[i]  = (direction[i] != 0.f) ? tNear + (boundary - start[i]) * invDir[i] : std::numeric_limits<float>::max();
+		tDelta[i] = (direction[i] != 0.f) ? cellSize * std::abs(invDir[i]) : std::numeric_limits<float>::max();
+	}
+
+	// Points of the later cells are farther along the ray than the cell's start
+	float tCell = tNear;
+	while (tCell <= tFar && tCell <= bestT)
+	{
+		int axis = 0;
+		if (tNext[1] < tNext[axis]) axis = 1;
+		if (tNext[2] < tNext[axis]) axis = 2;
+
+		int reach = reachAt(std::min(tNext[axis], tFar));
+		glm::ivec3 low  = glm::max(cell - reach, glm::ivec3(0));
+		glm::ivec3 high = glm::min(cell + reach, resolution - 1);
+		for (int z = low.z; z <= high.z; z++)
+			for (int y = low.y; y <= high.y; y++)
+				for (int x = low.x; x <= high.x; x++)
+				{
+					size_t c = cellIndex(glm::ivec3(x, y, z));
+					for (uint32_t k = cellStart[c]; k < cellStart[c+1]; k++) testPoint(items[k]);
+				}
+
+		tCell = tNext[axis];
+		tNext[axis] += tDelta[axis];
+		cell[axis]  += step[axis];
+
+		// Walked off the grid and moving away from it
+		if ((step[axis] > 0 && cell[axis] >= resolution[axis] + maxReach) ||
+		    (step[axis] < 0 && cell[axis] < -maxReach)) break;
+	}
+
+	if (found) t = bestT;
+	return found;
+}
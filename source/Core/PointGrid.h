@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "glm/glm.hpp"
+
+#include "Core/Bounds.h"
+
+
+// Uniform grid over a point set (cells stored CSR-like: cellStart + items),
+// sized for about one point per cell of the two widest axes since control nets are mostly 2D,
+// and coarser where the net is curved enough that this would give many cells per point
+class PointGrid
+{
+public:
+	static const size_t MAX_CELLS_PER_POINT = 2;
+
+private:
+	AABB box;
+	glm::ivec3 resolution = glm::ivec3(0);
+	float cellSize = 1.f;
+
+	std::vector<uint32_t> cellStart;
+	std::vector<uint32_t> items;
+
+public:
+	void build(const std::vector<glm::vec3>& points, const AABB& bounds);
+	inline bool isEmpty() const { return items.empty(); }
+	inline size_t cellCount() const { return cellStart.empty() ? 0 : cellStart.size() - 1; }
+
+	// Marches the cells along the ray looking for the point with the smallest t
+	// whose distance to the ray is within radius(t) = radius + slope * t.
+	// Cells are widened by that radius, a cone covering more cells than the grid has
+	// tests every point once instead
+	bool raycast(const std::vector<glm::vec3>& points, const glm::vec3& origin, const glm::vec3& direction,
+		float radius, float slope, size_t& index, float& t) const;
+
+private:
+	inline glm::ivec3 cellOf(const glm::vec3& point) const
+	{
+		glm::ivec3 cell;
+		for (int i = 0; i < 3; i++)
+			cell[i] = std::clamp(int((point[i] - box.min[i]) / cellSize), 0, resolution[i] - 1);
+		return cell;
+	}
+	inline size_t cellIndex(const glm::ivec3& cell) const
+	{ return (size_t(cell.z) * resolution.y + cell.y) * resolution.x + cell.x; }
+};
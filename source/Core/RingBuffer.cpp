@@ -0,0 +1,79 @@
+#include "Core/RingBuffer.h"
+
+#include <stdexcept>
+
+
+bool RingBuffer::isSupported()
+{
+	return GL::BufferStorage && GL::FenceSync && GL::MapBufferRange &&
+		(GL::version() >= 44 || GL::hasExtension("GL_ARB_buffer_storage"));
+}
+
+void RingBuffer::create(size_t size)
+{
+	destroy();
+	regionSize = (size + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+
+	const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	GLsizeiptr bytes = GLsizeiptr(regionSize * REGIONS);
+
+	// The target only matters for the calls below, the buffer can be bound anywhere afterwards
+	glGenBuffers(1, &buffer);
+	glBindBuffer(GL_ARRAY_BUFFER, buffer);
+	glBufferStorage(GL_ARRAY_BUFFER, bytes, nullptr, flags);
+	memory = static_cast<std::byte*>(glMapBufferRange(GL_ARRAY_BUFFER, 0, bytes, flags));
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	if (!memory)
+	{
+		destroy();
+		throw std::runtime_error
+		("RingBuffer::create: failed to map the buffer persistently.");
+	}
+}
+
+void RingBuffer::destroy()
+{
+	for (GLsync& sync : fences)
+	{
+		if (sync) glDeleteSync(sync);
+		sync = nullptr;
+	}
+	if (buffer)
+	{
+		// Deleting a buffer unmaps it
+		glDeleteBuffers(1, &buffer);
+		buffer = 0;
+	}
+	memory = nullptr;
+	regionSize = 0;
+}
+
+std::byte* RingBuffer::acquire(size_t region)
+{
+	statistics.acquired++;
+
+	GLsync& sync = fences[region];
+	if (sync)
+	{
+		// Zero timeout first to tell a free region from a stall
+		GLenum result = glClientWaitSync(sync, 0, 0);
+		if (result == GL_TIMEOUT_EXPIRED)
+		{
+			statistics.stalls++;
+			const GLuint64 SECOND = 1000000000;
+			do result = glClientWaitSync(sync, GL_SYNC_FLUSH_COMMANDS_BIT, SECOND);
+			while (result == GL_TIMEOUT_EXPIRED);
+		}
+		glDeleteSync(sync);
+		sync = nullptr;
+	}
+	return memory + offset(region);
+}
+
+void RingBuffer::fence(size_t region)
+{
+	GLsync& sync = fences[region];
+	if (sync) glDeleteSync(sync);
+	sync = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
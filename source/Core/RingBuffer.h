@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstddef>
+
+#include "Core/OpenGL.h"
+
+
+// Buffer for data rewritten every frame (GL 4.4 or ARB_buffer_storage): it's mapped once,
+// persistently and coherently, and split into REGIONS regions written round-robin.
+// The CPU fills one region while the GPU may still be reading the others, a fence placed
+// after the last commands reading a region tells when it can be written again, so
+// updates neither reallocate the buffer nor wait for the pipeline to drain
+class RingBuffer
+{
+public:
+	static const size_t REGIONS = 3;
+
+	struct Statistics
+	{
+		size_t acquired = 0;
+		size_t stalls   = 0;  // Acquisitions that had to wait for the GPU
+	};
+
+	RingBuffer() = default;
+	inline ~RingBuffer() { destroy(); }
+
+	RingBuffer(const RingBuffer&) = delete;
+	RingBuffer& operator=(const RingBuffer&) = delete;
+
+	static bool isSupported();
+
+	// Replaces the buffer by a new one, regions start at multiples of ALIGNMENT.
+	// Throws std::runtime_error if it can't be mapped
+	void create(size_t regionSize);
+	void destroy();
+
+	// Waits until the GPU is done with the region and returns its memory
+	std::byte* acquire(size_t region);
+	// Call after the commands that read the region were issued
+	void fence(size_t region);
+
+	inline bool isCreated() const { return buffer != 0; }
+	inline GLuint getId() const { return buffer; }
+	inline size_t getRegionSize() const { return regionSize; }
+	inline size_t offset(size_t region) const { return region * regionSize; }
+	inline const Statistics& getStatistics() const { return statistics; }
+
+private:
+	static const size_t ALIGNMENT = 256;
+
+	GLuint buffer = 0;
+	std::byte* memory = nullptr;
+	size_t regionSize = 0;
+	GLsync fences[REGIONS] = {};
+
+	Statistics statistics;
+};
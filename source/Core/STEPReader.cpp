@@ -0,0 +1,534 @@
+#include "Core/STEPReader.h"
+
+#include <algorithm>
+#include <charconv>
+#include <optional>
+#include <stdexcept>
+#include <string_view>
+#include "Core/MappedFile.h"
+#include "Core/Parallel.h"
+
+
+namespace
+{
+	// Where an entity instance '#id = body;' lies in the mapped file
+	struct Instance
+	{
+		uint64_t id;
+		const char* begin;
+		const char* end;
+	};
+
+	// Sorted by id, so references resolve by binary search
+	class InstanceIndex
+	{
+		std::vector<Instance> instances;
+
+	public:
+		inline void add(const Instance& instance) { instances.push_back(instance); }
+		inline size_t size() const { return instances.size(); }
+		inline const std::vector<Instance>& all() const { return instances; }
+
+		void sort()
+		{
+			auto byId = [](const Instance& a, const Instance& b) { return a.id < b.id; };
+			if (!std::is_sorted(instances.begin(), instances.end(), byId))
+				std::sort(instances.begin(), instances.end(), byId);
+		}
+
+		const Instance* find(uint64_t id) const
+		{
+			auto it = std::lower_bound(instances.begin(), instances.end(), id,
+				[](const Instance& a, uint64_t id) { return a.id < id; });
+			return (it != instances.end() && it->id == id) ? &*it : nullptr;
+		}
+	};
+
+	inline bool isSpace(char c) { return c == ' ' || c == '\n' || c == '\r' || c == '\t'; }
+	inline bool isDigit(char c) { return c >= '0' && c <= '9'; }
+	inline bool isUpper(char c) { return (c >= 'A' && c <= 'Z') || c == '_'; }
+
+	// Skips white space and /* comments */, returns the first other character
+	const char* skipSpace(const char* p, const char* end)
+	{
+		while (p < end)
+		{
+			if (isSpace(*p)) p++;
+			else if (*p == '/' && p + 1 < end && p[1] == '*')
+			{
+				size_t close = std::string_view(p + 2, end - p - 2).find("*/");
+				p = (close == std::string_view::npos) ? end : p + 2 + close + 2;
+			}
+			else break;
+		}
+		return p;
+	}
+
+	enum class Token { END, REFERENCE, NUMBER, STRING, ENUMERATION, KEYWORD, OPEN, CLOSE, COMMA, OMITTED, ERROR };
+
+	// Tokens of a single instance body
+	class Lexer
+	{
+		const char* p;
+		const char* end;
+
+	public:
+		std::string_view text;
+		double   number    = 0.0;
+		uint64_t reference = 0;
+
+		Lexer(const char* begin, const char* end) : p(begin), end(end) {}
+
+		Token next()
+		{
+			p = skipSpace(p, end);
+			if (p >= end) return Token::END;
+
+			const char* start = p;
+			switch (*p)
+			{
+			case '(': p++; return Token::OPEN;
+			case ')': p++; return Token::CLOSE;
+			case ',': p++; return Token::COMMA;
+			case '$': case '*': p++; return Token::OMITTED;
+
+			case '#':
+			{
+				auto [last, error] = std::from_chars(p + 1, end, reference);
+				if (error != std::errc()) return Token::ERROR;
+				p = last;
+				return Token::REFERENCE;
+			}
+			case '\'':
+				// Quotes inside strings are doubled, so every pair of quotes closes and reopens it
+				for (p++; p < end; p++)
+					if (*p == '\'' && !(p + 1 < end && p[1] == '\'')) break;
+					else if (*p == '\'') p++;
+				if (p >= end) return Token::ERROR;
+				text = std::string_view(start + 1, p - start - 1);
+				p++;
+				return Token::STRING;
+
+			case '.':
+				if (p + 1 < end && isUpper(p[1]))
+				{
+					for (p++; p < end && *p != '.'; p++) {}
+					if (p >= end) return Token::ERROR;
+					text = std::string_view(start + 1, p - start - 1);
+					p++;
+					return Token::ENUMERATION;
+				}
+				break;
+			}
+
+			if (isUpper(*p))
+			{
+				while (p < end && (isUpper(*p) || isDigit(*p))) p++;
+				text = std::string_view(start, p - start);
+				return Token::KEYWORD;
+			}
+
+			// from_chars doesn't take an explicit plus sign
+			if (*p == '+') p++;
+			auto [last, error] = std::from_chars(p, end, number);
+			if (error != std::errc()) return Token::ERROR;
+			p = last;
+			return Token::NUMBER;
+		}
+	};
+
+	// Recursive descent over the tokens with one token of lookahead.
+	// Any mismatch sets 'failed', every later call then fails as well
+	class Parser
+	{
+		Lexer lexer;
+		Token current;
+
+	public:
+		bool failed = false;
+
+		Parser(const char* begin, const char* end) : lexer(begin, end) { current = lexer.next(); }
+		Parser(const Instance& instance) : Parser(instance.begin, instance.end) {}
+
+		inline Token peek() const { return current; }
+		inline std::string_view text() const { return lexer.text; }
+
+		inline void advance() { current = lexer.next(); }
+		inline bool accept(Token token)
+		{
+			if (current != token) return false;
+			advance();
+			return true;
+		}
+		inline bool expect(Token token)
+		{
+			if (!failed && accept(token)) return true;
+			failed = true;
+			return false;
+		}
+
+		bool keyword(std::string_view name)
+		{
+			if (current == Token::KEYWORD && lexer.text == name) { advance(); return true; }
+			failed = true;
+			return false;
+		}
+
+		double number()
+		{
+			double value = lexer.number;
+			expect(Token::NUMBER);
+			return value;
+		}
+
+		uint64_t reference()
+		{
+			uint64_t value = lexer.reference;
+			expect(Token::REFERENCE);
+			return value;
+		}
+
+		// Comma separated list in parentheses, item() parses one element
+		template<typename Function>
+		void list(Function&& item)
+		{
+			if (!expect(Token::OPEN) || accept(Token::CLOSE)) return;
+			do item(); while (!failed && accept(Token::COMMA));
+			expect(Token::CLOSE);
+		}
+
+		// Any single parameter (including nested lists and typed values)
+		void skip()
+		{
+			if (failed) return;
+			if (current == Token::OPEN)
+			{
+				list([this]() { skip(); });
+				return;
+			}
+			if (current == Token::KEYWORD)
+			{
+				advance();
+				list([this]() { skip(); });
+				return;
+			}
+			if (current == Token::END || current == Token::CLOSE || current == Token::COMMA || current == Token::ERROR)
+				failed = true;
+			else
+				advance();
+		}
+
+		inline void comma() { expect(Token::COMMA); }
+	};
+
+	// Attributes of B_SPLINE_SURFACE_WITH_KNOTS gathered from either instance form
+	struct SurfaceData
+	{
+		size_t degree[2] = { 0, 0 };
+		std::vector<std::vector<uint64_t>> points;    // [u][v]
+		std::vector<double> multiplicities[2];
+		std::vector<double> knots[2];
+		std::vector<std::vector<double>>   weights;   // [u][v], empty if not rational
+	};
+
+	// B_SPLINE_SURFACE attributes after the name
+	void parseSurface(Parser& parser, SurfaceData& data)
+	{
+		data.degree[0] = size_t(parser.number()); parser.comma();
+		data.degree[1] = size_t(parser.number()); parser.comma();
+		parser.list([&]()
+		{
+			auto& row = data.points.emplace_back();
+			parser.list([&]() { row.push_back(parser.reference()); });
+		});
+		for (int i = 0; i < 4; i++) { parser.comma(); parser.skip(); }  // Form, closed in U/V, self intersect
+	}
+
+	// B_SPLINE_SURFACE_WITH_KNOTS attributes after the ones of B_SPLINE_SURFACE
+	void parseKnots(Parser& parser, SurfaceData& data)
+	{
+		for (int d = 0; d < 2; d++)
+		{
+			parser.list([&]() { data.multiplicities[d].push_back(parser.number()); });
+			parser.comma();
+		}
+		for (int d = 0; d < 2; d++)
+		{
+			parser.list([&]() { data.knots[d].push_back(parser.number()); });
+			parser.comma();
+		}
+		parser.skip();  // Knot type
+	}
+
+	void parseWeights(Parser& parser, SurfaceData& data)
+	{
+		parser.list([&]()
+		{
+			auto& row = data.weights.emplace_back();
+			parser.list([&]() { row.push_back(parser.number()); });
+		});
+	}
+
+	bool parseInstance(const Instance& instance, SurfaceData& data)
+	{
+		Parser parser(instance);
+
+		if (parser.peek() == Token::KEYWORD)
+		{
+			// #1 = B_SPLINE_SURFACE_WITH_KNOTS('name', degrees, points, ..., multiplicities, knots, type)
+			parser.keyword("B_SPLINE_SURFACE_WITH_KNOTS");
+			parser.expect(Token::OPEN);
+			parser.skip(); parser.comma();
+			parseSurface(parser, data); parser.comma();
+			parseKnots(parser, data);
+			parser.expect(Token::CLOSE);
+			return !parser.failed;
+		}
+
+		// #1 = ( B_SPLINE_SURFACE(...) B_SPLINE_SURFACE_WITH_KNOTS(...) RATIONAL_B_SPLINE_SURFACE(...) ... ),
+		// each partial type only lists its own attributes
+		bool hasSurface = false, hasKnots = false;
+		parser.expect(Token::OPEN);
+		while (!parser.failed && parser.peek() == Token::KEYWORD)
+		{
+			std::string_view type = parser.text();
+			parser.advance();
+
+			if (type == "B_SPLINE_SURFACE")
+			{
+				parser.expect(Token::OPEN);
+				parseSurface(parser, data);
+				parser.expect(Token::CLOSE);
+				hasSurface = true;
+			}
+			else if (type == "B_SPLINE_SURFACE_WITH_KNOTS")
+			{
+				parser.expect(Token::OPEN);
+				parseKnots(parser, data);
+				parser.expect(Token::CLOSE);
+				hasKnots = true;
+			}
+			else if (type == "RATIONAL_B_SPLINE_SURFACE")
+			{
+				parser.expect(Token::OPEN);
+				parseWeights(parser, data);
+				parser.expect(Token::CLOSE);
+			}
+			else parser.list([&parser]() { parser.skip(); });
+		}
+		parser.expect(Token::CLOSE);
+		return !parser.failed && hasSurface && hasKnots;
+	}
+
+	// CARTESIAN_POINT('name', (x, y[, z]))
+	bool parsePoint(const Instance& instance, glm::dvec3& point)
+	{
+		Parser parser(instance);
+		parser.keyword("CARTESIAN_POINT");
+		parser.expect(Token::OPEN);
+		parser.skip(); parser.comma();
+
+		point = glm::dvec3(0.0);
+		int count = 0;
+		parser.list([&]()
+		{
+			double value = parser.number();
+			if (count < 3) point[count] = value;
+			count++;
+		});
+		parser.expect(Token::CLOSE);
+		return !parser.failed && count >= 2 && count <= 3;
+	}
+
+	// Knot values repeated by their multiplicities. A multiplicity above degree + 1 or a total other than
+	// the 'count' the layout needs is rejected before anything is expanded, the file's numbers aren't trusted
+	std::optional<std::vector<double>> expandKnots(const std::vector<double>& multiplicities, const std::vector<double>& knots,
+		size_t degree, size_t count)
+	{
+		if (multiplicities.size() != knots.size()) return std::nullopt;
+
+		size_t total = 0;
+		for (double m : multiplicities)
+		{
+			// Also rejects NaNs
+			if (!(m >= 1.0 && m <= double(degree + 1))) return std::nullopt;
+			total += size_t(m);
+		}
+		if (total != count) return std::nullopt;
+
+		std::vector<double> result;
+		result.reserve(count);
+		for (size_t i = 0; i < knots.size(); i++)
+			result.insert(result.end(), size_t(multiplicities[i]), knots[i]);
+		return result;
+	}
+
+	std::optional<STEPReader::surface_t> buildSurface(const SurfaceData& data, const InstanceIndex& index)
+	{
+		using surface_t = STEPReader::surface_t;
+
+		size_t dimU = data.points.size();
+		size_t dimV = dimU ? data.points[0].size() : 0;
+		if (dimU < surface_t::MIN_DIM || dimV < surface_t::MIN_DIM || dimU > surface_t::MAX_DIM || dimV > surface_t::MAX_DIM)
+			return std::nullopt;
+		for (auto& row : data.points)
+			if (row.size() != dimV) return std::nullopt;
+
+		size_t dims[2] = { dimU, dimV };
+		surface_t surface(dimU, dimV);
+		for (int d = 0; d < 2; d++)
+		{
+			if (data.degree[d] < surface_t::MIN_DEGREE || data.degree[d] > surface.getMaxDegree(surface_t::Dim(d)))
+				return std::nullopt;
+			surface.setDegree(surface_t::Dim(d), data.degree[d]);
+
+			auto knots = expandKnots(data.multiplicities[d], data.knots[d], data.degree[d], dims[d] + data.degree[d] + 1);
+			if (!knots || !std::is_sorted(knots->begin(), knots->end()) ||
+				(*knots)[data.degree[d]] >= (*knots)[dims[d]])
+				return std::nullopt;
+			surface.setKnots(surface_t::Dim(d), std::move(*knots));
+		}
+
+		// STEP lists points (and weights) U-major, the net is stored with U changing the fastest
+		for (size_t u = 0; u < dimU; u++)
+			for (size_t v = 0; v < dimV; v++)
+			{
+				const Instance* point = index.find(data.points[u][v]);
+				if (!point || !parsePoint(*point, surface.controlPoints[surface.uv2index(u, v)]))
+					return std::nullopt;
+			}
+
+		if (!data.weights.empty())
+		{
+			if (data.weights.size() != dimU) return std::nullopt;
+
+			surface.weights.resize(dimU * dimV);
+			for (size_t u = 0; u < dimU; u++)
+			{
+				if (data.weights[u].size() != dimV) return std::nullopt;
+				for (size_t v = 0; v < dimV; v++)
+				{
+					if (data.weights[u][v] <= 0.0) return std::nullopt;
+					surface.weights[surface.uv2index(u, v)] = data.weights[u][v];
+				}
+			}
+		}
+
+		surface.invalidate();
+		return surface;
+	}
+
+	// Whether an instance body is (or, for complex instances, contains) a B-spline surface with knots
+	bool isSurface(const Instance& instance)
+	{
+		const std::string_view NAME = "B_SPLINE_SURFACE_WITH_KNOTS";
+
+		const char* p = skipSpace(instance.begin, instance.end);
+		std::string_view body(p, instance.end - p);
+		if (body.empty()) return false;
+
+		if (body[0] != '(')
+			return body.size() > NAME.size() && body.substr(0, NAME.size()) == NAME && !isUpper(body[NAME.size()]);
+
+		size_t at = body.find(NAME);
+		return at != std::string_view::npos && at + NAME.size() < body.size() && !isUpper(body[at + NAME.size()]);
+	}
+}
+
+
+STEPReader::Statistics STEPReader::read(const std::string& path, std::vector<surface_t>& out)
+{
+	MappedFile file(path);
+	const char* begin = reinterpret_cast<const char*>(file.getData());
+	const char* end   = begin + file.getSize();
+	std::string_view content(begin, file.getSize());
+
+	if (content.substr(0, 13) != "ISO-10303-21;")
+		throw std::runtime_error
+		("STEPReader::read: " + path + " is not a STEP exchange structure.");
+
+	size_t data = content.find("DATA;");
+	if (data == std::string_view::npos)
+		throw std::runtime_error
+		("STEPReader::read: " + path + " has no DATA section.");
+
+	// Index of instances, bodies are left unparsed
+	InstanceIndex index;
+	const char* p = begin + data + 5;
+	while (true)
+	{
+		p = skipSpace(p, end);
+		if (p >= end || *p != '#') break;  // ENDSEC
+
+		uint64_t id = 0;
+		auto [last, error] = std::from_chars(p + 1, end, id);
+		if (error != std::errc())
+			throw std::runtime_error
+			("STEPReader::read: malformed instance name.");
+
+		p = skipSpace(last, end);
+		if (p >= end || *p != '=')
+			throw std::runtime_error
+			("STEPReader::read: malformed instance #" + std::to_string(id) + ".");
+
+		// Body ends at the first semicolon outside of strings and comments
+		const char* body = ++p;
+		bool inString = false;
+		for (; p < end; p++)
+		{
+			if (*p == '\'') inString = !inString;
+			else if (!inString && *p == ';') break;
+			else if (!inString && *p == '/' && p + 1 < end && p[1] == '*')
+				p = skipSpace(p, end) - 1;  // Lands on the character after the comment
+		}
+		if (p >= end)
+			throw std::runtime_error
+			("STEPReader::read: unterminated instance #" + std::to_string(id) + ".");
+
+		index.add({ id, body, p });
+		p++;
+	}
+	index.sort();
+
+	Statistics statistics;
+	statistics.entities = index.size();
+
+	std::vector<const Instance*> roots;
+	for (auto& instance : index.all())
+		if (isSurface(instance)) roots.push_back(&instance);
+
+	std::vector<std::optional<surface_t>> surfaces(roots.size());
+	// A surface that throws (e.g. bad_alloc) is counted as failed, like a malformed one
+	Parallel::forEach(0, roots.size(), [&](size_t i)
+	{
+		try
+		{
+			SurfaceData data;
+			if (parseInstance(*roots[i], data)) surfaces[i] = buildSurface(data, index);
+		}
+		catch (const std::exception&) { surfaces[i].reset(); }
+	}, 4);
+
+	// Index is sorted by id, file order is the order of the bodies
+	std::vector<size_t> order(roots.size());
+	for (size_t i = 0; i < order.size(); i++) order[i] = i;
+	std::sort(order.begin(), order.end(), [&roots](size_t a, size_t b) { return roots[a]->begin < roots[b]->begin; });
+
+	for (size_t i : order)
+	{
+		if (surfaces[i])
+		{
+			out.push_back(std::move(*surfaces[i]));
+			statistics.surfaces++;
+		}
+		else statistics.failed++;
+	}
+	return statistics;
+}
+
+std::vector<STEPReader::surface_t> STEPReader::readSurfaces(const std::string& path)
+{
+	std::vector<surface_t> surfaces;
+	read(path, surfaces);
+	return surfaces;
+}
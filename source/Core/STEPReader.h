@@ -0,0 +1,32 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "Core/Nurbs.h"
+
+
+// Reader of B-spline surfaces from STEP (ISO 10303-21, AP203/AP214) files.
+//
+// The mapped DATA section is scanned once to index where every entity instance
+// starts and ends, without parsing it. Only B_SPLINE_SURFACE_WITH_KNOTS instances
+// (plain or complex, with RATIONAL_B_SPLINE_SURFACE weights) and the points they
+// reference are parsed, surfaces in parallel. Placements and units are not applied
+class STEPReader
+{
+public:
+	using surface_t = NURBSd;
+
+	struct Statistics
+	{
+		size_t entities = 0;  // Instances in the DATA section
+		size_t surfaces = 0;
+		size_t failed   = 0;  // Malformed or unsupported (e.g. degree above NURBS::MAX_DEGREE)
+	};
+
+	// Surfaces are appended to 'out' in file order.
+	// Throws std::runtime_error if the file can't be read or isn't an exchange structure
+	static Statistics read(const std::string& path, std::vector<surface_t>& out);
+
+	static std::vector<surface_t> readSurfaces(const std::string& path);
+};
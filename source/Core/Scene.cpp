@@ -0,0 +1,455 @@
+#include "Core/Scene.h"
+
+#include <cmath>
+#include <fstream>
+#include <stdexcept>
+#include "Core/JSONReader.h"
+#include "Core/TextStream.h"
+
+
+namespace
+{
+	using surface_t = Scene::surface_t;
+	using scalar_t  = surface_t::scalar_t;
+
+	const int PARAM_DIM = surface_t::PARAM_DIM;
+	const int POINT_DIM = surface_t::POINT_DIM;
+
+	// Meaning of a JSON value, decided by where it is in the document
+	enum class Field
+	{
+		SKIP,  // Unknown member, its whole subtree is ignored
+		ROOT,
+		APPEARANCE, COLORS, COLOR, SHOW_POINTS, SHOW_NET,
+		SURFACES, SURFACE, DIM, DEGREE, CLAMP, CLAMP_DIRECTION, KNOTS, KNOT_LIST, WEIGHTS, POINTS
+	};
+
+	class SceneHandler : public JSONReader::Handler
+	{
+		struct Frame
+		{
+			Field field;
+			bool array;
+			size_t index = 0;  // Element being read (arrays)
+			size_t slot  = 0;  // Element of the parent array this one is (e.g. direction of knots)
+			glm::vec4* color = nullptr;
+		};
+
+		// Surface being read, the vectors are moved into the surface once it's complete
+		struct Surface
+		{
+			surface_t::index_t dims{};
+			surface_t::index_t degrees;
+			bool clamp[PARAM_DIM][2];
+			bool hasKnots[PARAM_DIM];
+			std::vector<scalar_t> knots[PARAM_DIM];
+			bool hasPoints = false, hasWeights = false;
+			surface_t::cp_t points;
+			std::vector<scalar_t> weights;
+			int coordinate = 0;
+		};
+
+		Scene& scene;
+		std::vector<Frame> stack;
+		Field pending = Field::ROOT;
+		glm::vec4* pendingColor = nullptr;
+		Surface surface;
+
+	public:
+		explicit SceneHandler(Scene& scene) : scene(scene) {}
+
+		void beginObject() override
+		{
+			Frame frame = child(false);
+			if (frame.field == Field::SURFACE) resetSurface();
+			stack.push_back(frame);
+		}
+
+		void key(std::string_view name) override
+		{
+			pending = Field::SKIP;
+			pendingColor = nullptr;
+			Scene::Appearance& a = scene.appearance;
+
+			switch (stack.back().field)
+			{
+			case Field::ROOT:
+				if      (name == "appearance") pending = Field::APPEARANCE;
+				else if (name == "surfaces")   pending = Field::SURFACES;
+				break;
+
+			case Field::APPEARANCE:
+				if      (name == "background") { pending = Field::COLOR; pendingColor = &a.background; }
+				else if (name == "points")     pending = Field::COLORS;
+				else if (name == "net")        { pending = Field::COLOR; pendingColor = &a.controlNet; }
+				else if (name == "showPoints") pending = Field::SHOW_POINTS;
+				else if (name == "showNet")    pending = Field::SHOW_NET;
+				break;
+
+			case Field::COLORS:
+				pending = Field::COLOR;
+				if      (name == "common") pendingColor = &a.pointCommon;
+				else if (name == "accent") pendingColor = &a.pointAccent;
+				else if (name == "nearby") pendingColor = &a.pointNearby;
+				else if (name == "insert") pendingColor = &a.pointInsert;
+				else if (name == "delete") pendingColor = &a.pointDelete;
+				else pending = Field::SKIP;
+				break;
+
+			case Field::SURFACE:
+				if      (name == "dim")     pending = Field::DIM;
+				else if (name == "degree")  pending = Field::DEGREE;
+				else if (name == "clamp")   pending = Field::CLAMP;
+				else if (name == "knots")   pending = Field::KNOTS;
+				else if (name == "weights") pending = Field::WEIGHTS;
+				else if (name == "points")  pending = Field::POINTS;
+				break;
+
+			default:
+				break;
+			}
+		}
+
+		void endObject() override
+		{
+			if (stack.back().field == Field::SURFACE) finishSurface();
+			stack.pop_back();
+			next();
+		}
+
+		void beginArray() override
+		{
+			requireRoot();
+			Frame frame = child(true);
+
+			const Frame& parent = stack.back();
+			switch (frame.field)
+			{
+			case Field::KNOT_LIST:
+				if (frame.slot < PARAM_DIM)
+				{
+					surface.hasKnots[frame.slot] = true;
+					surface.knots[frame.slot].clear();
+				}
+				break;
+			case Field::WEIGHTS:
+				surface.hasWeights = true;
+				break;
+			case Field::POINTS:
+				if (parent.field != Field::POINTS) surface.hasPoints = true;
+				else if (surface.coordinate != 0) fail("control points have to have 3 coordinates");
+				break;
+			default:
+				break;
+			}
+			stack.push_back(frame);
+		}
+
+		void endArray() override
+		{
+			Frame frame = stack.back();
+			stack.pop_back();
+			if (frame.field == Field::POINTS && surface.coordinate != 0)
+				fail("control points have to have 3 coordinates");
+			next();
+		}
+
+		void number(double value) override
+		{
+			requireRoot();
+			Frame& top = stack.back();
+			if (top.array)
+			{
+				size_t i = top.index;
+				switch (top.field)
+				{
+				case Field::POINTS:
+					if (surface.coordinate == 0) surface.points.emplace_back();
+					surface.points.back()[surface.coordinate] = scalar_t(value);
+					surface.coordinate = (surface.coordinate + 1) % POINT_DIM;
+					break;
+				case Field::KNOT_LIST:
+					if (top.slot < PARAM_DIM) surface.knots[top.slot].push_back(scalar_t(value));
+					break;
+				case Field::WEIGHTS:
+					surface.weights.push_back(scalar_t(value));
+					break;
+				case Field::DIM:
+					if (i < PARAM_DIM) surface.dims[i] = count(value);
+					break;
+				case Field::DEGREE:
+					if (i < PARAM_DIM) surface.degrees[i] = count(value);
+					break;
+				case Field::COLOR:
+					if (i < 4) (*top.color)[int(i)] = float(value);
+					break;
+				default:
+					break;
+				}
+			}
+			next();
+		}
+
+		void boolean(bool value) override
+		{
+			requireRoot();
+			const Frame& top = stack.back();
+			if (top.array && top.field == Field::CLAMP_DIRECTION && top.slot < PARAM_DIM && top.index < 2)
+				surface.clamp[top.slot][top.index] = value;
+			else if (!top.array && pending == Field::SHOW_POINTS)
+				scene.appearance.showPoints = value;
+			else if (!top.array && pending == Field::SHOW_NET)
+				scene.appearance.showNet = value;
+			next();
+		}
+
+		void string(std::string_view) override { requireRoot(); next(); }
+		void null() override                   { requireRoot(); next(); }
+
+	private:
+		[[noreturn]] void fail(const char* what) const
+		{
+			throw std::invalid_argument
+			("Scene::parse: surface " + std::to_string(scene.surfaces.size()) + ": " + what);
+		}
+
+		inline void requireRoot() const
+		{
+			if (stack.empty())
+				throw std::invalid_argument
+				("Scene::parse: document has to be an object.");
+		}
+
+		// Frame of a value starting at the current position
+		Frame child(bool array) const
+		{
+			if (stack.empty()) return { Field::ROOT, array };
+
+			const Frame& parent = stack.back();
+			if (!parent.array) return { pending, array, 0, 0, pendingColor };
+
+			Field field = Field::SKIP;
+			switch (parent.field)
+			{
+			case Field::SURFACES: field = Field::SURFACE;         break;
+			case Field::CLAMP:    field = Field::CLAMP_DIRECTION; break;
+			case Field::KNOTS:    field = Field::KNOT_LIST;       break;
+			case Field::POINTS:   field = Field::POINTS;          break;
+			default: break;
+			}
+			return { field, array, 0, parent.index };
+		}
+
+		// A value of the current container is complete
+		inline void next()
+		{
+			if (!stack.empty() && stack.back().array) stack.back().index++;
+		}
+
+		size_t count(double value) const
+		{
+			if (!(value >= 0.0 && value <= double(surface_t::MAX_DIM)) || value != std::floor(value))
+				fail("dims and degrees have to be small non-negative integers");
+			return size_t(value);
+		}
+
+		void resetSurface()
+		{
+			surface.dims = {};
+			surface.degrees.fill(surface_t::DEFAULT_DEGREE);
+			for (int d = 0; d < PARAM_DIM; d++)
+			{
+				surface.clamp[d][surface_t::START] = surface.clamp[d][surface_t::END] = true;
+				surface.hasKnots[d] = false;
+				surface.knots[d].clear();
+			}
+			surface.hasPoints = surface.hasWeights = false;
+			surface.points.clear();
+			surface.weights.clear();
+			surface.coordinate = 0;
+		}
+
+		void finishSurface()
+		{
+			for (int d = 0; d < PARAM_DIM; d++)
+				if (surface.dims[d] < surface_t::MIN_DIM || surface.dims[d] > surface_t::MAX_DIM)
+					fail("\"dim\" is missing or out of range");
+
+			surface_t result(surface.dims);
+			for (int d = 0; d < PARAM_DIM; d++)
+			{
+				surface_t::Dim dim = surface_t::Dim(d);
+				result.clampKnots[d][surface_t::START] = surface.clamp[d][surface_t::START];
+				result.clampKnots[d][surface_t::END]   = surface.clamp[d][surface_t::END];
+				result.setDegree(dim, surface.degrees[d]);
+				if (result.degree[d] != surface.degrees[d]) fail("degree is out of range");
+
+				if (surface.hasKnots[d]) result.setKnots(dim, std::move(surface.knots[d]));
+			}
+
+			if (surface.hasPoints)
+			{
+				if (surface.points.size() != result.controlPoints.size())
+					fail("number of points doesn't match the dims");
+				result.controlPoints = std::move(surface.points);
+			}
+			if (surface.hasWeights)
+			{
+				if (surface.weights.size() != result.controlPoints.size())
+					fail("number of weights doesn't match the dims");
+				for (scalar_t w : surface.weights)
+					if (!(w > scalar_t(0))) fail("weights have to be positive");
+				result.weights = std::move(surface.weights);
+			}
+
+			result.invalidate();
+			scene.surfaces.push_back(std::move(result));
+		}
+	};
+
+
+	class SceneWriter
+	{
+		TextWriter writer;
+
+	public:
+		explicit SceneWriter(std::ostream& out) : writer(out) {}
+
+		void write(const Scene& scene)
+		{
+			const Scene::Appearance& a = scene.appearance;
+			writer.text("{\n\t\"appearance\": {\n\t\t\"background\": "); color(a.background);
+			writer.text(",\n\t\t\"points\": {\n\t\t\t\"common\": "); color(a.pointCommon);
+			writer.text(",\n\t\t\t\"accent\": "); color(a.pointAccent);
+			writer.text(",\n\t\t\t\"nearby\": "); color(a.pointNearby);
+			writer.text(",\n\t\t\t\"insert\": "); color(a.pointInsert);
+			writer.text(",\n\t\t\t\"delete\": "); color(a.pointDelete);
+			writer.text("\n\t\t},\n\t\t\"net\": "); color(a.controlNet);
+			writer.text(",\n\t\t\"showPoints\": ").text(a.showPoints ? "true" : "false");
+			writer.text(",\n\t\t\"showNet\": ").text(a.showNet ? "true" : "false");
+			writer.text("\n\t},\n\t\"surfaces\": [");
+
+			for (size_t s = 0; s < scene.surfaces.size(); s++)
+			{
+				writer.text(s ? ",\n\t\t{\n" : "\n\t\t{\n");
+				surface(scene.surfaces[s]);
+				writer.text("\t\t}");
+			}
+			writer.text(scene.surfaces.empty() ? "]\n}\n" : "\n\t]\n}\n");
+		}
+
+	private:
+		template<typename T>
+		void number(T value)
+		{
+			if constexpr (std::is_floating_point_v<T>)
+				if (!std::isfinite(value))
+					throw std::invalid_argument
+					("Scene::write: JSON can't hold infinite or NaN values.");
+			writer.number(value);
+		}
+
+		// [a, b, ..]
+		template<typename Range, typename Item>
+		void list(const Range& range, Item&& item)
+		{
+			writer.character('[');
+			bool first = true;
+			for (auto& value : range)
+			{
+				if (!first) writer.text(", ");
+				item(value);
+				first = false;
+			}
+			writer.character(']');
+		}
+
+		void color(const glm::vec4& c)
+		{
+			float values[4] = { c.x, c.y, c.z, c.w };
+			list(values, [this](float v) { number(v); });
+		}
+
+		void surface(const surface_t& s)
+		{
+			auto perDirection = [this](const char* name, auto&& item)
+			{
+				int directions[PARAM_DIM];
+				for (int d = 0; d < PARAM_DIM; d++) directions[d] = d;
+				writer.text("\t\t\t\"").text(name).text("\": ");
+				list(directions, item);
+				writer.text(",\n");
+			};
+
+			perDirection("dim",    [&](int d) { number(s.dim[d]); });
+			perDirection("degree", [&](int d) { number(s.degree[d]); });
+			perDirection("clamp",  [&](int d)
+			{
+				bool flags[2] = { s.clampKnots[d][surface_t::START], s.clampKnots[d][surface_t::END] };
+				list(flags, [this](bool flag) { writer.text(flag ? "true" : "false"); });
+			});
+			perDirection("knots", [&](int d) { list(s.knots[d], [this](scalar_t k) { number(k); }); });
+
+			// Rows along U on separate lines
+			auto rows = [&](const char* name, auto&& item)
+			{
+				writer.text("\t\t\t\"").text(name).text("\": [\n\t\t\t\t");
+				for (size_t i = 0; i < s.controlPoints.size(); i++)
+				{
+					if (i > 0) writer.text((i % s.dim[surface_t::U] == 0) ? ",\n\t\t\t\t" : ", ");
+					item(i);
+				}
+				writer.text("\n\t\t\t]");
+			};
+
+			if (s.isRational())
+			{
+				rows("weights", [&](size_t i) { number(s.weights[i]); });
+				writer.text(",\n");
+			}
+			rows("points", [&](size_t i)
+			{
+				const auto& cp = s.controlPoints[i];
+				writer.character('[');
+				for (int c = 0; c < POINT_DIM; c++)
+				{
+					if (c > 0) writer.text(", ");
+					number(cp[c]);
+				}
+				writer.character(']');
+			});
+			writer.character('\n');
+		}
+	};
+}
+
+
+void Scene::read(const std::string& path, Scene& scene)
+{
+	SceneHandler handler(scene);
+	JSONReader::parseFile(path, handler);
+}
+
+void Scene::parse(std::string_view text, Scene& scene)
+{
+	SceneHandler handler(scene);
+	JSONReader::parse(text, handler);
+}
+
+void Scene::write(const std::string& path, const Scene& scene)
+{
+	std::ofstream out(path, std::ios::binary | std::ios::trunc);
+	if (!out)
+		throw std::runtime_error
+		("Scene::write: can't create " + path);
+
+	write(out, scene);
+	if (!out)
+		throw std::runtime_error
+		("Scene::write: failed to write " + path);
+}
+
+void Scene::write(std::ostream& out, const Scene& scene)
+{
+	SceneWriter(out).write(scene);
+}
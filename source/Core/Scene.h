@@ -0,0 +1,62 @@
+#pragma once
+
+#include <iosfwd>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "glm/glm.hpp"
+
+#include "Core/Nurbs.h"
+
+
+// Scene description in JSON:
+//
+// {
+//   "appearance": {
+//     "background": [r, g, b, a],
+//     "points": { "common": [r, g, b, a], "accent": .., "nearby": .., "insert": .., "delete": .. },
+//     "net": [r, g, b, a],
+//     "showPoints": true,
+//     "showNet": true
+//   },
+//   "surfaces": [
+//     {
+//       "dim":     [5, 3],
+//       "degree":  [2, 2],
+//       "clamp":   [[true, true], [true, true]],  // Start & end per direction, for generated knots
+//       "knots":   [[..], [..]],                  // dim + degree + 1 values per direction
+//       "weights": [..],                          // Rational surfaces only
+//       "points":  [[x, y, z], ..]                // U changing the fastest, may also be flat
+//     }
+//   ]
+// }
+//
+// Only "dim" is required (a regular grid is made without "points"), members can come
+// in any order and unknown ones are skipped. The document is parsed by JSONReader,
+// numbers going straight into the vectors that become the surface storage
+struct Scene
+{
+	using surface_t = NURBS;
+
+	struct Appearance
+	{
+		glm::vec4 background;
+		glm::vec4 pointCommon, pointAccent, pointNearby, pointInsert, pointDelete;
+		glm::vec4 controlNet;
+		bool showPoints = true;
+		bool showNet    = true;
+	};
+
+	Appearance appearance;
+	std::vector<surface_t> surfaces;
+
+	// Surfaces are appended, appearance values present in the document replace the current ones.
+	// Throws std::runtime_error if the file can't be read or isn't valid JSON,
+	// std::invalid_argument if a surface is inconsistent (e.g. point count doesn't match the dims)
+	static void read(const std::string& path, Scene& scene);
+	static void parse(std::string_view text, Scene& scene);
+
+	// Numbers are written as the shortest text that reads back to the same value
+	static void write(const std::string& path, const Scene& scene);
+	static void write(std::ostream& out, const Scene& scene);
+};
@@ -0,0 +1,78 @@
+#include "Core/Shader.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+
+namespace
+{
+	const char* stageName(GLenum type)
+	{
+		switch (type)
+		{
+		case GL_VERTEX_SHADER:   return "vertex";
+		case GL_FRAGMENT_SHADER: return "fragment";
+		default:                 return "shader";
+		}
+	}
+}
+
+
+Shader::Shader(std::initializer_list<Stage> stages, std::initializer_list<Attribute> attributes)
+{
+	program = glCreateProgram();
+	std::vector<GLuint> shaders;
+
+	auto fail = [&](std::string what, std::string log)
+	{
+		for (GLuint shader : shaders) glDeleteShader(shader);
+		destroy();
+		throw std::runtime_error
+		("Shader::Shader: " + what + "\n" + log);
+	};
+
+	for (const Stage& stage : stages)
+	{
+		GLuint shader = glCreateShader(stage.type);
+		shaders.push_back(shader);
+		glShaderSource(shader, 1, &stage.source, nullptr);
+		glCompileShader(shader);
+
+		GLint status = 0, length = 0;
+		glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+		if (!status)
+		{
+			glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &length);
+			std::string log(size_t(std::max(length, 1)), '\0');
+			glGetShaderInfoLog(shader, GLsizei(log.size()), nullptr, log.data());
+			fail(std::string(stageName(stage.type)) + " stage failed to compile", log);
+		}
+		glAttachShader(program, shader);
+	}
+
+	for (const Attribute& attribute : attributes)
+		glBindAttribLocation(program, attribute.location, attribute.name);
+	glLinkProgram(program);
+
+	// Attached shaders are only flagged for deletion, they go away with the program
+	for (GLuint shader : shaders) glDeleteShader(shader);
+	shaders.clear();
+
+	GLint status = 0, length = 0;
+	glGetProgramiv(program, GL_LINK_STATUS, &status);
+	if (!status)
+	{
+		glGetProgramiv(program, GL_INFO_LOG_LENGTH, &length);
+		std::string log(size_t(std::max(length, 1)), '\0');
+		glGetProgramInfoLog(program, GLsizei(log.size()), nullptr, log.data());
+		fail("program failed to link", log);
+	}
+}
+
+void Shader::destroy()
+{
+	if (program) glDeleteProgram(program);
+	program = 0;
+}
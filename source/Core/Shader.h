@@ -0,0 +1,48 @@
+#pragma once
+
+#include <initializer_list>
+#include <utility>
+
+#include "Core/OpenGL.h"
+
+
+// Linked GLSL program, owns the GL object
+class Shader
+{
+	GLuint program = 0;
+
+public:
+	struct Stage
+	{
+		GLenum type;         // GL_VERTEX_SHADER, GL_FRAGMENT_SHADER, ..
+		const char* source;
+	};
+	// Vertex attribute bound to a location before linking (GLSL 1.30 has no layout qualifiers)
+	struct Attribute
+	{
+		GLuint location;
+		const char* name;
+	};
+
+	Shader() = default;
+	// Throws std::runtime_error with the info log if a stage doesn't compile or the program doesn't link
+	Shader(std::initializer_list<Stage> stages, std::initializer_list<Attribute> attributes = {});
+	inline ~Shader() { destroy(); }
+
+	Shader(const Shader&) = delete;
+	Shader& operator=(const Shader&) = delete;
+	inline Shader(Shader&& other) noexcept : program(std::exchange(other.program, 0)) {}
+	inline Shader& operator=(Shader&& other) noexcept
+	{
+		if (this != &other) { destroy(); program = std::exchange(other.program, 0); }
+		return *this;
+	}
+
+	inline bool isValid() const { return program != 0; }
+	inline GLuint getId() const { return program; }
+	inline void use() const { glUseProgram(program); }
+	inline GLint uniform(const char* name) const { return glGetUniformLocation(program, name); }
+
+private:
+	void destroy();
+};
@@ -0,0 +1,325 @@
+#include "Core/SurfaceFile.h"
+
+#include <bit>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <type_traits>
+
+// Arrays are viewed in place, so the host has to share the byte order of the format
+static_assert(std::endian::native == std::endian::little, "SurfaceFile requires a little endian host");
+
+
+void SurfaceFile::open(const std::string& path)
+{
+	close();
+	file.open(path);
+
+	auto fail = [this, &path](const char* reason)
+	{
+		close();
+		throw std::runtime_error
+		("SurfaceFile::open: " + path + ": " + reason);
+	};
+
+	if (file.getSize() < sizeof(Header))
+		fail("not a spline library.");
+
+	auto candidate = reinterpret_cast<const Header*>(file.getData());
+	if (std::memcmp(candidate->magic, MAGIC, sizeof(MAGIC)) != 0)
+		fail("not a spline library.");
+	if (candidate->version == 0 || candidate->version > VERSION)
+		fail("unsupported version.");
+	if (candidate->recordSize < sizeof(Record) || candidate->recordSize % alignof(Record) != 0 ||
+		candidate->directory % alignof(Record) != 0)
+		fail("corrupted header.");
+
+	uint64_t available = file.getSize() - std::min<uint64_t>(file.getSize(), candidate->directory);
+	if (candidate->directory > file.getSize() || candidate->splineCount > available / candidate->recordSize)
+		fail("truncated file.");
+
+	header = candidate;
+}
+
+void SurfaceFile::close()
+{
+	header = nullptr;
+	file.close();
+}
+
+const SurfaceFile::Record& SurfaceFile::getRecord(size_t i) const
+{
+	if (i >= size())
+		throw std::out_of_range
+		("SurfaceFile::getRecord: index is out of range.");
+
+	return *reinterpret_cast<const Record*>(file.getData() + header->directory + i * header->recordSize);
+}
+
+template<typename T>
+std::span<const T> SurfaceFile::array(uint64_t offset, uint64_t count) const
+{
+	if (offset == 0 || count == 0) return {};
+
+	if (offset % alignof(T) != 0 || offset > file.getSize() || count > (file.getSize() - offset) / sizeof(T))
+		throw std::runtime_error
+		("SurfaceFile::view: array is out of the file.");
+
+	return { reinterpret_cast<const T*>(file.getData() + offset), size_t(count) };
+}
+
+template<typename Scalar>
+SurfaceFile::View<Scalar> SurfaceFile::view(size_t i) const
+{
+	using limits = BasicNURBS<Scalar>;
+
+	const Record& record = getRecord(i);
+	if (bool(record.flags & DOUBLE) != std::is_same_v<Scalar, double>)
+		throw std::invalid_argument
+		("SurfaceFile::view: requested precision differs from the stored one.");
+	if (record.paramDim < 1 || record.paramDim > 3 || record.pointDim != 3)
+		throw std::runtime_error
+		("SurfaceFile::view: unsupported spline layout.");
+
+	View<Scalar> result;
+	result.record = &record;
+
+	uint64_t count = 1;
+	for (uint32_t d = 0; d < record.paramDim; d++)
+	{
+		if (record.dim[d] < limits::MIN_DIM || record.dim[d] > limits::MAX_DIM ||
+			record.degree[d] < limits::MIN_DEGREE || record.degree[d] > limits::MAX_DEGREE)
+			throw std::runtime_error
+			("SurfaceFile::view: invalid dims or degrees.");
+
+		count *= record.dim[d];
+		result.knots[d] = array<Scalar>(record.knots[d], record.dim[d] + record.degree[d] + 1);
+		if (result.knots[d].empty())
+			throw std::runtime_error
+			("SurfaceFile::view: knots are missing.");
+	}
+
+	for (int c = 0; c < 3; c++)
+	{
+		result.coordinates[c] = array<Scalar>(record.coordinates[c], count);
+		if (result.coordinates[c].empty())
+			throw std::runtime_error
+			("SurfaceFile::view: control point coordinates are missing.");
+	}
+
+	if (record.flags & RATIONAL)
+	{
+		result.weights = array<Scalar>(record.weights, count);
+		if (result.weights.empty())
+			throw std::runtime_error
+			("SurfaceFile::view: weights of a rational spline are missing.");
+	}
+
+	if (record.flags & TESSELLATION)
+	{
+		result.vertices = array<glm::vec3>(record.vertices, record.vertexCount);
+		result.normals  = array<glm::vec3>(record.normals,  record.vertexCount);
+		result.indices  = array<uint32_t>(record.indices,   record.indexCount);
+	}
+	return result;
+}
+
+void SurfaceFile::validate(size_t i) const
+{
+	if (getRecord(i).flags & DOUBLE) validate(view<double>(i));
+	else                             validate(view<float>(i));
+}
+
+template<typename Scalar>
+void SurfaceFile::validate(const View<Scalar>& view)
+{
+	// Also rejects NaNs
+	for (Scalar w : view.weights)
+		if (!(w > Scalar(0)))
+			throw std::runtime_error
+			("SurfaceFile::validate: weights have to be positive.");
+
+	for (uint32_t index : view.indices)
+		if (index >= view.vertices.size())
+			throw std::runtime_error
+			("SurfaceFile::validate: tessellation index is out of its vertices.");
+}
+
+template<typename Scalar, int ParamDim>
+BasicNURBS<Scalar, 3, ParamDim> SurfaceFile::load(size_t i) const
+{
+	const Record& record = getRecord(i);
+	if (record.paramDim != ParamDim)
+		throw std::invalid_argument
+		("SurfaceFile::load: spline has a different number of parametric directions.");
+
+	if (record.flags & DOUBLE)
+	{
+		View<double> stored = view<double>(i);
+		validate(stored);
+		return load<double, Scalar, ParamDim>(stored);
+	}
+	View<float> stored = view<float>(i);
+	validate(stored);
+	return load<float, Scalar, ParamDim>(stored);
+}
+
+template<typename Stored, typename Scalar, int ParamDim>
+BasicNURBS<Scalar, 3, ParamDim> SurfaceFile::load(const View<Stored>& view) const
+{
+	using spline_t = BasicNURBS<Scalar, 3, ParamDim>;
+	const Record& record = *view.record;
+
+	typename spline_t::index_t dims;
+	for (int d = 0; d < ParamDim; d++) dims[d] = size_t(record.dim[d]);
+	spline_t spline(dims);
+
+	for (int d = 0; d < ParamDim; d++)
+	{
+		auto dir = typename spline_t::Dim(d);
+		if (record.degree[d] > spline.getMaxDegree(dir))
+			throw std::runtime_error
+			("SurfaceFile::load: degree is too high for the number of control points.");
+
+		spline.setDegree(dir, size_t(record.degree[d]));
+		spline.setKnots(dir, std::vector<Scalar>(view.knots[d].begin(), view.knots[d].end()));
+		spline.clampKnots[d][spline_t::START] = record.clampKnots[d][0] != 0;
+		spline.clampKnots[d][spline_t::END]   = record.clampKnots[d][1] != 0;
+	}
+
+	for (size_t i = 0; i < spline.controlPoints.size(); i++)
+		for (int c = 0; c < 3; c++)
+			spline.controlPoints[i][c] = Scalar(view.coordinates[c][i]);
+	spline.weights.assign(view.weights.begin(), view.weights.end());
+	spline.invalidate();
+
+	return spline;
+}
+
+template<typename Scalar, int ParamDim>
+void SurfaceFile::write(const std::string& path, const std::vector<const BasicNURBS<Scalar, 3, ParamDim>*>& splines,
+	const std::vector<const Mesh*>& tessellations)
+{
+	if (!tessellations.empty() && tessellations.size() != splines.size())
+		throw std::invalid_argument
+		("SurfaceFile::write: tessellations don't match the splines.");
+
+	// The same checks as validate, so a written library passes them
+	for (size_t s = 0; s < splines.size(); s++)
+	{
+		for (Scalar w : splines[s]->weights)
+			if (!(w > Scalar(0)))
+				throw std::invalid_argument
+				("SurfaceFile::write: weights have to be positive.");
+
+		const Mesh* mesh = tessellations.empty() ? nullptr : tessellations[s];
+		if (mesh)
+			for (uint32_t index : mesh->indices)
+				if (index >= mesh->vertices.size())
+					throw std::invalid_argument
+					("SurfaceFile::write: tessellation index is out of its vertices.");
+	}
+
+	std::ofstream out(path, std::ios::binary | std::ios::trunc);
+	if (!out)
+		throw std::runtime_error
+		("SurfaceFile::write: can't create " + path);
+
+	uint64_t offset = 0;
+	auto put = [&out, &offset](const void* data, uint64_t bytes)
+	{
+		out.write(static_cast<const char*>(data), std::streamsize(bytes));
+		offset += bytes;
+	};
+	auto align = [&put, &offset]()
+	{
+		static const char zeros[ALIGNMENT] = {};
+		put(zeros, (ALIGNMENT - offset % ALIGNMENT) % ALIGNMENT);
+	};
+	// Returns the offset of the array, 0 for an empty one
+	auto putArray = [&put, &align, &offset](const void* data, uint64_t bytes) -> uint64_t
+	{
+		if (bytes == 0) return 0;
+		align();
+		uint64_t start = offset;
+		put(data, bytes);
+		return start;
+	};
+
+	Header header = {};
+	std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+	header.version     = VERSION;
+	header.recordSize  = sizeof(Record);
+	header.splineCount = splines.size();
+	put(&header, sizeof(header));
+
+	std::vector<Record> records(splines.size());
+	std::vector<Scalar> coordinate;
+	for (size_t s = 0; s < splines.size(); s++)
+	{
+		const auto& spline = *splines[s];
+		Record& record = records[s];
+
+		record.flags    = (std::is_same_v<Scalar, double> ? DOUBLE : 0) | (spline.isRational() ? RATIONAL : 0);
+		record.paramDim = ParamDim;
+		record.pointDim = 3;
+
+		for (int d = 0; d < ParamDim; d++)
+		{
+			record.dim[d]    = spline.dim[d];
+			record.degree[d] = spline.degree[d];
+			record.clampKnots[d][0] = spline.clampKnots[d][0];
+			record.clampKnots[d][1] = spline.clampKnots[d][1];
+			record.knots[d] = putArray(spline.knots[d].data(), spline.knots[d].size() * sizeof(Scalar));
+		}
+		record.weights = putArray(spline.weights.data(), spline.weights.size() * sizeof(Scalar));
+
+		coordinate.resize(spline.controlPoints.size());
+		for (int c = 0; c < 3; c++)
+		{
+			for (size_t i = 0; i < coordinate.size(); i++)
+				coordinate[i] = spline.controlPoints[i][c];
+			record.coordinates[c] = putArray(coordinate.data(), coordinate.size() * sizeof(Scalar));
+		}
+
+		const Mesh* mesh = tessellations.empty() ? nullptr : tessellations[s];
+		if (mesh && !mesh->vertices.empty())
+		{
+			record.flags      |= TESSELLATION;
+			record.vertexCount = mesh->vertices.size();
+			record.indexCount  = mesh->indices.size();
+			record.vertices    = putArray(mesh->vertices.data(), mesh->vertices.size() * sizeof(glm::vec3));
+			if (mesh->normals.size() == mesh->vertices.size())
+				record.normals = putArray(mesh->normals.data(), mesh->normals.size() * sizeof(glm::vec3));
+			record.indices     = putArray(mesh->indices.data(), mesh->indices.size() * sizeof(uint32_t));
+		}
+	}
+
+	align();
+	header.directory = offset;
+	put(records.data(), records.size() * sizeof(Record));
+
+	out.seekp(0);
+	out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	if (!out)
+		throw std::runtime_error
+		("SurfaceFile::write: failed to write " + path);
+}
+
+
+#define SURFACE_FILE_INSTANTIATE(Scalar, ParamDim) \
+	template BasicNURBS<Scalar, 3, ParamDim> SurfaceFile::load<Scalar, ParamDim>(size_t) const; \
+	template void SurfaceFile::write<Scalar, ParamDim>(const std::string&, \
+		const std::vector<const BasicNURBS<Scalar, 3, ParamDim>*>&, const std::vector<const Mesh*>&);
+
+template SurfaceFile::View<float>  SurfaceFile::view<float>(size_t) const;
+template SurfaceFile::View<double> SurfaceFile::view<double>(size_t) const;
+
+SURFACE_FILE_INSTANTIATE(float,  1)
+SURFACE_FILE_INSTANTIATE(float,  2)
+SURFACE_FILE_INSTANTIATE(float,  3)
+SURFACE_FILE_INSTANTIATE(double, 1)
+SURFACE_FILE_INSTANTIATE(double, 2)
+SURFACE_FILE_INSTANTIATE(double, 3)
+
+#undef SURFACE_FILE_INSTANTIATE
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+#include "glm/glm.hpp"
+
+#include "Core/MappedFile.h"
+#include "Core/Mesh.h"
+#include "Core/Nurbs.h"
+
+
+// Binary library of splines (.cwn), little endian:
+//
+//   Header | arrays of spline 0 | arrays of spline 1 | ... | Record[splineCount]
+//
+// A record holds the layout of one spline (degrees, dims, clamp flags) and the offsets
+// of its arrays: knots per direction, weights, one array per control point coordinate
+// and an optional cached tessellation. Every array starts at a multiple of ALIGNMENT.
+//
+// Opening only maps the file and checks the header, arrays are viewed in place,
+// so the cost doesn't depend on the size of the library. The values of the arrays are only
+// checked by validate (and load, which reads them all anyway)
+class SurfaceFile
+{
+public:
+	static constexpr char MAGIC[8] = { 'C', 'W', 'N', 'U', 'R', 'B', 'S', '\x1A' };
+	static const uint32_t VERSION   = 1;
+	static const uint64_t ALIGNMENT = 64;
+
+	enum Flags : uint32_t
+	{
+		DOUBLE       = 1 << 0,  // Knots, weights & coordinates are doubles (floats otherwise)
+		RATIONAL     = 1 << 1,
+		TESSELLATION = 1 << 2
+	};
+
+	struct Header
+	{
+		char     magic[8];
+		uint32_t version;
+		uint32_t recordSize;    // Size of a record, newer versions may append fields
+		uint64_t splineCount;
+		uint64_t directory;     // Offset of the records
+	};
+
+	struct Record
+	{
+		uint32_t flags;
+		uint32_t paramDim;
+		uint32_t pointDim;
+		uint8_t  clampKnots[3][2];
+		uint8_t  padding[6];
+		uint64_t dim[3];
+		uint64_t degree[3];
+
+		// Offsets from the start of the file, 0 for absent arrays
+		uint64_t knots[3];
+		uint64_t weights;
+		uint64_t coordinates[3];
+
+		uint64_t vertexCount;
+		uint64_t indexCount;
+		uint64_t vertices;      // glm::vec3
+		uint64_t normals;       // glm::vec3
+		uint64_t indices;       // uint32_t
+	};
+
+	// Arrays of one spline, pointing straight into the mapped file
+	template<typename Scalar>
+	struct View
+	{
+		const Record* record = nullptr;
+
+		std::span<const Scalar> knots[3];
+		std::span<const Scalar> weights;
+		std::span<const Scalar> coordinates[3];
+
+		std::span<const glm::vec3> vertices;
+		std::span<const glm::vec3> normals;
+		std::span<const uint32_t>  indices;
+	};
+
+private:
+	MappedFile file;
+	const Header* header = nullptr;
+
+public:
+	SurfaceFile() = default;
+	inline explicit SurfaceFile(const std::string& path) { open(path); }
+
+	// Throws std::runtime_error if the file isn't a spline library of a supported version
+	void open(const std::string& path);
+	void close();
+	inline bool isOpen() const { return header != nullptr; }
+
+	inline size_t size() const { return header ? size_t(header->splineCount) : 0; }
+	const Record& getRecord(size_t i) const;
+
+	// Scalar has to match the stored precision, every access checks the record it uses without
+	// reading the arrays: throws std::runtime_error if an array is missing or out of the file
+	template<typename Scalar>
+	View<Scalar> view(size_t i) const;
+	// Reads the arrays of a spline: throws std::runtime_error if a weight isn't positive
+	// or an index of the tessellation is out of its vertices
+	void validate(size_t i) const;
+
+	// Editable copy of a spline, converted to the requested precision, validated
+	template<typename Scalar, int ParamDim>
+	BasicNURBS<Scalar, 3, ParamDim> load(size_t i) const;
+
+	// 'tessellations' is either empty or holds a mesh (or nullptr) per spline
+	template<typename Scalar, int ParamDim>
+	static void write(const std::string& path, const std::vector<const BasicNURBS<Scalar, 3, ParamDim>*>& splines,
+		const std::vector<const Mesh*>& tessellations = {});
+
+private:
+	template<typename T>
+	std::span<const T> array(uint64_t offset, uint64_t count) const;
+
+	template<typename Scalar>
+	static void validate(const View<Scalar>& view);
+
+	template<typename Stored, typename Scalar, int ParamDim>
+	BasicNURBS<Scalar, 3, ParamDim> load(const View<Stored>& view) const;
+};
+
+static_assert(sizeof(SurfaceFile::Header) == 32,  "SurfaceFile::Header layout is part of the format");
+static_assert(sizeof(SurfaceFile::Record) == 168, "SurfaceFile::Record layout is part of the format");
@@ -0,0 +1,698 @@
+#include "Core/SurfaceRenderer.h"
+
+#include <cstring>
+#include <stdexcept>
+
+#include "glm/gtc/type_ptr.hpp"
+
+
+namespace
+{
+	// Attribute locations shared by all programs
+	enum Attribute : GLuint { POSITION, NORMAL, STATE };
+
+	const char* SURFACE_VERTEX = R"(#version 130
+		uniform mat4 projection;
+		uniform mat4 view;
+
+		in vec3 position;
+		in vec3 normal;
+		out vec3 eyeNormal;
+
+		void main()
+		{
+			// The view is a rigid motion, its upper 3x3 part transforms normals as well
+			eyeNormal   = mat3(view) * normal;
+			gl_Position = projection * view * vec4(position, 1.0);
+		}
+	)";
+
+	// Lighting of the legacy path: fixed function light 0 (white, directional along the view axis,
+	// so the half vector is the view axis too) and the material set up for GLU
+	const char* SURFACE_FRAGMENT = R"(#version 130
+		const float AMBIENT   = 0.2 * 0.2;
+		const float DIFFUSE   = 0.9;
+		const float SPECULAR  = 1.0;
+		const float SHININESS = 100.0;
+
+		in vec3 eyeNormal;
+		out vec4 color;
+
+		void main()
+		{
+			float lambert  = max(normalize(eyeNormal).z, 0.0);
+			float specular = (lambert > 0.0) ? SPECULAR * pow(lambert, SHININESS) : 0.0;
+			color = vec4(vec3(AMBIENT + DIFFUSE * lambert + specular), 1.0);
+		}
+	)";
+
+	const char* POINT_VERTEX = R"(#version 130
+		uniform mat4 projection;
+		uniform mat4 view;
+		uniform vec4 palette[5];
+
+		in vec3 position;
+		in uint state;
+		flat out vec4 pointColor;
+
+		void main()
+		{
+			pointColor  = palette[min(state, 4u)];
+			gl_Position = projection * view * vec4(position, 1.0);
+		}
+	)";
+
+	const char* NET_VERTEX = R"(#version 130
+		uniform mat4 projection;
+		uniform mat4 view;
+		uniform vec4 color;
+
+		in vec3 position;
+		flat out vec4 pointColor;
+
+		void main()
+		{
+			pointColor  = color;
+			gl_Position = projection * view * vec4(position, 1.0);
+		}
+	)";
+
+	const char* POINT_FRAGMENT = R"(#version 130
+		flat in vec4 pointColor;
+		out vec4 color;
+
+		void main() { color = pointColor; }
+	)";
+
+	// GPU tessellation: one patch of a single vertex per Bezier patch, the vertex index is
+	// the patch index (gl_PrimitiveID would restart with every draw, see patchesPerDraw).
+	// Points of the patch are read from the buffer texture at patch * (p+1)(q+1)
+	const char* PATCH_VERTEX = R"(#version 400
+		out int vertexPatch;
+
+		void main() { vertexPatch = gl_VertexID; }
+	)";
+
+	const char* PATCH_CONTROL = R"(#version 400
+		layout(vertices = 1) out;
+
+		in int vertexPatch[];
+		patch out int patchIndex;
+
+		uniform samplerBuffer points;
+		uniform ivec2 degree;
+		uniform mat4 projection;
+		uniform mat4 view;
+		uniform vec2 viewport;
+		uniform float edgePixels;
+		uniform float maxLevel;
+
+		vec4 clipPoint(int i, int j)
+		{
+			vec4 point = texelFetch(points, vertexPatch[0] * (degree.x + 1) * (degree.y + 1) + j * (degree.x + 1) + i);
+			return projection * view * vec4(point.xyz / point.w, 1.0);
+		}
+
+		vec2 pixels(vec4 clip) { return clip.xy / max(clip.w, 1e-3) * 0.5 * viewport; }
+
+		// Level of the edge made of the points (i, j) + k * step, k = 0..n, which is traversed
+		// in the same direction by both patches sharing it
+		float edgeLevel(int i, int j, ivec2 step, int n)
+		{
+			float length = 0.0;
+			vec2 a = pixels(clipPoint(i, j));
+			for (int k = 1; k <= n; k++)
+			{
+				vec2 b = pixels(clipPoint(i + k * step.x, j + k * step.y));
+				length += distance(a, b);
+				a = b;
+			}
+			return clamp(ceil(length / edgePixels), 1.0, maxLevel);
+		}
+
+		void main()
+		{
+			int p = degree.x, q = degree.y;
+			patchIndex = vertexPatch[0];
+
+			// The patch is inside the convex hull of its points, which is outside the view
+			// if all of them are outside the same clip plane. The longest row & column of the net
+			// (whose bulges the edges don't see) decide the inner levels
+			ivec3 below = ivec3(0), above = ivec3(0);
+			float rowLength = 0.0, columnLength[8];
+			vec2 previousRow[8];
+			for (int j = 0; j <= q; j++)
+			{
+				float length = 0.0;
+				vec2 previous;
+				for (int i = 0; i <= p; i++)
+				{
+					vec4 clip = clipPoint(i, j);
+					below += ivec3(lessThan(clip.xyz, vec3(-clip.w)));
+					above += ivec3(greaterThan(clip.xyz, vec3(clip.w)));
+
+					vec2 point = pixels(clip);
+					if (i > 0) length += distance(previous, point);
+					columnLength[i] = (j > 0) ? columnLength[i] + distance(previousRow[i], point) : 0.0;
+					previous = previousRow[i] = point;
+				}
+				rowLength = max(rowLength, length);
+			}
+			int count = (p + 1) * (q + 1);
+			if (any(equal(below, ivec3(count))) || any(equal(above, ivec3(count))))
+			{
+				gl_TessLevelOuter[0] = gl_TessLevelOuter[1] = gl_TessLevelOuter[2] = gl_TessLevelOuter[3] = 0.0;
+				gl_TessLevelInner[0] = gl_TessLevelInner[1] = 0.0;
+				return;
+			}
+
+			// Edges u = 0, v = 0, u = 1 & v = 1
+			float u0 = edgeLevel(0, 0, ivec2(0, 1), q), v0 = edgeLevel(0, 0, ivec2(1, 0), p);
+			float u1 = edgeLevel(p, 0, ivec2(0, 1), q), v1 = edgeLevel(0, q, ivec2(1, 0), p);
+			gl_TessLevelOuter[0] = u0; gl_TessLevelOuter[1] = v0;
+			gl_TessLevelOuter[2] = u1; gl_TessLevelOuter[3] = v1;
+			float longestColumn = 0.0;
+			for (int i = 0; i <= p; i++) longestColumn = max(longestColumn, columnLength[i]);
+			gl_TessLevelInner[0] = clamp(ceil(rowLength / edgePixels), max(v0, v1), maxLevel);
+			gl_TessLevelInner[1] = clamp(ceil(longestColumn / edgePixels), max(u0, u1), maxLevel);
+		}
+	)";
+
+	const char* PATCH_EVALUATION = R"(#version 400
+		layout(quads, equal_spacing, ccw) in;
+
+		patch in int patchIndex;
+
+		uniform samplerBuffer points;
+		uniform ivec2 degree;
+		uniform mat4 projection;
+		uniform mat4 view;
+		out vec3 eyeNormal;
+
+		// Bernstein polynomials of degree n at t & their derivatives
+		void bernstein(int n, float t, out float B[8], out float D[8])
+		{
+			// Degree n-1 first, the derivatives are n * (B[k-1] - B[k]) of those
+			B[0] = 1.0;
+			for (int j = 1; j <= n; j++)
+			{
+				if (j == n)
+					for (int k = 0; k <= n; k++)
+						D[k] = float(n) * ((k > 0 ? B[k-1] : 0.0) - (k < n ? B[k] : 0.0));
+
+				float saved = 0.0;
+				for (int k = 0; k < j; k++)
+				{
+					float b = B[k];
+					B[k]  = saved + (1.0 - t) * b;
+					saved = t * b;
+				}
+				B[j] = saved;
+			}
+		}
+
+		void evaluate(vec2 t, out vec3 position, out vec3 normal)
+		{
+			int p = degree.x, q = degree.y;
+			float Bu[8], Du[8], Bv[8], Dv[8];
+			bernstein(p, t.x, Bu, Du);
+			bernstein(q, t.y, Bv, Dv);
+
+			int first = patchIndex * (p + 1) * (q + 1);
+			vec4 S = vec4(0.0), Su = vec4(0.0), Sv = vec4(0.0);
+			for (int j = 0; j <= q; j++)
+			{
+				vec4 row = vec4(0.0), rowU = vec4(0.0);
+				for (int i = 0; i <= p; i++)
+				{
+					vec4 point = texelFetch(points, first + j * (p + 1) + i);
+					row  += Bu[i] * point;
+					rowU += Du[i] * point;
+				}
+				S  += Bv[j] * row;
+				Su += Bv[j] * rowU;
+				Sv += Dv[j] * row;
+			}
+
+			// Quotient rule of the weighted points
+			position = S.xyz / S.w;
+			normal = cross(Su.xyz - position * Su.w, Sv.xyz - position * Sv.w);
+		}
+
+		void main()
+		{
+			vec3 position, normal, inner;
+			evaluate(gl_TessCoord.xy, position, normal);
+			// Collapsed edges (poles) have no tangent plane, the one slightly inside is taken
+			if (dot(normal, normal) < 1e-20)
+				evaluate(mix(gl_TessCoord.xy, vec2(0.5), 1e-3), inner, normal);
+
+			eyeNormal   = mat3(view) * normal;
+			gl_Position = projection * view * vec4(position, 1.0);
+		}
+	)";
+
+	// Positions & states of a point array in 'vertexArray'
+	void setPointLayout(GLuint vertexArray, GLuint positions, GLuint states)
+	{
+		glBindVertexArray(vertexArray);
+		glBindBuffer(GL_ARRAY_BUFFER, positions);
+		glEnableVertexAttribArray(POSITION);
+		glVertexAttribPointer(POSITION, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), nullptr);
+		glBindBuffer(GL_ARRAY_BUFFER, states);
+		glEnableVertexAttribArray(STATE);
+		glVertexAttribIPointer(STATE, 1, GL_UNSIGNED_BYTE, 1, nullptr);
+		glBindVertexArray(0);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+}
+
+
+SurfaceRenderer::~SurfaceRenderer()
+{
+	destroy();
+}
+
+void SurfaceRenderer::destroy()
+{
+	if (!isReady()) return;
+
+	GLuint arrays[]  = { surfaceArray, pointArray, extraArray, netArray };
+	GLuint buffers[] = { surfaceBuffer, indexBuffer, pointBuffer, stateBuffer, extraBuffer, extraStateBuffer, netIndexBuffer };
+	glDeleteVertexArrays(4, arrays);
+	glDeleteBuffers(7, buffers);
+	surfaceArray = pointArray = extraArray = netArray = 0;
+	surfaceBuffer = indexBuffer = pointBuffer = stateBuffer = extraBuffer = extraStateBuffer = netIndexBuffer = 0;
+
+	if (hasGPUTessellation())
+	{
+		glDeleteVertexArrays(1, &patchArray);
+		glDeleteBuffers(1, &patchBuffer);
+		glDeleteTextures(1, &patchTexture);
+		patchArray = patchBuffer = patchTexture = 0;
+	}
+
+	surfaceShader = Shader(); pointShader = Shader(); netShader = Shader(); patchShader = Shader();
+	ring.destroy();
+	invalidate();
+}
+
+void SurfaceRenderer::init()
+{
+	surfaceShader = Shader({ { GL_VERTEX_SHADER, SURFACE_VERTEX }, { GL_FRAGMENT_SHADER, SURFACE_FRAGMENT } },
+		{ { POSITION, "position" }, { NORMAL, "normal" } });
+	pointShader = Shader({ { GL_VERTEX_SHADER, POINT_VERTEX }, { GL_FRAGMENT_SHADER, POINT_FRAGMENT } },
+		{ { POSITION, "position" }, { STATE, "state" } });
+	netShader = Shader({ { GL_VERTEX_SHADER, NET_VERTEX }, { GL_FRAGMENT_SHADER, POINT_FRAGMENT } },
+		{ { POSITION, "position" } });
+
+	surfaceProjection = surfaceShader.uniform("projection");
+	surfaceView       = surfaceShader.uniform("view");
+	pointProjection   = pointShader.uniform("projection");
+	pointView         = pointShader.uniform("view");
+	pointPalette      = pointShader.uniform("palette");
+	netProjection     = netShader.uniform("projection");
+	netView           = netShader.uniform("view");
+	netColor          = netShader.uniform("color");
+
+	GLuint arrays[4], buffers[7];
+	glGenVertexArrays(4, arrays);
+	glGenBuffers(7, buffers);
+	surfaceArray = arrays[0]; pointArray = arrays[1]; extraArray = arrays[2]; netArray = arrays[3];
+	surfaceBuffer = buffers[0]; indexBuffer = buffers[1];
+	pointBuffer   = buffers[2]; stateBuffer = buffers[3];
+	extraBuffer   = buffers[4]; extraStateBuffer = buffers[5];
+	netIndexBuffer = buffers[6];
+
+	// The index buffer binding is part of the vertex array state
+	glBindVertexArray(surfaceArray);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+	glBindVertexArray(0);
+
+	setPointLayout(pointArray, pointBuffer, stateBuffer);
+	setPointLayout(extraArray, extraBuffer, extraStateBuffer);
+
+	// Same positions as the points, connected by the indices of updateNet
+	glBindVertexArray(netArray);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, netIndexBuffer);
+	glBindBuffer(GL_ARRAY_BUFFER, pointBuffer);
+	glEnableVertexAttribArray(POSITION);
+	glVertexAttribPointer(POSITION, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), nullptr);
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	netIndexCount = 0;
+	std::fill(std::begin(netDim), std::end(netDim), 0);
+
+	initPatches();
+
+	streaming = RingBuffer::isSupported();
+	capacity = 0;
+	invalidate();
+}
+
+void SurfaceRenderer::initPatches()
+{
+	if (GL::version() < 40 || !glPatchParameteri || !glTexBuffer || !glActiveTexture) return;
+
+	// Optional, so a driver that can't build the stages just leaves the mesh path
+	try
+	{
+		patchShader = Shader({ { GL_VERTEX_SHADER, PATCH_VERTEX }, { GL_TESS_CONTROL_SHADER, PATCH_CONTROL },
+			{ GL_TESS_EVALUATION_SHADER, PATCH_EVALUATION }, { GL_FRAGMENT_SHADER, SURFACE_FRAGMENT } });
+	}
+	catch (const std::runtime_error&) { return; }
+
+	patchProjection = patchShader.uniform("projection");
+	patchView       = patchShader.uniform("view");
+	patchDegree     = patchShader.uniform("degree");
+	patchViewport   = patchShader.uniform("viewport");
+	patchEdgePixels = patchShader.uniform("edgePixels");
+
+	GLint maxLevel = 64;
+	glGetIntegerv(GL_MAX_TESS_GEN_LEVEL, &maxLevel);
+	patchShader.use();
+	glUniform1i(patchShader.uniform("points"), 0);
+	glUniform1f(patchShader.uniform("maxLevel"), float(maxLevel));
+	glUseProgram(0);
+
+	// llvmpipe indexes the vertices a draw tessellates into with 16 bits, more of them
+	// come out as stray triangles, so a draw there has at most as many patches as surely fit.
+	// Other drivers draw the whole surface at once
+	const char* renderer = reinterpret_cast<const char*>(glGetString(GL_RENDERER));
+	if (renderer && std::strstr(renderer, "llvmpipe"))
+		patchesPerDraw = std::max<size_t>(1, 65536 / ((maxLevel + 1) * (maxLevel + 1)));
+	else patchesPerDraw = ALL_PATCHES;
+
+	glGenVertexArrays(1, &patchArray);
+	glGenBuffers(1, &patchBuffer);
+	glGenTextures(1, &patchTexture);
+	glBindBuffer(GL_TEXTURE_BUFFER, patchBuffer);
+	glBindTexture(GL_TEXTURE_BUFFER, patchTexture);
+	glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, patchBuffer);
+	glBindTexture(GL_TEXTURE_BUFFER, 0);
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+void SurfaceRenderer::setGPUTessellation(bool enabled)
+{
+	enabled = enabled && hasGPUTessellation();
+	if (enabled == gpuTessellation) return;
+
+	gpuTessellation = enabled;
+	invalidate();
+}
+
+
+void SurfaceRenderer::update(const NURBS& surface)
+{
+	if (surface.getRevision() == revision) return;
+	revision = surface.getRevision();
+
+	if (gpuTessellation) updatePatches(surface);
+	else                 updateMesh(surface);
+
+	glBindBuffer(GL_ARRAY_BUFFER, pointBuffer);
+	glBufferData(GL_ARRAY_BUFFER, GLsizeiptr(surface.controlPoints.size() * sizeof(glm::vec3)),
+		surface.controlPoints.data(), GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	updateNet(surface);
+
+	// The states no longer match the points if their number changed
+	if (pointCount != surface.controlPoints.size()) states.clear();
+	pointCount = surface.controlPoints.size();
+}
+
+void SurfaceRenderer::updateMesh(const NURBS& surface)
+{
+	Tessellator::tessellate(surface, mesh, segments);
+	reserveVertices(mesh.vertices.size());
+	markDirty(0, mesh.vertices.size());
+
+	glBindVertexArray(surfaceArray);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, GLsizeiptr(mesh.indices.size() * sizeof(uint32_t)), mesh.indices.data(), GL_STATIC_DRAW);
+	glBindVertexArray(0);
+
+	indexCount = mesh.indices.size();
+	statistics.tessellations++;
+	statistics.triangles = mesh.triangleCount();
+	statistics.patches   = 0;
+}
+
+void SurfaceRenderer::updatePatches(const NURBS& surface)
+{
+	BezierPatches::extract(surface, patches);
+
+	glBindBuffer(GL_TEXTURE_BUFFER, patchBuffer);
+	glBufferData(GL_TEXTURE_BUFFER, GLsizeiptr(patches.points.size() * sizeof(glm::vec4)), patches.points.data(), GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+	statistics.triangles = 0;
+	statistics.patches   = patches.patchCount();
+}
+
+void SurfaceRenderer::controlPointMoved(const NURBS& surface, size_t i)
+{
+	// Only valid when the move is the single edit since the last sync.
+	// Patches are extracted anew by update, which is about as fast as finding the changed ones
+	if (revision == NO_REVISION || revision + 1 != surface.getRevision() || gpuTessellation) return;
+	revision = surface.getRevision();
+
+	auto [first, last] = Tessellator::retessellate(surface, mesh, surface.controlPointPatches(i), segments);
+	markDirty(first, last);
+
+	glBindBuffer(GL_ARRAY_BUFFER, pointBuffer);
+	glBufferSubData(GL_ARRAY_BUFFER, GLintptr(i * sizeof(glm::vec3)), sizeof(glm::vec3), &surface.controlPoints[i]);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	statistics.partialUpdates++;
+}
+
+
+void SurfaceRenderer::reserveVertices(size_t count)
+{
+	if (count <= capacity) return;
+
+	// Grows geometrically, so inserting layers one by one doesn't reallocate every time
+	capacity = std::max(count, capacity + capacity / 2);
+	size_t bytes = capacity * sizeof(glm::vec3) * 2;
+
+	if (streaming)
+	{
+		ring.create(bytes);
+		region = 0;
+	}
+	else
+	{
+		glBindBuffer(GL_ARRAY_BUFFER, surfaceBuffer);
+		glBufferData(GL_ARRAY_BUFFER, GLsizeiptr(bytes), nullptr, GL_DYNAMIC_DRAW);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		setSurfaceLayout(surfaceBuffer, 0);
+	}
+}
+
+void SurfaceRenderer::markDirty(size_t first, size_t last)
+{
+	for (size_t r = 0; r < (streaming ? RingBuffer::REGIONS : 1); r++)
+		dirty[r].add(first, last);
+}
+
+void SurfaceRenderer::syncVertices()
+{
+	const size_t VERTEX = sizeof(glm::vec3);
+
+	if (!streaming)
+	{
+		Range& range = dirty[0];
+		if (range.empty()) return;
+
+		size_t bytes = (range.last - range.first) * VERTEX;
+		glBindBuffer(GL_ARRAY_BUFFER, surfaceBuffer);
+		glBufferSubData(GL_ARRAY_BUFFER, GLintptr(range.first * VERTEX), GLsizeiptr(bytes), &mesh.vertices[range.first]);
+		glBufferSubData(GL_ARRAY_BUFFER, GLintptr((capacity + range.first) * VERTEX), GLsizeiptr(bytes), &mesh.normals[range.first]);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+		statistics.vertexBytes += bytes * 2;
+		range = {};
+		return;
+	}
+
+	// The region drawn last is current, the next one is written only when the mesh changed
+	if (dirty[region].empty()) return;
+	region = (region + 1) % RingBuffer::REGIONS;
+
+	std::byte* memory = ring.acquire(region);
+	Range& range = dirty[region];
+	if (!range.empty())
+	{
+		size_t bytes = (range.last - range.first) * VERTEX;
+		std::memcpy(memory + range.first * VERTEX, &mesh.vertices[range.first], bytes);
+		std::memcpy(memory + (capacity + range.first) * VERTEX, &mesh.normals[range.first], bytes);
+
+		statistics.vertexBytes += bytes * 2;
+		range = {};
+	}
+	setSurfaceLayout(ring.getId(), ring.offset(region));
+}
+
+void SurfaceRenderer::setSurfaceLayout(GLuint buffer, size_t offset)
+{
+	glBindVertexArray(surfaceArray);
+	glBindBuffer(GL_ARRAY_BUFFER, buffer);
+	glEnableVertexAttribArray(POSITION);
+	glVertexAttribPointer(POSITION, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), reinterpret_cast<const void*>(offset));
+	glEnableVertexAttribArray(NORMAL);
+	glVertexAttribPointer(NORMAL, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3),
+		reinterpret_cast<const void*>(offset + capacity * sizeof(glm::vec3)));
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void SurfaceRenderer::updateNet(const NURBS& surface)
+{
+	if (std::equal(std::begin(netDim), std::end(netDim), surface.dim)) return;
+	std::copy(std::begin(surface.dim), std::end(surface.dim), netDim);
+
+	// A segment to the next point along every direction that has one
+	std::vector<uint32_t> indices;
+	for (size_t i = 0; i < surface.controlPoints.size(); i++)
+		for (int d = 0; d < NURBS::PARAM_DIM; d++)
+		{
+			NURBS::Dim dim = NURBS::Dim(d);
+			if (surface.index2uv(i, dim) + 1 == surface.dim[d]) continue;
+			indices.push_back(uint32_t(i));
+			indices.push_back(uint32_t(i + surface.stride(dim)));
+		}
+
+	glBindVertexArray(netArray);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, GLsizeiptr(indices.size() * sizeof(uint32_t)), indices.data(), GL_STATIC_DRAW);
+	glBindVertexArray(0);
+	netIndexCount = indices.size();
+}
+
+void SurfaceRenderer::setPointStates(const std::vector<uint8_t>& newStates)
+{
+	if (newStates == states) return;
+
+	// Same count (a selection change): the bytes are rewritten in place
+	glBindBuffer(GL_ARRAY_BUFFER, stateBuffer);
+	if (newStates.size() == states.size())
+		glBufferSubData(GL_ARRAY_BUFFER, 0, GLsizeiptr(newStates.size()), newStates.data());
+	else
+		glBufferData(GL_ARRAY_BUFFER, GLsizeiptr(newStates.size()), newStates.data(), GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	states = newStates;
+	statistics.stateUploads++;
+}
+
+
+void SurfaceRenderer::drawSurface(const Camera& camera)
+{
+	if (gpuTessellation)
+	{
+		drawPatches(camera);
+		return;
+	}
+	if (indexCount == 0) return;
+	syncVertices();
+
+	glEnable(GL_DEPTH_TEST);
+
+	surfaceShader.use();
+	glUniformMatrix4fv(surfaceProjection, 1, GL_FALSE, glm::value_ptr(camera.projection));
+	glUniformMatrix4fv(surfaceView,       1, GL_FALSE, glm::value_ptr(camera.view));
+
+	glBindVertexArray(surfaceArray);
+	glDrawElements(GL_TRIANGLES, GLsizei(indexCount), GL_UNSIGNED_INT, nullptr);
+	glBindVertexArray(0);
+	glUseProgram(0);
+
+	if (streaming) ring.fence(region);
+}
+
+void SurfaceRenderer::drawPatches(const Camera& camera)
+{
+	if (patches.patchCount() == 0) return;
+
+	glEnable(GL_DEPTH_TEST);
+
+	patchShader.use();
+	glUniformMatrix4fv(patchProjection, 1, GL_FALSE, glm::value_ptr(camera.projection));
+	glUniformMatrix4fv(patchView,       1, GL_FALSE, glm::value_ptr(camera.view));
+	glUniform2i(patchDegree, GLint(patches.degree[0]), GLint(patches.degree[1]));
+	glUniform2f(patchViewport, camera.viewport.z, camera.viewport.w);
+	glUniform1f(patchEdgePixels, std::max(edgePixels, 1.f));
+
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_BUFFER, patchTexture);
+	glPatchParameteri(GL_PATCH_VERTICES, 1);
+
+	glBindVertexArray(patchArray);
+	size_t perDraw = std::min(patchesPerDraw, patches.patchCount());
+	for (size_t first = 0; first < patches.patchCount(); first += perDraw)
+		glDrawArrays(GL_PATCHES, GLint(first), GLsizei(std::min(perDraw, patches.patchCount() - first)));
+	glBindVertexArray(0);
+	glBindTexture(GL_TEXTURE_BUFFER, 0);
+	glUseProgram(0);
+}
+
+void SurfaceRenderer::drawNet(const Camera& camera, const glm::vec4& color) const
+{
+	if (netIndexCount == 0) return;
+
+	glEnable(GL_DEPTH_TEST);
+	netShader.use();
+	glUniformMatrix4fv(netProjection, 1, GL_FALSE, glm::value_ptr(camera.projection));
+	glUniformMatrix4fv(netView,       1, GL_FALSE, glm::value_ptr(camera.view));
+	glUniform4fv(netColor, 1, glm::value_ptr(color));
+
+	glBindVertexArray(netArray);
+	glDrawElements(GL_LINES, GLsizei(netIndexCount), GL_UNSIGNED_INT, nullptr);
+	glBindVertexArray(0);
+	glUseProgram(0);
+}
+
+void SurfaceRenderer::usePointShader(const Camera& camera, const Palette& palette, float size) const
+{
+	glPointSize(size);
+	pointShader.use();
+	glUniformMatrix4fv(pointProjection, 1, GL_FALSE, glm::value_ptr(camera.projection));
+	glUniformMatrix4fv(pointView,       1, GL_FALSE, glm::value_ptr(camera.view));
+	glUniform4fv(pointPalette, STATE_COUNT, glm::value_ptr(palette[0]));
+}
+
+void SurfaceRenderer::drawPoints(const Camera& camera, const Palette& palette, float size) const
+{
+	// Without states for every point (not set since the net changed) they'd be read past the buffer
+	if (states.size() != pointCount) return;
+
+	glEnable(GL_DEPTH_TEST);
+	usePointShader(camera, palette, size);
+
+	glBindVertexArray(pointArray);
+	glDrawArrays(GL_POINTS, 0, GLsizei(pointCount));
+	glBindVertexArray(0);
+	glUseProgram(0);
+}
+
+void SurfaceRenderer::drawExtraPoints(const Camera& camera, const Palette& palette, float size,
+	const std::vector<glm::vec3>& points, PointState state, bool depthTest)
+{
+	if (points.empty()) return;
+
+	std::vector<uint8_t> pointStates(points.size(), state);
+	glBindBuffer(GL_ARRAY_BUFFER, extraBuffer);
+	glBufferData(GL_ARRAY_BUFFER, GLsizeiptr(points.size() * sizeof(glm::vec3)), points.data(), GL_STREAM_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, extraStateBuffer);
+	glBufferData(GL_ARRAY_BUFFER, GLsizeiptr(pointStates.size()), pointStates.data(), GL_STREAM_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	if (depthTest) glEnable(GL_DEPTH_TEST);
+	else           glDisable(GL_DEPTH_TEST);
+	usePointShader(camera, palette, size);
+
+	glBindVertexArray(extraArray);
+	glDrawArrays(GL_POINTS, 0, GLsizei(points.size()));
+	glBindVertexArray(0);
+	glUseProgram(0);
+}
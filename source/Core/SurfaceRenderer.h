@@ -0,0 +1,162 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <vector>
+#include "glm/glm.hpp"
+
+#include "Core/BezierPatches.h"
+#include "Core/Camera.h"
+#include "Core/Mesh.h"
+#include "Core/Nurbs.h"
+#include "Core/OpenGL.h"
+#include "Core/RingBuffer.h"
+#include "Core/Shader.h"
+#include "Core/Tessellator.h"
+
+
+// Retained mode renderer of the edited surface (GL 3.0 & GLSL 1.30, which Mesa llvmpipe has).
+// The tessellated mesh and the control points stay in GPU buffers that are refilled only when
+// the surface revision changes, so a frame is one indexed draw for the surface, one indexed
+// line draw for the control net and one draw for the points. Points are colored from a palette
+// by a state byte each, a selection change rewrites only those bytes.
+//
+// Points are plain GL_POINTS rather than instanced quads: llvmpipe runs an instanced draw
+// one instance at a time, which made a 400x400 net 17x slower to draw
+//
+// A dragged control point changes the mesh every frame: only the patches it influences are
+// re-tessellated and only that range of vertices is written, into a persistently mapped
+// RingBuffer where it's available (a glBufferSubData of the range otherwise).
+//
+// With GL 4.0 the surface can instead be drawn from its Bezier patches by tessellation shaders:
+// no mesh is made or stored, every patch gets per edge levels from the screen length of its
+// boundary's control polygon (neighbours compute the same ones, so there are no cracks)
+// and patches whose control points are all outside the view are skipped
+class SurfaceRenderer
+{
+public:
+	enum PointState : uint8_t { COMMON, NEARBY, INSERT, DELETE, ACCENT, STATE_COUNT };
+	using Palette = std::array<glm::vec4, STATE_COUNT>;
+
+	struct Statistics
+	{
+		size_t tessellations  = 0;  // Whole mesh & control points uploaded
+		size_t partialUpdates = 0;  // Moves of a single control point
+		size_t stateUploads   = 0;
+		size_t vertexBytes    = 0;  // Written to the vertex buffers
+		size_t triangles      = 0;
+		size_t patches        = 0;  // Drawn by GPU tessellation
+	};
+
+	size_t segments = Tessellator::DEFAULT_SEGMENTS;
+	// Screen length in pixels GPU tessellation aims at for an edge
+	float edgePixels = 8.f;
+
+	SurfaceRenderer() = default;
+	~SurfaceRenderer();
+
+	SurfaceRenderer(const SurfaceRenderer&) = delete;
+	SurfaceRenderer& operator=(const SurfaceRenderer&) = delete;
+
+	// Needs a current context with the functions loaded by GL::load.
+	// Throws std::runtime_error if the shaders can't be built
+	void init();
+	inline bool isReady() const { return surfaceShader.isValid(); }
+	// Deletes the GL objects, the context they were made in has to be current.
+	// Call before the context goes, the destructor only calls it
+	void destroy();
+
+	// Makes the next update upload everything, e.g. after the surface was replaced by another one
+	inline void invalidate() { revision = NO_REVISION; }
+
+	// GPU tessellation needs GL 4.0, if the context doesn't have it the mesh is always used
+	inline bool hasGPUTessellation() const { return patchShader.isValid(); }
+	inline bool isGPUTessellation() const  { return gpuTessellation; }
+	void setGPUTessellation(bool enabled);
+
+	// Re-tessellates & uploads only if the surface changed since the last call
+	void update(const NURBS& surface);
+	// Call right after surface.setControlPoint(i, ...) to update only the affected part of the mesh
+	void controlPointMoved(const NURBS& surface, size_t i);
+	// One state per control point, uploaded only if they differ from the previous ones
+	void setPointStates(const std::vector<uint8_t>& states);
+
+	void drawSurface(const Camera& camera);
+	// Lines between the neighbouring control points
+	void drawNet(const Camera& camera, const glm::vec4& color) const;
+	// Squares of 'size' pixels
+	void drawPoints(const Camera& camera, const Palette& palette, float size) const;
+	// Points outside the net (insertion preview, accents), uploaded on every call
+	void drawExtraPoints(const Camera& camera, const Palette& palette, float size,
+		const std::vector<glm::vec3>& points, PointState state, bool depthTest);
+
+	inline const Statistics& getStatistics() const { return statistics; }
+	inline bool isStreaming() const { return streaming; }
+	inline const RingBuffer::Statistics& getRingStatistics() const { return ring.getStatistics(); }
+
+private:
+	static const size_t NO_REVISION = size_t(-1);
+
+	Shader surfaceShader, pointShader, netShader, patchShader;
+	GLint surfaceProjection = -1, surfaceView = -1;
+	GLint pointProjection = -1, pointView = -1, pointPalette = -1;
+	GLint netProjection = -1, netView = -1, netColor = -1;
+	GLint patchProjection = -1, patchView = -1, patchDegree = -1, patchViewport = -1, patchEdgePixels = -1;
+
+	GLuint surfaceArray = 0, surfaceBuffer = 0, indexBuffer = 0;
+	GLuint pointArray = 0, pointBuffer = 0, stateBuffer = 0;
+	GLuint extraArray = 0, extraBuffer = 0, extraStateBuffer = 0;
+	GLuint netArray = 0, netIndexBuffer = 0;
+	// Patch points are read through a buffer texture, the draw has no vertex attributes
+	GLuint patchArray = 0, patchBuffer = 0, patchTexture = 0;
+	// Limited only on llvmpipe, see initPatches
+	static const size_t ALL_PATCHES = size_t(-1);
+	size_t patchesPerDraw = ALL_PATCHES;
+
+	// Vertices not yet written to a copy of the mesh
+	struct Range
+	{
+		size_t first = 0, last = 0;
+
+		inline bool empty() const { return first >= last; }
+		inline void add(size_t a, size_t b)
+		{
+			if (empty()) { first = a; last = b; }
+			else { first = std::min(first, a); last = std::max(last, b); }
+		}
+	};
+
+	// Vertex storage holds positions of 'capacity' vertices followed by their normals,
+	// once per region of the ring (or once in surfaceBuffer without streaming)
+	bool streaming = false;
+	RingBuffer ring;
+	size_t capacity = 0;
+	size_t region = 0;
+	Range dirty[RingBuffer::REGIONS];
+
+	size_t revision = NO_REVISION;
+	size_t indexCount = 0, pointCount = 0;
+	// Net indices depend only on the dims
+	size_t netDim[NURBS::PARAM_DIM] = {};
+	size_t netIndexCount = 0;
+	std::vector<uint8_t> states;
+
+	Mesh mesh;
+	bool gpuTessellation = false;
+	BezierPatches patches;
+	Statistics statistics;
+
+	void initPatches();
+	void updateMesh(const NURBS& surface);
+	void updatePatches(const NURBS& surface);
+	void drawPatches(const Camera& camera);
+
+	void reserveVertices(size_t count);
+	void markDirty(size_t first, size_t last);
+	// Brings the vertex copy the next draw reads up to date
+	void syncVertices();
+	void setSurfaceLayout(GLuint buffer, size_t offset);
+	void updateNet(const NURBS& surface);
+	void usePointShader(const Camera& camera, const Palette& palette, float size) const;
+};
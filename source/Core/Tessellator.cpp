@@ -0,0 +1,132 @@
+#include "Core/Tessellator.h"
+
+#include <algorithm>
+#include <atomic>
+#include "Core/Parallel.h"
+
+
+template<typename Scalar>
+std::vector<Scalar> Tessellator::parameters(const BasicNURBS<Scalar>& surface, typename BasicNURBS<Scalar>::Dim d, size_t segments)
+{
+	std::vector<Scalar> result;
+	for (size_t span : surface.spans(d))
+	{
+		Scalar a = surface.knots[d][span], b = surface.knots[d][span + 1];
+		for (size_t k = 0; k < segments; k++)
+			result.push_back(a + (b - a) * Scalar(k) / Scalar(segments));
+	}
+	result.push_back(surface.domainEnd(d));
+	return result;
+}
+
+template<typename Scalar>
+bool Tessellator::evaluate(const BasicNURBS<Scalar>& surface, const std::vector<Scalar>& u, const std::vector<Scalar>& v,
+	size_t column0, size_t column1, size_t row0, size_t row1, Mesh& out)
+{
+	using surface_t = BasicNURBS<Scalar>;
+	size_t columns = u.size();
+
+	std::atomic<bool> degenerate = false;
+	Parallel::forEach(row0, row1, [&](size_t j)
+	{
+		for (size_t i = column0; i < column1; i++)
+		{
+			typename surface_t::point_t partials[2];
+			size_t index = j * columns + i;
+			out.vertices[index] = glm::vec3(surface.evaluate({ u[i], v[j] }, partials));
+
+			// Collapsed edges (poles) have no tangent plane, they get the averaged face normals
+			glm::vec3 normal = glm::vec3(glm::cross(partials[0], partials[1]));
+			float length = glm::length(normal);
+			if (length > 0.f) out.normals[index] = normal / length;
+			else
+			{
+				out.normals[index] = glm::vec3(0.f);
+				degenerate = true;
+			}
+		}
+	}, 16);
+	return !degenerate;
+}
+
+template<typename Scalar>
+void Tessellator::tessellate(const BasicNURBS<Scalar>& surface, Mesh& out, size_t segments)
+{
+	using surface_t = BasicNURBS<Scalar>;
+
+	segments = std::max<size_t>(segments, 1);
+	std::vector<Scalar> u = parameters(surface, surface_t::U, segments);
+	std::vector<Scalar> v = parameters(surface, surface_t::V, segments);
+	size_t columns = u.size(), rows = v.size();
+
+	out.vertices.resize(columns * rows);
+	out.normals.resize(columns * rows);
+	out.indices.resize((columns - 1) * (rows - 1) * 6);
+
+	bool degenerate = !evaluate(surface, u, v, 0, columns, 0, rows, out);
+
+	Parallel::forEach(0, rows - 1, [&](size_t j)
+	{
+		uint32_t* quad = &out.indices[j * (columns - 1) * 6];
+		for (size_t i = 0; i + 1 < columns; i++, quad += 6)
+		{
+			uint32_t a = uint32_t(j * columns + i), b = a + 1;
+			uint32_t c = a + uint32_t(columns), d = c + 1;
+
+			// Counter-clockwise when looking against the dU x dV normal
+			quad[0] = a; quad[1] = b; quad[2] = d;
+			quad[3] = a; quad[4] = d; quad[5] = c;
+		}
+	}, 64);
+
+	if (degenerate)
+	{
+		std::vector<glm::vec3> analytic = std::move(out.normals);
+		out.calculateNormals();
+		for (size_t i = 0; i < analytic.size(); i++)
+			if (analytic[i] != glm::vec3(0.f)) out.normals[i] = analytic[i];
+	}
+}
+
+template<typename Scalar>
+std::pair<size_t, size_t> Tessellator::retessellate(const BasicNURBS<Scalar>& surface, Mesh& mesh,
+	const std::vector<size_t>& patches, size_t segments)
+{
+	using surface_t = BasicNURBS<Scalar>;
+
+	segments = std::max<size_t>(segments, 1);
+	size_t spansU = surface.spans(surface_t::U).size();
+	size_t spansV = surface.spans(surface_t::V).size();
+	size_t columns = spansU * segments + 1, rows = spansV * segments + 1;
+
+	auto full = [&]()
+	{
+		tessellate(surface, mesh, segments);
+		return std::pair<size_t, size_t>(0, mesh.vertices.size());
+	};
+	if (mesh.vertices.size() != columns * rows || mesh.normals.size() != columns * rows) return full();
+	if (patches.empty()) return { 0, 0 };
+
+	// Block of grid vertices covering the patches (patch = span in U + spansU * span in V)
+	size_t column0 = columns, column1 = 0, row0 = rows, row1 = 0;
+	for (size_t patch : patches)
+	{
+		size_t pu = patch % spansU, pv = patch / spansU;
+		column0 = std::min(column0, pu * segments);
+		column1 = std::max(column1, (pu + 1) * segments + 1);
+		row0    = std::min(row0, pv * segments);
+		row1    = std::max(row1, (pv + 1) * segments + 1);
+	}
+
+	std::vector<Scalar> u = parameters(surface, surface_t::U, segments);
+	std::vector<Scalar> v = parameters(surface, surface_t::V, segments);
+	if (!evaluate(surface, u, v, column0, column1, row0, row1, mesh)) return full();
+
+	return { row0 * columns + column0, (row1 - 1) * columns + column1 };
+}
+
+
+template void Tessellator::tessellate(const BasicNURBS<float>&,  Mesh&, size_t);
+template void Tessellator::tessellate(const BasicNURBS<double>&, Mesh&, size_t);
+template std::pair<size_t, size_t> Tessellator::retessellate(const BasicNURBS<float>&,  Mesh&, const std::vector<size_t>&, size_t);
+template std::pair<size_t, size_t> Tessellator::retessellate(const BasicNURBS<double>&, Mesh&, const std::vector<size_t>&, size_t);
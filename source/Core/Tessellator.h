@@ -0,0 +1,47 @@
+#pragma once
+
+#include <utility>
+#include <vector>
+
+#include "Core/Mesh.h"
+#include "Core/Nurbs.h"
+
+
+// Evaluates a surface on a grid refined uniformly inside every knot span, so patch
+// borders (where the surface may have kinks) are always sampled, and connects the
+// grid into an indexed triangle mesh with analytic normals
+class Tessellator
+{
+public:
+	static const size_t DEFAULT_SEGMENTS = 8;
+
+	// 'segments' per knot span in both directions
+	template<typename Scalar>
+	static void tessellate(const BasicNURBS<Scalar>& surface, Mesh& out, size_t segments = DEFAULT_SEGMENTS);
+
+	template<typename Scalar>
+	static inline Mesh tessellate(const BasicNURBS<Scalar>& surface, size_t segments = DEFAULT_SEGMENTS)
+	{
+		Mesh mesh;
+		tessellate(surface, mesh, segments);
+		return mesh;
+	}
+
+	// Re-evaluates the part of a mesh made by tessellate (with the same segments) that the patches
+	// cover, e.g. controlPointPatches of a moved point. Only valid while the knots and dims are
+	// the same, the indices don't change. Returns the range [first, last) of vertices written,
+	// the whole mesh when it can't be updated in place (it no longer matches, poles need face normals)
+	template<typename Scalar>
+	static std::pair<size_t, size_t> retessellate(const BasicNURBS<Scalar>& surface, Mesh& mesh,
+		const std::vector<size_t>& patches, size_t segments = DEFAULT_SEGMENTS);
+
+private:
+	template<typename Scalar>
+	static std::vector<Scalar> parameters(const BasicNURBS<Scalar>& surface, typename BasicNURBS<Scalar>::Dim d, size_t segments);
+
+	// Vertices & normals of the grid block [column0, column1) x [row0, row1),
+	// false if some of the normals are degenerate (left zero)
+	template<typename Scalar>
+	static bool evaluate(const BasicNURBS<Scalar>& surface, const std::vector<Scalar>& u, const std::vector<Scalar>& v,
+		size_t column0, size_t column1, size_t row0, size_t row1, Mesh& out);
+};
@@ -0,0 +1,51 @@
+#include "Core/TextStream.h"
+
+#include <cstring>
+
+
+TextWriter& TextWriter::text(std::string_view text)
+{
+	if (text.size() > buffer.size())
+	{
+		flush();
+		out.write(text.data(), std::streamsize(text.size()));
+		return *this;
+	}
+
+	reserve(text.size());
+	std::memcpy(buffer.data() + used, text.data(), text.size());
+	used += text.size();
+	return *this;
+}
+
+void TextWriter::flush()
+{
+	if (used == 0) return;
+	out.write(buffer.data(), std::streamsize(used));
+	used = 0;
+}
+
+
+bool TextReader::atEnd()
+{
+	while (p < end && isSpace(*p)) p++;
+	return p == end;
+}
+
+std::string_view TextReader::word()
+{
+	if (atEnd()) return {};
+
+	const char* start = p;
+	while (p < end && !isSpace(*p)) p++;
+	return { start, size_t(p - start) };
+}
+
+bool TextReader::expect(std::string_view expected)
+{
+	const char* start = p;
+	if (word() == expected) return true;
+
+	p = start;
+	return false;
+}
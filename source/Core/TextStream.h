@@ -0,0 +1,80 @@
+#pragma once
+
+#include <charconv>
+#include <ostream>
+#include <string_view>
+#include <vector>
+
+
+// Text output through a reusable buffer: numbers are formatted in place by std::to_chars
+// (shortest representation that reads back to the same value) and the buffer goes
+// to the stream in a single write once it's full
+class TextWriter
+{
+	std::ostream& out;
+	std::vector<char> buffer;
+	size_t used = 0;
+
+public:
+	static const size_t BUFFER_SIZE = 1 << 16;
+	// Longest formatted number (a double with a 3-digit exponent and a sign)
+	static const size_t MAX_NUMBER = 32;
+
+	explicit TextWriter(std::ostream& out) : out(out), buffer(BUFFER_SIZE) {}
+	inline ~TextWriter() { flush(); }
+
+	TextWriter(const TextWriter&) = delete;
+	TextWriter& operator=(const TextWriter&) = delete;
+
+	template<typename T>
+	inline TextWriter& number(T value)
+	{
+		reserve(MAX_NUMBER);
+		used = std::to_chars(buffer.data() + used, buffer.data() + buffer.size(), value).ptr - buffer.data();
+		return *this;
+	}
+	inline TextWriter& character(char c)
+	{
+		reserve(1);
+		buffer[used++] = c;
+		return *this;
+	}
+	TextWriter& text(std::string_view text);
+
+	void flush();
+
+private:
+	inline void reserve(size_t size) { if (used + size > buffer.size()) flush(); }
+};
+
+// Parser of whitespace separated words and numbers (std::from_chars) over text in memory
+class TextReader
+{
+	const char* p;
+	const char* end;
+
+public:
+	explicit TextReader(std::string_view text) : p(text.data()), end(text.data() + text.size()) {}
+
+	// Skips the whitespace, true when nothing else is left
+	bool atEnd();
+
+	template<typename T>
+	bool number(T& value)
+	{
+		if (atEnd()) return false;
+
+		const char* start = (*p == '+') ? p + 1 : p;
+		auto [last, error] = std::from_chars(start, end, value);
+		if (error != std::errc() || (last < end && !isSpace(*last))) return false;
+		p = last;
+		return true;
+	}
+
+	std::string_view word();
+	// Consumes the next word if it's 'expected'
+	bool expect(std::string_view expected);
+
+private:
+	static inline bool isSpace(char c) { return c == ' ' || c == '\t' || c == '\n' || c == '\r'; }
+};
@@ -15,7 +15,9 @@ Window::Window(std::string title, int width, int height)
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 2);
 	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_COMPAT_PROFILE);
 
-	glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
+	glfwWindowHint(GLFW_RESIZABLE, GLFW_TRUE);
+	// The window grows with the monitor's content scale (HiDPI), the GUI scales its fonts to match
+	glfwWindowHint(GLFW_SCALE_TO_MONITOR, GLFW_TRUE);
 
 	window = glfwCreateWindow(width, height, title.c_str(), NULL, NULL);
 	if (!window)
@@ -26,28 +28,66 @@ Window::Window(std::string title, int width, int height)
 
 	glfwSetWindowCloseCallback(window, CallbackClose);
 
+	glfwSetWindowUserPointer(window, this);
+	glfwSetCursorPosCallback(window, CallbackCursorPos);
+	glfwSetCursorEnterCallback(window, CallbackCursorEnter);
+	glfwSetMouseButtonCallback(window, CallbackMouseButton);
+	glfwSetScrollCallback(window, CallbackScroll);
+	glfwSetKeyCallback(window, CallbackKey);
+	glfwSetCharCallback(window, CallbackChar);
+	glfwSetWindowFocusCallback(window, CallbackFocus);
+	glfwSetWindowRefreshCallback(window, CallbackRefresh);
+	glfwSetFramebufferSizeCallback(window, CallbackFramebufferSize);
+
 	glfwMakeContextCurrent(window);
-	glfwSwapInterval(1); // Enable vsync
+	framePacer.setVSync(true);
 
 	gui.init(this);
 }
 
-Window::~Window() { glfwTerminate(); }
+Window::~Window()
+{
+	// The GUI's GL objects go while the context is still current
+	gui.shutdown();
+	glfwDestroyWindow(window);
+	glfwTerminate();
+}
 
 
 void Window::mainloop()
 {
 	while (!glfwWindowShouldClose(window))
 	{
-		// Poll and handle events (inputs, window resize, etc.)
+		// Idle rendering sleeps until an event comes or the timeout passes
+		// and skips the frame if neither changed anything
+		if (gui.isIdleRendering() && !gui.needsRedraw(float(glfwGetTime())))
+		{
+			glfwWaitEventsTimeout(GUI::IDLE_TIMEOUT);
+			if (!gui.needsRedraw(float(glfwGetTime())))
+			{
+				framePacer.idle();
+				continue;
+			}
+		}
+
+		// The limiter waits before polling, so the frame gets the latest input
+		framePacer.waitForFrame();
 		glfwPollEvents();
 
+		// Minimized, there's nothing to draw into
 		int width, height;
 		glfwGetFramebufferSize(window, &width, &height);
-		gui.mainloop(1280, 720, glfwGetTime());
+		if (width <= 0 || height <= 0)
+		{
+			framePacer.idle();
+			glfwWaitEvents();
+			continue;
+		}
+
+		framePacer.beginFrame();
+		gui.mainloop(width, height, glfwGetTime());
 
 		glfwSwapBuffers(window);
+		framePacer.endFrame();
 	}
-
-	glfwDestroyWindow(window);
 }
\ No newline at end of file
@@ -10,12 +10,14 @@
 // This also allows the two headers to be included in any order.
 #define GLFW_INCLUDE_GLU
 #include "glfw3.h"
+#include "Core/FramePacer.h"
 #include "Core/GUI.h"
 
 
 class Window
 {
 private:
+	FramePacer framePacer;
 	GUI gui;
 	static bool initialized;
 
@@ -33,9 +35,31 @@ private:
 	inline static void CallbackClose(GLFWwindow* window)
 	{ std::cout << "GLFW Window Close Callback Successful\n"; }
 
+	// Every input & refresh wakes the idle loop up for a few frames, input also starts a latency
+	// measurement. Set before ImGui's backend, which calls them from its own callbacks
+	inline static void redraw(GLFWwindow* window)
+	{ static_cast<Window*>(glfwGetWindowUserPointer(window))->gui.requestRedraw(); }
+	inline static void input(GLFWwindow* window)
+	{
+		static_cast<Window*>(glfwGetWindowUserPointer(window))->framePacer.inputEvent();
+		redraw(window);
+	}
+	inline static void CallbackCursorPos(GLFWwindow* window, double, double)       { input(window); }
+	inline static void CallbackCursorEnter(GLFWwindow* window, int)                { redraw(window); }
+	inline static void CallbackMouseButton(GLFWwindow* window, int, int, int)      { input(window); }
+	inline static void CallbackScroll(GLFWwindow* window, double, double)          { input(window); }
+	inline static void CallbackKey(GLFWwindow* window, int, int, int, int)         { input(window); }
+	inline static void CallbackChar(GLFWwindow* window, unsigned int)              { input(window); }
+	inline static void CallbackFocus(GLFWwindow* window, int)                      { redraw(window); }
+	inline static void CallbackRefresh(GLFWwindow* window)                         { redraw(window); }
+	inline static void CallbackFramebufferSize(GLFWwindow* window, int, int)       { redraw(window); }
+
 public:
 	Window(std::string title, int width=DEFAULT_WIDTH, int height=DEFAULT_HEIGHT);
 	~Window();
 
 	void mainloop();
+
+	inline GUI& getGUI() { return gui; }
+	inline FramePacer& getFramePacer() { return framePacer; }
 };
\ No newline at end of file